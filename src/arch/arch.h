@@ -8,9 +8,18 @@
 
 typedef struct _graph * (* arch_disassemble) (const struct _map *, const uint64_t entry);
 
+// what the nodes of a disassembled graph hold
+enum {
+    // one _ins per node
+    ARCH_DIS_INS,
+    // one basic block per node, a _vector of _ins
+    ARCH_DIS_BLOCKS
+};
+
 struct _arch_dis_option {
     char * name;
     arch_disassemble disassemble;
+    int granularity;
 };
 
 struct _arch {
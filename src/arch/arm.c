@@ -2,19 +2,22 @@
 
 #include "darm/darm.h"
 
+#include "block_dis.h"
 #include "buffer.h"
 #include "instruction.h"
 #include "recursive_dis.h"
 
 struct _ins   * arm_disassemble_ins       (const struct _map *, const uint64_t address);
 struct _graph * arm_recursive_disassemble (const struct _map *, const uint64_t entry);
+struct _graph * arm_block_disassemble     (const struct _map *, const uint64_t entry);
 
 struct _arch arch_arm = {
     arm_disassemble_ins,
-    {"arm Recursive Disassembly", arm_recursive_disassemble},
+    {"arm Recursive Disassembly", arm_recursive_disassemble, ARCH_DIS_INS},
     {
-        {"arm Recursive Disassembly", arm_recursive_disassemble},
-        {NULL, NULL}
+        {"arm Recursive Disassembly", arm_recursive_disassemble, ARCH_DIS_INS},
+        {"arm Block Disassembly", arm_block_disassemble, ARCH_DIS_BLOCKS},
+        {NULL, NULL, 0}
     }
 };
 
@@ -46,11 +49,12 @@ struct _ins * arm_disassemble_ins (const struct _map * mem_map,
 
     darm_str_t darm_str_;
     darm_str(&darm, &darm_str_);
-    struct _ins * ins = ins_create(address,
-                                   (uint8_t *) &w,
-                                   4,
-                                   darm_str_.instr,
-                                   NULL);
+    struct _ins * ins = ins_create_view(address,
+                                        buf,
+                                        offset,
+                                        4,
+                                        darm_str_.instr,
+                                        NULL);
 
     int64_t dest_offset = (int32_t) darm.imm;
     uint64_t dest = address + dest_offset;
@@ -95,4 +99,10 @@ struct _ins * arm_disassemble_ins (const struct _map * mem_map,
 struct _graph * arm_recursive_disassemble (const struct _map * mem_map, const uint64_t entry)
 {
     return recursive_disassemble(mem_map, entry, arm_disassemble_ins);
+}
+
+
+struct _graph * arm_block_disassemble (const struct _map * mem_map, const uint64_t entry)
+{
+    return block_disassemble(mem_map, entry, arm_disassemble_ins);
 }
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "block_dis.h"
+
+#include "hashmap.h"
+#include "ins_cache.h"
+#include "queue.h"
+#include "vector.h"
+
+#include <stdlib.h>
+
+
+// returns 1 if control only ever falls through ins to the instruction
+// directly after it. calls fall through
+static int block_dis_falls_through (const struct _ins * ins)
+{
+    const struct _ins_value * next = NULL;
+    size_t i;
+
+    for (i = 0; i < ins->successors->size; i++) {
+        const struct _ins_value * successor = ins->successors->items[i];
+        if (successor->type == INS_SUC_CALL)
+            continue;
+        if (next != NULL)
+            return 0;
+        next = successor;
+    }
+
+    return    (next != NULL)
+           && (next->type == INS_SUC_NORMAL)
+           && (next->address == ins->address + ins->size);
+}
+
+
+// records block as the owner of each of its instructions
+static void block_dis_own (struct _hashmap * owners, struct _vector * block)
+{
+    size_t i;
+
+    for (i = 0; i < block->size; i++) {
+        struct _ins * ins = block->items[i];
+        hashmap_remove(owners, ins->address);
+        hashmap_insert(owners, ins->address, block);
+    }
+}
+
+
+// if address is the start of an instruction inside a block, other than its
+// first, splits the block there. returns 1 if address now starts a block.
+// the block is found through owners, which maps each instruction's address
+// to its block. a block starting below address may not hold it, when a
+// branch landed in the middle of an instruction and decoding went on from
+// there, so the closest block start is no guide
+static int block_dis_split (struct _map * blocks,
+                            struct _hashmap * owners,
+                            uint64_t address)
+{
+    struct _vector * block = hashmap_fetch(owners, address);
+    struct _vector * tail;
+    size_t           i, j;
+
+    if (block == NULL)
+        return 0;
+    if (((struct _ins *) block->items[0])->address == address)
+        return 1;
+
+    for (i = 1; i < block->size; i++) {
+        struct _ins * ins = block->items[i];
+        if (ins->address == address)
+            break;
+    }
+
+    tail = vector_create();
+    // the references move to tail
+    for (j = i; j < block->size; j++)
+        vector_append_take(tail, block->items[j]);
+    block->size = i;
+
+    block_dis_own(owners, tail);
+    map_insert_take(blocks, address, tail);
+
+    return 1;
+}
+
+
+struct _graph * block_disassemble (const struct _map * mem_map,
+                                   uint64_t entry,
+                struct _ins * (* ins_callback) (const struct _map *, uint64_t))
+{
+    struct _queue_u64 * queue  = queue_u64_create();
+    // blocks by their first address, so the block an address falls in is
+    // the one starting at or below it
+    struct _map       * blocks = map_create();
+    // instruction addresses to the blocks holding them
+    struct _hashmap   * owners = hashmap_create();
+    // block starts where no instruction could be decoded
+    struct _hashset   * failed = hashset_create();
+
+    queue_u64_push(queue, entry);
+
+    while (queue->size > 0) {
+        uint64_t address = queue_u64_peek(queue);
+        queue_u64_pop(queue);
+
+        if (hashset_contains(failed, address))
+            continue;
+        // already decoded, perhaps as part of a run from further up
+        if (block_dis_split(blocks, owners, address))
+            continue;
+
+        struct _vector * block = vector_create();
+        struct _ins    * ins   = NULL;
+
+        while (1) {
+            ins = ins_cache_decode(mem_map, address, ins_callback);
+            if (ins == NULL)
+                break;
+            vector_append_take(block, ins);
+
+            if (! block_dis_falls_through(ins))
+                break;
+
+            // stop where a block already starts, and make one start where
+            // the run meets code decoded before
+            address = ins->address + ins->size;
+            if (block_dis_split(blocks, owners, address))
+                break;
+        }
+
+        if (block->size == 0) {
+            hashset_insert(failed, address);
+            object_delete(block);
+            continue;
+        }
+
+        block_dis_own(owners, block);
+        map_insert_take(blocks, ((struct _ins *) block->items[0])->address, block);
+
+        // the run ended on a branch, so its targets start blocks
+        if (ins != NULL) {
+            size_t i;
+            for (i = 0; i < ins->successors->size; i++) {
+                struct _ins_value * successor = ins->successors->items[i];
+                if (successor->type == INS_SUC_CALL)
+                    continue;
+                queue_u64_push(queue, successor->address);
+            }
+        }
+    }
+
+    objects_delete(queue, owners, failed, NULL);
+
+    // create graph nodes, in address order
+    uint64_t * addresses = (uint64_t *) malloc(sizeof(uint64_t) * blocks->size);
+    void    ** data      = (void **) malloc(sizeof(void *) * blocks->size);
+    size_t     n         = 0;
+    size_t     i, j;
+
+    struct _map_iter mit;
+    int              more;
+    for (more = map_iter_first(&mit, blocks); more; more = map_iter_next(&mit)) {
+        addresses[n] = mit.key;
+        data[n]      = object_retain(mit.value);
+        n++;
+    }
+
+    struct _graph * graph = graph_build_sorted(addresses, data, n);
+
+    // create graph edges, from the last instruction of each block
+    for (i = 0; i < n; i++) {
+        struct _vector * block = data[i];
+        struct _ins    * last  = block->items[block->size - 1];
+        for (j = 0; j < last->successors->size; j++) {
+            struct _ins_value * successor = last->successors->items[j];
+            // don't add call edges
+            if (successor->type == INS_SUC_CALL)
+                continue;
+            graph_add_edge(graph, addresses[i], successor->address, successor);
+        }
+    }
+
+    free(addresses);
+    free(data);
+    object_delete(blocks);
+
+    return graph;
+}
@@ -0,0 +1,25 @@
+#ifndef block_dis_HEADER
+#define block_dis_HEADER
+
+#include <inttypes.h>
+
+#include "graph.h"
+#include "instruction.h"
+#include "map.h"
+
+// like recursive_disassemble, but returns a graph of basic blocks, each a
+// _vector of _ins in address order. straight-line runs are decoded until an
+// instruction which does anything but fall through, and a block is split
+// when a branch lands inside it. edges carry the _ins_value of the block's
+// last instruction
+//
+// the blocks are not always those ins_graph_to_block_graph makes. that
+// joins any instruction with one successor to a successor with one
+// predecessor, jumps included, where here every jump ends a block. for
+// "jmp L; L: ret" ins_graph_to_block_graph gives one block and
+// block_disassemble gives two
+struct _graph * block_disassemble (const struct _map * mem_map,
+                                   uint64_t entry,
+               struct _ins * (* ins_callback) (const struct _map *, uint64_t));
+
+#endif
@@ -0,0 +1,147 @@
+#include "ins_cache.h"
+
+#include "arena.h"
+
+static const struct _object ins_cache_object = {
+    (void   (*) (void *)) ins_cache_delete,
+    NULL,
+    NULL,
+    NULL
+};
+
+// each thread binds its own cache
+static __thread struct _ins_cache * bound_cache = NULL;
+
+
+struct _ins_cache * ins_cache_create (const struct _map * mem_map)
+{
+    struct _ins_cache * cache;
+    struct _arena     * arena;
+    unsigned int        i;
+
+    cache = (struct _ins_cache *) mem_alloc(sizeof(struct _ins_cache));
+    cache->object  = &ins_cache_object;
+    cache->refs    = 1;
+    cache->mem_map = mem_retain(cache, mem_map);
+
+    // the stripe arenas go with the arena the cache is in
+    arena = arena_bind(NULL);
+    for (i = 0; i < INS_CACHE_STRIPES; i++) {
+        pthread_mutex_init(&(cache->stripes[i].lock), NULL);
+        cache->stripes[i].arena = arena_create();
+        if (arena != NULL)
+            arena_hold(arena, cache->stripes[i].arena);
+        arena_bind(cache->stripes[i].arena);
+        cache->stripes[i].ins    = hashmap_create();
+        cache->stripes[i].hits   = 0;
+        cache->stripes[i].misses = 0;
+        arena_bind(NULL);
+    }
+    arena_bind(arena);
+
+    return cache;
+}
+
+
+
+void ins_cache_delete (struct _ins_cache * cache)
+{
+    unsigned int i;
+
+    if (bound_cache == cache)
+        bound_cache = NULL;
+
+    for (i = 0; i < INS_CACHE_STRIPES; i++) {
+        objects_delete(cache->stripes[i].ins, cache->stripes[i].arena, NULL);
+        pthread_mutex_destroy(&(cache->stripes[i].lock));
+    }
+
+    mem_release(cache, cache->mem_map);
+    mem_free(cache);
+}
+
+
+
+struct _ins_cache * ins_cache_bind (struct _ins_cache * cache)
+{
+    struct _ins_cache * previous = bound_cache;
+    bound_cache = cache;
+    return previous;
+}
+
+
+
+// instructions sit next to each other, so the low bits of neighbouring
+// addresses differ and spread them over the stripes
+static struct _ins_cache_stripe * ins_cache_stripe (struct _ins_cache * cache,
+                                                    uint64_t address)
+{
+    uint64_t hash = address * 0x9e3779b97f4a7c15ULL;
+
+    return &(cache->stripes[hash >> (64 - INS_CACHE_STRIPE_BITS)]);
+}
+
+
+
+struct _ins * ins_cache_decode (const struct _map * mem_map,
+                                uint64_t address,
+                  struct _ins * (* decode) (const struct _map *, uint64_t))
+{
+    struct _ins_cache        * cache = bound_cache;
+    struct _ins_cache_stripe * stripe;
+    struct _ins              * ins;
+    struct _arena            * previous;
+
+    if ((cache == NULL) || (cache->mem_map != mem_map))
+        return decode(mem_map, address);
+
+    stripe = ins_cache_stripe(cache, address);
+    pthread_mutex_lock(&(stripe->lock));
+
+    if (hashmap_contains(stripe->ins, address)) {
+        stripe->hits++;
+        ins = hashmap_fetch(stripe->ins, address);
+        if (ins != NULL)
+            ins = object_retain(ins);
+        pthread_mutex_unlock(&(stripe->lock));
+        return ins;
+    }
+
+    // the instruction comes from this thread's arena, the table from the
+    // stripe's, which is only used under the stripe's lock
+    stripe->misses++;
+    ins = decode(mem_map, address);
+    previous = arena_bind(stripe->arena);
+    hashmap_insert(stripe->ins, address, ins);
+    arena_bind(previous);
+
+    pthread_mutex_unlock(&(stripe->lock));
+
+    return ins;
+}
+
+
+
+size_t ins_cache_hits (struct _ins_cache * cache)
+{
+    size_t       hits = 0;
+    unsigned int i;
+
+    for (i = 0; i < INS_CACHE_STRIPES; i++)
+        hits += cache->stripes[i].hits;
+
+    return hits;
+}
+
+
+
+size_t ins_cache_misses (struct _ins_cache * cache)
+{
+    size_t       misses = 0;
+    unsigned int i;
+
+    for (i = 0; i < INS_CACHE_STRIPES; i++)
+        misses += cache->stripes[i].misses;
+
+    return misses;
+}
@@ -0,0 +1,76 @@
+#ifndef ins_cache_HEADER
+#define ins_cache_HEADER
+
+// a program-wide cache of decoded instructions
+//
+// an analysis binds a cache for its memory map while it runs, as it would
+// an arena. recursive_disassemble and block_disassemble decode through
+// ins_cache_decode, so an instruction reached from several functions, or
+// from the same function found again, is decoded once and then shared.
+// addresses where nothing decodes are cached too
+//
+// cached instructions are shared objects, so they must not be modified in
+// place (see object.h). a cache serves one memory map and one architecture.
+// bindings are per thread, and several threads may bind and decode through
+// the same cache at once. addresses are spread over INS_CACHE_STRIPES
+// tables, each with a lock of its own, and an address is decoded under its
+// table's lock, so it is decoded once however many threads reach it.
+// cached instructions live in the arena of the thread which decoded them,
+// and the cache holds a reference to each until it is deleted
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "arena.h"
+#include "hashmap.h"
+#include "instruction.h"
+#include "map.h"
+#include "object.h"
+
+#define INS_CACHE_STRIPE_BITS 4
+#define INS_CACHE_STRIPES     (1 << INS_CACHE_STRIPE_BITS)
+
+struct _ins_cache_stripe {
+    pthread_mutex_t   lock;
+    // the table is allocated from here
+    struct _arena   * arena;
+    // address to _ins, or NULL where nothing could be decoded
+    struct _hashmap * ins;
+    size_t            hits;
+    size_t            misses;
+};
+
+struct _ins_cache {
+    const struct _object   * object;
+    unsigned int             refs;
+    // held, so no other map can turn up at the same address
+    struct _map            * mem_map;
+    struct _ins_cache_stripe stripes[INS_CACHE_STRIPES];
+};
+
+
+// the cache is allocated from the bound arena. each stripe's table comes
+// from an arena of the stripe's own, as every thread using the cache grows
+// them, and the bound arena holds the stripe arenas, so dropping it drops
+// the cache and everything in it
+struct _ins_cache * ins_cache_create (const struct _map * mem_map);
+void                ins_cache_delete (struct _ins_cache * cache);
+
+// binds cache for future calls to ins_cache_decode on this thread, returning
+// the cache which was bound before. binding NULL stops caching
+struct _ins_cache * ins_cache_bind   (struct _ins_cache * cache);
+
+// returns a reference to the instruction at address, as decode would. when
+// the bound cache is for mem_map, decode is only called for addresses the
+// cache has not seen
+struct _ins * ins_cache_decode (const struct _map * mem_map,
+                                uint64_t address,
+                  struct _ins * (* decode) (const struct _map *, uint64_t));
+
+// lookups answered from the cache, and lookups which had to decode. only
+// exact while no thread is decoding through cache
+size_t ins_cache_hits   (struct _ins_cache * cache);
+size_t ins_cache_misses (struct _ins_cache * cache);
+
+#endif
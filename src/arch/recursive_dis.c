@@ -1,64 +1,85 @@
 #include "recursive_dis.h"
 
-#include "list.h"
-#include "index.h"
+#include "hashmap.h"
+#include "ins_cache.h"
 #include "queue.h"
 
+#include <stdlib.h>
+
+static int address_cmp (const void * lhs, const void * rhs)
+{
+    uint64_t l = *((const uint64_t *) lhs);
+    uint64_t r = *((const uint64_t *) rhs);
+
+    if (l < r)
+        return -1;
+    else if (l > r)
+        return 1;
+    return 0;
+}
+
+
 struct _graph * recursive_disassemble (const struct _map * mem_map,
                                        uint64_t entry,
                 struct _ins * (* ins_callback) (const struct _map *, uint64_t))
 {
-    struct _queue * queue = queue_create();
-    struct _map * map     = map_create();
+    struct _queue_u64 * queue = queue_u64_create();
+    // every address visited, with its instruction, or NULL when there was
+    // no instruction to be had there
+    struct _hashmap * map = hashmap_create();
 
-    struct _index * index = index_create(entry);
-    queue_push(queue, index);
-    object_delete(index);
+    queue_u64_push(queue, entry);
 
     while (queue->size > 0) {
-        struct _index * index = queue_peek(queue);
+        uint64_t address = queue_u64_peek(queue);
+        queue_u64_pop(queue);
 
-        if (map_fetch(map, index->index)) {
-            queue_pop(queue);
+        if (hashmap_contains(map, address))
             continue;
-        }
 
-        struct _ins * ins = ins_callback(mem_map, index->index);
-        if (ins == NULL) {
-            queue_pop(queue);
+        struct _ins * ins = ins_cache_decode(mem_map, address, ins_callback);
+        hashmap_insert_take(map, address, ins);
+        if (ins == NULL)
             continue;
-        }
-        map_insert(map, index->index, ins);
 
-        struct _list_it * lit;
-        for (lit = list_iterator(ins->successors); lit != NULL; lit = lit->next) {
-            struct _ins_value * successor = lit->data;
+        size_t i;
+        for (i = 0; i < ins->successors->size; i++) {
+            struct _ins_value * successor = ins->successors->items[i];
             if (successor->type == INS_SUC_CALL)
                 continue;
-            struct _index * index = index_create(successor->address);
-            queue_push(queue, index);
-            object_delete(index);
+            queue_u64_push(queue, successor->address);
         }
-
-        queue_pop(queue);
     }
 
     object_delete(queue);
 
-    // create graph nodes
-    struct _graph * graph = graph_create();
+    // create graph nodes, in address order
+    uint64_t * addresses = (uint64_t *) malloc(sizeof(uint64_t) * map->size);
+    void    ** inss      = (void **) malloc(sizeof(void *) * map->size);
+    size_t     n         = 0;
+    size_t     i;
 
-    struct _map_it * mit;
-    for (mit = map_iterator(map); mit != NULL; mit = map_it_next(mit)) {
-        graph_add_node(graph, map_it_key(mit), map_it_data(mit));
+    struct _hashmap_iter hit;
+    int                  more;
+    for (more = hashmap_iter_first(&hit, map);
+         more;
+         more = hashmap_iter_next(&hit)) {
+        if (hit.value != NULL)
+            addresses[n++] = hit.key;
     }
+    qsort(addresses, n, sizeof(uint64_t), address_cmp);
+
+    for (i = 0; i < n; i++)
+        inss[i] = object_retain(hashmap_fetch(map, addresses[i]));
+
+    struct _graph * graph = graph_build_sorted(addresses, inss, n);
 
     // create graph edges
-    for (mit = map_iterator(map); mit != NULL; mit = map_it_next(mit)) {
-        struct _ins * ins = map_it_data(mit);
-        struct _list_it * lit;
-        for (lit = list_iterator(ins->successors); lit != NULL; lit = lit->next) {
-            struct _ins_value * successor = lit->data;
+    for (i = 0; i < n; i++) {
+        struct _ins * ins = hashmap_fetch(map, addresses[i]);
+        size_t j;
+        for (j = 0; j < ins->successors->size; j++) {
+            struct _ins_value * successor = ins->successors->items[j];
             // don't add call edges
             if (successor->type == INS_SUC_CALL)
                 continue;
@@ -66,6 +87,8 @@ struct _graph * recursive_disassemble (const struct _map * mem_map,
         }
     }
 
+    free(addresses);
+    free(inss);
     object_delete(map);
 
     return graph;
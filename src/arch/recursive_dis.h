@@ -7,6 +7,8 @@
 #include "instruction.h"
 #include "map.h"
 
+// instructions are decoded with ins_callback, through the bound _ins_cache
+// (ins_cache.h)
 struct _graph * recursive_disassemble (const struct _map * mem_map,
                                        uint64_t entry,
                struct _ins * (* ins_callback) (const struct _map *, uint64_t));
@@ -2,31 +2,36 @@
 
 #include <udis86.h>
 
+#include "block_dis.h"
 #include "buffer.h"
 #include "instruction.h"
 #include "recursive_dis.h"
 
 struct _ins   * x86_disassemble_ins       (const struct _map *, const uint64_t address);
 struct _graph * x86_recursive_disassemble (const struct _map *, const uint64_t entry);
+struct _graph * x86_block_disassemble     (const struct _map *, const uint64_t entry);
 
 struct _arch arch_x86 = {
     x86_disassemble_ins,
-    {"x86 Recursive Disassembly", x86_recursive_disassemble},
+    {"x86 Recursive Disassembly", x86_recursive_disassemble, ARCH_DIS_INS},
     {
-        {"x86 Recursive Disassembly", x86_recursive_disassemble},
-        {NULL, NULL}
+        {"x86 Recursive Disassembly", x86_recursive_disassemble, ARCH_DIS_INS},
+        {"x86 Block Disassembly", x86_block_disassemble, ARCH_DIS_BLOCKS},
+        {NULL, NULL, 0}
     }
 };
 
 struct _ins   * amd64_disassemble_ins       (const struct _map * mem_map, const uint64_t address);
 struct _graph * amd64_recursive_disassemble (const struct _map *, const uint64_t entry);
+struct _graph * amd64_block_disassemble     (const struct _map *, const uint64_t entry);
 
 struct _arch arch_amd64 = {
     amd64_disassemble_ins,
-    {"amd64 Recursive Disassembly", amd64_recursive_disassemble},
+    {"amd64 Recursive Disassembly", amd64_recursive_disassemble, ARCH_DIS_INS},
     {
-        {"amd64 Recursive Disassembly", amd64_recursive_disassemble},
-        {NULL, NULL}
+        {"amd64 Recursive Disassembly", amd64_recursive_disassemble, ARCH_DIS_INS},
+        {"amd64 Block Disassembly", amd64_block_disassemble, ARCH_DIS_BLOCKS},
+        {NULL, NULL, 0}
     }
 };
 
@@ -66,11 +71,14 @@ struct _ins * x86_disassemble_ins_ (const struct _map * mem_map,
     if (ud_disassemble(&ud_obj) == 0)
         return NULL;
 
-    struct _ins * ins = ins_create(address,
-                                   ud_insn_ptr(&ud_obj),
-                                   ud_insn_len(&ud_obj),
-                                   ud_insn_asm(&ud_obj),
-                                   NULL);
+    // udis86 decoded straight from the segment, so the instruction can
+    // view its bytes there
+    struct _ins * ins = ins_create_view(address,
+                                        buf,
+                                        offset,
+                                        ud_insn_len(&ud_obj),
+                                        ud_insn_asm(&ud_obj),
+                                        NULL);
 
     switch (ud_obj.mnemonic) {
     case UD_Ijo   :
@@ -145,6 +153,12 @@ struct _graph * x86_recursive_disassemble (const struct _map * mem_map, const ui
 }
 
 
+struct _graph * x86_block_disassemble (const struct _map * mem_map, const uint64_t entry)
+{
+    return block_disassemble(mem_map, entry, x86_disassemble_ins);
+}
+
+
 struct _ins * amd64_disassemble_ins (const struct _map * mem_map, const uint64_t address)
 {
     return x86_disassemble_ins_(mem_map, address, 64);
@@ -154,4 +168,10 @@ struct _ins * amd64_disassemble_ins (const struct _map * mem_map, const uint64_t
 struct _graph * amd64_recursive_disassemble (const struct _map * mem_map, const uint64_t entry)
 {
     return recursive_disassemble(mem_map, entry, amd64_disassemble_ins);
+}
+
+
+struct _graph * amd64_block_disassemble (const struct _map * mem_map, const uint64_t entry)
+{
+    return block_disassemble(mem_map, entry, amd64_disassemble_ins);
 }
\ No newline at end of file
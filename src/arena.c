@@ -0,0 +1,410 @@
+#include "arena.h"
+
+static const struct _object arena_object = {
+    (void   (*) (void *)) arena_delete,
+    NULL,
+    NULL,
+    NULL
+};
+
+// each thread binds its own arena
+static __thread struct _arena * bound_arena = NULL;
+
+// the page map, a two level radix tree over 48 bit addresses. a leaf holds
+// one byte for each 4K page, saying whether it is arena memory and where to
+// find its _arena_page. leaves are added as they are needed and never freed,
+// and are read without a lock
+#define ARENA_MAP_NONE  0
+#define ARENA_MAP_SLAB  1
+#define ARENA_MAP_LARGE 2
+
+#define ARENA_MAP_LEAF    ((size_t) 1 << ARENA_MAP_BITS)
+#define ARENA_LARGE_ALIGN ((size_t) 1 << ARENA_MAP_SHIFT)
+
+// keeps cells 16 byte aligned
+#define ARENA_PAGE_HEADER ((sizeof(struct _arena_page) + 15) & ~((size_t) 15))
+
+static uint8_t * arena_map[ARENA_MAP_LEAF];
+
+
+static uint8_t * arena_map_entry (uintptr_t address, int create)
+{
+    uintptr_t page = address >> ARENA_MAP_SHIFT;
+    uintptr_t top  = page >> ARENA_MAP_BITS;
+    uint8_t * leaf;
+    uint8_t * expected = NULL;
+
+    if (top >= ARENA_MAP_LEAF)
+        return NULL;
+
+    leaf = __atomic_load_n(&(arena_map[top]), __ATOMIC_ACQUIRE);
+    if ((leaf == NULL) && create) {
+        leaf = calloc(ARENA_MAP_LEAF, 1);
+        if (! __atomic_compare_exchange_n(&(arena_map[top]), &expected, leaf, 0,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            free(leaf);
+            leaf = expected;
+        }
+    }
+    if (leaf == NULL)
+        return NULL;
+
+    return &(leaf[page & (ARENA_MAP_LEAF - 1)]);
+}
+
+
+// marks pages 4K pages from address. returns -1 if address can not be mapped
+static int arena_map_set (void * address, size_t pages, uint8_t type)
+{
+    uint8_t * entry;
+    size_t    i;
+
+    for (i = 0; i < pages; i++) {
+        entry = arena_map_entry((uintptr_t) address + (i << ARENA_MAP_SHIFT), 1);
+        if (entry == NULL)
+            return -1;
+        __atomic_store_n(entry, type, __ATOMIC_RELEASE);
+    }
+
+    return 0;
+}
+
+
+static struct _arena_page * arena_page_of (const void * ptr)
+{
+    uint8_t * entry = arena_map_entry((uintptr_t) ptr, 0);
+
+    if (entry == NULL)
+        return NULL;
+
+    switch (__atomic_load_n(entry, __ATOMIC_ACQUIRE)) {
+    case ARENA_MAP_SLAB :
+        return (struct _arena_page *)
+                   ((uintptr_t) ptr & ~((uintptr_t) ARENA_PAGE_SIZE - 1));
+    case ARENA_MAP_LARGE :
+        return (struct _arena_page *)
+                   ((uintptr_t) ptr & ~((uintptr_t) ARENA_LARGE_ALIGN - 1));
+    }
+
+    return NULL;
+}
+
+
+
+struct _arena * arena_create ()
+{
+    struct _arena * arena;
+    size_t i;
+
+    arena = (struct _arena *) malloc(sizeof(struct _arena));
+    arena->object    = &arena_object;
+    arena->refs      = 1;
+    arena->live      = 0;
+    arena->pages     = NULL;
+    arena->held      = NULL;
+    arena->held_n    = 0;
+    arena->held_bits = 0;
+
+    for (i = 0; i < ARENA_SLABS; i++) {
+        if (i < ARENA_SMALL_SIZE / ARENA_GRANULE)
+            arena->slabs[i].size = (i + 1) * ARENA_GRANULE;
+        else
+            arena->slabs[i].size =   (ARENA_SMALL_SIZE * 2)
+                                   << (i - (ARENA_SMALL_SIZE / ARENA_GRANULE));
+        arena->slabs[i].free = NULL;
+        arena->slabs[i].top  = NULL;
+        arena->slabs[i].end  = NULL;
+    }
+
+    return arena;
+}
+
+
+static void arena_page_link (struct _arena * arena, struct _arena_page * page)
+{
+    page->arena = arena;
+    page->prev  = NULL;
+    page->next  = arena->pages;
+    if (arena->pages != NULL)
+        arena->pages->prev = page;
+    arena->pages = page;
+}
+
+
+static void arena_page_free (struct _arena_page * page)
+{
+    if (page->slab != NULL)
+        arena_map_set(page, ARENA_PAGE_SIZE >> ARENA_MAP_SHIFT, ARENA_MAP_NONE);
+    else
+        arena_map_set(page, 1, ARENA_MAP_NONE);
+    free(page);
+}
+
+
+// frees arena and its pages, then gives back what it held. when dropping,
+// arenas it held are dropped
+static void arena_destroy (struct _arena * arena, int drop)
+{
+    struct _arena_page * page;
+    struct _arena_page * next;
+    const void        ** held   = arena->held;
+    size_t               slots  = (size_t) 1 << arena->held_bits;
+    size_t               i;
+
+    for (page = arena->pages; page != NULL; page = next) {
+        next = page->next;
+        arena_page_free(page);
+    }
+
+    if (bound_arena == arena)
+        bound_arena = NULL;
+
+    free(arena);
+
+    if (held == NULL)
+        return;
+
+    for (i = 0; i < slots; i++) {
+        const struct _object_header * header = held[i];
+        if (header == NULL)
+            continue;
+        if (drop && (header->object == &arena_object))
+            arena_drop((struct _arena *) header);
+        else
+            object_release((void *) header);
+    }
+    free(held);
+}
+
+
+// called when the last reference is dropped. allocations which are still
+// alive keep the arena's memory around until they are freed
+void arena_delete (struct _arena * arena)
+{
+    if (arena->live == 0)
+        arena_destroy(arena, 0);
+}
+
+
+void arena_drop (struct _arena * arena)
+{
+    arena_destroy(arena, 1);
+}
+
+
+
+static size_t arena_held_slot (const void * object, unsigned int bits)
+{
+    uint64_t hash = (uint64_t) (uintptr_t) object * 0x9e3779b97f4a7c15ULL;
+
+    return (size_t) (hash >> (64 - bits));
+}
+
+
+void arena_hold (struct _arena * arena, const void * object)
+{
+    const void ** old   = arena->held;
+    size_t        slots = (size_t) 1 << arena->held_bits;
+    size_t        slot;
+    size_t        i;
+
+    if (old != NULL) {
+        slot = arena_held_slot(object, arena->held_bits);
+        while (old[slot] != NULL) {
+            if (old[slot] == object)
+                return;
+            slot = (slot + 1) & (slots - 1);
+        }
+    }
+
+    // keep the set at most half full
+    if ((old == NULL) || ((arena->held_n + 1) * 2 > slots)) {
+        arena->held_bits = (old == NULL) ? 4 : arena->held_bits + 1;
+        arena->held      = calloc((size_t) 1 << arena->held_bits, sizeof(void *));
+        for (i = 0; (old != NULL) && (i < slots); i++) {
+            if (old[i] == NULL)
+                continue;
+            slot = arena_held_slot(old[i], arena->held_bits);
+            while (arena->held[slot] != NULL)
+                slot = (slot + 1) & (((size_t) 1 << arena->held_bits) - 1);
+            arena->held[slot] = old[i];
+        }
+        free(old);
+    }
+
+    slot = arena_held_slot(object, arena->held_bits);
+    while (arena->held[slot] != NULL)
+        slot = (slot + 1) & (((size_t) 1 << arena->held_bits) - 1);
+    arena->held[slot] = object_retain(object);
+    arena->held_n++;
+}
+
+
+
+struct _arena * arena_of (const void * ptr)
+{
+    struct _arena_page * page = arena_page_of(ptr);
+
+    if (page == NULL)
+        return NULL;
+    return page->arena;
+}
+
+
+
+struct _arena * arena_bind (struct _arena * arena)
+{
+    struct _arena * previous = bound_arena;
+    bound_arena = arena;
+    return previous;
+}
+
+
+
+// a page of its own for one allocation, aligned so its first 4K page finds
+// it in the page map
+static void * arena_alloc_large (struct _arena * arena, size_t size)
+{
+    struct _arena_page * page;
+    size_t               page_size;
+
+    page_size = (ARENA_PAGE_HEADER + size + ARENA_LARGE_ALIGN - 1)
+                & ~(ARENA_LARGE_ALIGN - 1);
+
+    if (posix_memalign((void **) &page, ARENA_LARGE_ALIGN, page_size) != 0)
+        return NULL;
+    if (arena_map_set(page, 1, ARENA_MAP_LARGE) != 0) {
+        free(page);
+        return malloc(size);
+    }
+
+    page->slab = NULL;
+    arena_page_link(arena, page);
+    arena->live++;
+
+    return ((char *) page) + ARENA_PAGE_HEADER;
+}
+
+
+static struct _arena_slab * arena_slab (struct _arena * arena, size_t size)
+{
+    size_t i;
+    size_t class_size;
+
+    if (size <= ARENA_SMALL_SIZE)
+        return &(arena->slabs[(size - 1) / ARENA_GRANULE]);
+
+    i = ARENA_SMALL_SIZE / ARENA_GRANULE;
+    for (class_size = ARENA_SMALL_SIZE * 2; class_size < size; class_size <<= 1)
+        i++;
+
+    return &(arena->slabs[i]);
+}
+
+
+void * mem_alloc (size_t size)
+{
+    struct _arena      * arena = bound_arena;
+    struct _arena_slab * slab;
+    struct _arena_page * page;
+    void              ** cell;
+
+    if (arena == NULL)
+        return malloc(size);
+
+    if (size > ARENA_MAX_SIZE)
+        return arena_alloc_large(arena, size);
+
+    if (size == 0)
+        size = 1;
+    slab = arena_slab(arena, size);
+
+    if (slab->free != NULL) {
+        cell       = slab->free;
+        slab->free = cell[0];
+    }
+    else {
+        if ((size_t) (slab->end - slab->top) < slab->size) {
+            if (posix_memalign((void **) &page, ARENA_PAGE_SIZE, ARENA_PAGE_SIZE) != 0)
+                return NULL;
+            if (arena_map_set(page,
+                              ARENA_PAGE_SIZE >> ARENA_MAP_SHIFT,
+                              ARENA_MAP_SLAB) != 0) {
+                free(page);
+                return malloc(size);
+            }
+            page->slab = slab;
+            arena_page_link(arena, page);
+            slab->top = ((char *) page) + ARENA_PAGE_HEADER;
+            slab->end = ((char *) page) + ARENA_PAGE_SIZE;
+        }
+
+        cell = (void **) slab->top;
+        slab->top += slab->size;
+    }
+
+    arena->live++;
+
+    return cell;
+}
+
+
+void mem_free (void * ptr)
+{
+    struct _arena_page * page;
+    struct _arena      * arena;
+    void              ** cell;
+
+    if (ptr == NULL)
+        return;
+
+    page = arena_page_of(ptr);
+    if (page == NULL) {
+        free(ptr);
+        return;
+    }
+
+    arena = page->arena;
+
+    if (page->slab == NULL) {
+        if (page->prev != NULL)
+            page->prev->next = page->next;
+        else
+            arena->pages = page->next;
+        if (page->next != NULL)
+            page->next->prev = page->prev;
+        arena_page_free(page);
+    }
+    else {
+        cell             = ptr;
+        cell[0]          = page->slab->free;
+        page->slab->free = cell;
+    }
+
+    arena->live--;
+    if ((arena->live == 0) && (arena->refs == 0))
+        arena_destroy(arena, 0);
+}
+
+
+
+void * mem_retain (const void * holder, const void * object)
+{
+    struct _arena * arena = arena_of(holder);
+
+    if ((arena == NULL) || (arena_of(object) == arena))
+        return object_retain(object);
+
+    arena_hold(arena, object);
+
+    return (void *) object;
+}
+
+
+void mem_release (const void * holder, void * object)
+{
+    struct _arena * arena = arena_of(holder);
+
+    if ((arena == NULL) || (arena_of(object) == arena))
+        object_release(object);
+}
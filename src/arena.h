@@ -0,0 +1,117 @@
+#ifndef arena_HEADER
+#define arena_HEADER
+
+/*
+* An arena hands out small allocations from pages of one size each, keeping
+* a free list for each size so memory is reused without going back to
+* malloc. Larger allocations get pages of their own.
+*
+* An analysis binds an arena while it runs. Containers and analysis objects
+* allocate with mem_alloc, which draws from the bound arena, or from malloc
+* when no arena is bound. mem_free returns memory to wherever it came from,
+* so objects may outlive the binding and be freed at any time. Arena pages
+* are found by address in a page map, so memory from malloc carries nothing
+* extra.
+*
+* Arenas are objects. An arena's pages are handed back to the system all at
+* once, when the last reference to the arena is gone and every allocation
+* made from it has been freed.
+*
+* An arena may also be dropped with arena_drop, which frees every page
+* without deleting the objects in them. Objects in an arena take references
+* to objects outside it with mem_retain, which leaves the reference to the
+* arena (arena_hold) instead of counting it, so the arena gives back every
+* outside reference in one pass when it goes. References counted in the
+* usual way, such as those containers take, must be to objects which go
+* with the arena. An arena held by an arena is dropped with it, so an
+* analysis which makes arenas of its own has its arena hold them, and then
+* its whole session goes in one arena_drop.
+*
+* Bindings are per thread, and an arena is not itself thread-safe. Threads
+* working at once each bind an arena of their own, and must not free into
+* each other's arenas until they are done. Anything threads share should
+* be allocated with no arena bound, or from an arena under a lock.
+*/
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "object.h"
+
+// small allocations come from pages of ARENA_PAGE_SIZE bytes, aligned to
+// their size. sizes up to 256 bytes go in steps of ARENA_GRANULE, and up to
+// ARENA_MAX_SIZE in powers of two
+#define ARENA_PAGE_SIZE  (64 * 1024)
+#define ARENA_GRANULE    8
+#define ARENA_SMALL_SIZE 256
+#define ARENA_MAX_SIZE   4096
+#define ARENA_SLABS      ((ARENA_SMALL_SIZE / ARENA_GRANULE) + 4)
+
+// the page map records which 4K pages of memory belong to arenas
+#define ARENA_MAP_SHIFT  12
+#define ARENA_MAP_BITS   18
+
+struct _arena;
+
+// every arena page begins with one of these
+struct _arena_page {
+    struct _arena      * arena;
+    // NULL for a page holding one large allocation
+    struct _arena_slab * slab;
+    struct _arena_page * next;
+    struct _arena_page * prev;
+};
+
+struct _arena_slab {
+    size_t size;
+    // free cells are linked through their first word
+    void * free;
+    char * top;
+    char * end;
+};
+
+struct _arena {
+    const struct _object * object;
+    unsigned int           refs;
+    size_t                 live;
+    struct _arena_page   * pages;
+    // objects held by the arena, a set of 1 << held_bits slots
+    const void          ** held;
+    size_t                 held_n;
+    unsigned int           held_bits;
+    struct _arena_slab     slabs[ARENA_SLABS];
+};
+
+
+struct _arena * arena_create ();
+void            arena_delete (struct _arena * arena);
+
+// frees every allocation made from arena at once, without deleting the
+// objects in them, and gives back what arena holds. arenas it holds are
+// dropped too. arena goes whatever its reference count, so nothing may
+// reach arena or anything allocated from it afterwards, and it must not be
+// held by another arena
+void            arena_drop   (struct _arena * arena);
+
+// arena takes a reference to object, unless it holds one already, and
+// releases it when the arena goes. object must not be in arena
+void            arena_hold   (struct _arena * arena, const void * object);
+
+// returns the arena ptr was allocated from, or NULL for memory from malloc
+struct _arena * arena_of     (const void * ptr);
+
+// binds arena for future calls to mem_alloc on this thread, returning the
+// arena which was bound before. binding NULL makes mem_alloc use malloc
+struct _arena * arena_bind   (struct _arena * arena);
+
+void * mem_alloc (size_t size);
+void   mem_free  (void * ptr);
+
+// for an object, holder, taking a reference to another. when holder is in
+// an arena and object is not, the arena holds object instead of holder, and
+// mem_release leaves it to the arena. otherwise these are object_retain and
+// object_release
+void * mem_retain  (const void * holder, const void * object);
+void   mem_release (const void * holder, void * object);
+
+#endif
@@ -0,0 +1,242 @@
+// compares forming basic blocks with ins_graph_to_list_ins_graph and
+// graph_reduce against ins_graph_to_block_graph
+//
+// usage: block_bench [max_exponent]
+// runs each for functions of 10^3 instructions up to 10^max_exponent
+// instructions (default 5). both must form the same blocks, with their edges
+// in the same order, or the bench fails
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "fgraph.h"
+#include "graph.h"
+#include "instruction.h"
+#include "util.h"
+#include "vector.h"
+
+#define MIN_EXPONENT 3
+#define DEFAULT_MAX_EXPONENT 5
+
+// agreement is checked on this many functions of up to CHECK_MAX_SIZE
+// instructions before timing
+#define CHECK_FUNCTIONS 3000
+#define CHECK_MAX_SIZE  200
+
+// branches land within this many instructions of where they start
+#define BRANCH_WINDOW 64
+
+
+static double now ()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec / 1000000000.0);
+}
+
+
+static uint64_t address (size_t i)
+{
+    return 0x400000 + (i * 4);
+}
+
+
+static size_t branch_target (size_t i, size_t n)
+{
+    size_t low = (i < BRANCH_WINDOW) ? 0 : i - BRANCH_WINDOW;
+    size_t high = (i + BRANCH_WINDOW < n) ? i + BRANCH_WINDOW : n - 1;
+
+    return low + (rand() % (high - low + 1));
+}
+
+
+// a function of n instructions, mostly straight-line code broken up by
+// conditional and unconditional branches, calls and returns
+static struct _fgraph * synthetic_function (size_t n)
+{
+    uint64_t      * indices = (uint64_t *) calloc(n, sizeof(uint64_t));
+    void         ** data    = (void **) malloc(sizeof(void *) * n);
+    uint8_t         bytes[4] = {0x90, 0x90, 0x90, 0x90};
+    struct _graph * graph;
+    size_t          i, j;
+
+    for (i = 0; i < n; i++) {
+        struct _ins * ins = ins_create(address(i), bytes, 4, "nop", NULL);
+        int kind = rand() % 10;
+
+        if (i == n - 1)
+            kind = 9;
+
+        if (kind < 5)
+            ins_add_successor(ins, address(i + 1), INS_SUC_NORMAL);
+        else if (kind < 7) {
+            ins_add_successor(ins, address(i + 1), INS_SUC_JCC_FALSE);
+            ins_add_successor(ins, address(branch_target(i, n)), INS_SUC_JCC_TRUE);
+        }
+        else if (kind < 8)
+            ins_add_successor(ins, address(branch_target(i, n)), INS_SUC_JUMP);
+        else if (kind < 9) {
+            ins_add_successor(ins, address(i + 1), INS_SUC_NORMAL);
+            ins_add_successor(ins, 0x1000, INS_SUC_CALL);
+        }
+
+        indices[i] = address(i);
+        data[i]    = ins;
+    }
+
+    graph = graph_build_sorted(indices, data, n);
+
+    for (i = 0; i < n; i++) {
+        struct _ins * ins = graph_fetch_data(graph, address(i));
+        for (j = 0; j < ins->successors->size; j++) {
+            struct _ins_value * successor = ins->successors->items[j];
+            if (successor->type == INS_SUC_CALL)
+                continue;
+            graph_add_edge(graph, ins->address, successor->address, successor);
+        }
+    }
+
+    struct _fgraph * fgraph = graph_freeze(graph);
+
+    object_delete(graph);
+    free(indices);
+    free(data);
+
+    return fgraph;
+}
+
+
+// returns 1 if two lists of edges differ, in their nodes, data or order
+static int edges_differ (const struct _fgraph_edge * lhs, size_t lhs_n,
+                         const struct _fgraph_edge * rhs, size_t rhs_n)
+{
+    size_t i;
+
+    if (lhs_n != rhs_n)
+        return 1;
+    for (i = 0; i < lhs_n; i++) {
+        if ((lhs[i].node != rhs[i].node) || (lhs[i].data != rhs[i].data))
+            return 1;
+    }
+    return 0;
+}
+
+
+// returns 1 if node i of lhs and rhs differs in its block or edges
+static int block_differs (const struct _fgraph * lhs,
+                          const struct _fgraph * rhs,
+                          size_t i)
+{
+    const struct _vector * lblock = lhs->nodes[i].data;
+    const struct _vector * rblock = rhs->nodes[i].data;
+    size_t j;
+
+    if (    (lhs->nodes[i].index != rhs->nodes[i].index)
+         || (lblock->size != rblock->size))
+        return 1;
+    for (j = 0; j < lblock->size; j++) {
+        if (lblock->items[j] != rblock->items[j])
+            return 1;
+    }
+
+    return    edges_differ(fgraph_successors(lhs, i),
+                           fgraph_successors_n(lhs, i),
+                           fgraph_successors(rhs, i),
+                           fgraph_successors_n(rhs, i))
+           || edges_differ(fgraph_predecessors(lhs, i),
+                           fgraph_predecessors_n(lhs, i),
+                           fgraph_predecessors(rhs, i),
+                           fgraph_predecessors_n(rhs, i));
+}
+
+
+// returns 1, after saying where, if the two block graphs differ in their
+// blocks or in the order of any block's edges, which rdg lays out by
+static int graphs_differ (const struct _graph * reduced,
+                          const struct _graph * blocks)
+{
+    struct _fgraph * lhs = graph_freeze(reduced);
+    struct _fgraph * rhs = graph_freeze(blocks);
+    int              differs = 0;
+    size_t           i;
+
+    if (lhs->size != rhs->size) {
+        printf("%zu blocks reduced, %zu blocks\n", lhs->size, rhs->size);
+        differs = 1;
+    }
+    for (i = 0; (! differs) && (i < lhs->size); i++) {
+        if (block_differs(lhs, rhs, i)) {
+            printf("block %llx differs\n",
+                   (unsigned long long) lhs->nodes[i].index);
+            differs = 1;
+        }
+    }
+
+    objects_delete(lhs, rhs, NULL);
+
+    return differs;
+}
+
+
+static void report (const char * name, size_t n, size_t blocks,
+                    double start, double end)
+{
+    printf("%-8s %9zu ins %9zu blocks %10.3f ms %8.1f ns/ins\n",
+           name, n, blocks, (end - start) * 1000.0,
+           ((end - start) * 1000000000.0) / n);
+}
+
+
+int main (int argc, char * argv[])
+{
+    int max_exponent = DEFAULT_MAX_EXPONENT;
+    int exponent;
+    int differences = 0;
+    size_t n = 1;
+    size_t i;
+
+    if (argc > 1)
+        max_exponent = atoi(argv[1]);
+
+    // small functions first, where every kind of run turns up often
+    for (i = 0; i < CHECK_FUNCTIONS; i++) {
+        size_t           size     = 1 + (rand() % CHECK_MAX_SIZE);
+        struct _fgraph * function = synthetic_function(size);
+        struct _graph  * reduced  = ins_graph_to_list_ins_graph(function);
+        struct _graph  * blocks   = ins_graph_to_block_graph(function);
+
+        graph_reduce(reduced);
+        differences += graphs_differ(reduced, blocks);
+
+        objects_delete(reduced, blocks, function, NULL);
+    }
+    printf("%d of %d small functions differ\n\n", differences, CHECK_FUNCTIONS);
+
+    for (exponent = 0; exponent <= max_exponent; exponent++) {
+        if (exponent >= MIN_EXPONENT) {
+            struct _fgraph * function = synthetic_function(n);
+            struct _graph  * reduced;
+            struct _graph  * blocks;
+            double           start;
+
+            start = now();
+            reduced = ins_graph_to_list_ins_graph(function);
+            graph_reduce(reduced);
+            report("reduce", n, reduced->size, start, now());
+
+            start = now();
+            blocks = ins_graph_to_block_graph(function);
+            report("blocks", n, blocks->size, start, now());
+
+            differences += graphs_differ(reduced, blocks);
+
+            printf("\n");
+            objects_delete(reduced, blocks, function, NULL);
+        }
+        n *= 10;
+    }
+
+    return differences ? 1 : 0;
+}
@@ -0,0 +1,210 @@
+// checks block_disassemble against recursive_disassemble on code for a
+// made-up instruction set whose branches may land in the middle of other
+// instructions, as jumping over an x86 lock prefix does
+//
+// usage: block_dis_check [functions]
+// checks a hand-written function, then that many random ones (default
+// 1000). every instruction must be in exactly one block, blocks must be
+// straight-line runs, and each branch target must start a block
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "block_dis.h"
+#include "buffer.h"
+#include "hashmap.h"
+#include "recursive_dis.h"
+#include "vector.h"
+
+#define DEFAULT_FUNCTIONS 1000
+
+#define BASE 0x1000
+#define SIZE 256
+
+enum {
+    OP_NEXT,
+    OP_JCC,
+    OP_JMP,
+    OP_RET
+};
+
+// what decodes at each offset, so instructions may overlap
+struct _op {
+    uint8_t  size;
+    int      kind;
+    uint64_t target;
+};
+
+static struct _op ops[SIZE];
+
+
+// returns 1 if an instruction decodes at address
+static int decodes (uint64_t address)
+{
+    if ((address < BASE) || (address >= BASE + SIZE))
+        return 0;
+    return address + ops[address - BASE].size <= BASE + SIZE;
+}
+
+
+static struct _ins * decode (const struct _map * mem_map, uint64_t address)
+{
+    struct _buffer * buf = map_fetch_max(mem_map, address);
+    struct _op     * op;
+    struct _ins    * ins;
+
+    if (! decodes(address))
+        return NULL;
+    op = &(ops[address - BASE]);
+
+    ins = ins_create_view(address, buf, address - BASE, op->size, "op", NULL);
+
+    switch (op->kind) {
+    case OP_NEXT :
+        ins_add_successor(ins, address + op->size, INS_SUC_NORMAL);
+        break;
+    case OP_JCC :
+        ins_add_successor(ins, address + op->size, INS_SUC_JCC_FALSE);
+        ins_add_successor(ins, op->target, INS_SUC_JCC_TRUE);
+        break;
+    case OP_JMP :
+        ins_add_successor(ins, op->target, INS_SUC_JUMP);
+        break;
+    }
+
+    return ins;
+}
+
+
+static void set_op (uint64_t address, uint8_t size, int kind, uint64_t target)
+{
+    ops[address - BASE].size   = size;
+    ops[address - BASE].kind   = kind;
+    ops[address - BASE].target = target;
+}
+
+
+// 1003 is reached by a jump after a block was decoded from 1002, in the
+// middle of 1001
+static void hand_written ()
+{
+    size_t i;
+
+    for (i = 0; i < SIZE; i++)
+        set_op(BASE + i, 1, OP_RET, 0);
+
+    set_op(0x1000, 1, OP_NEXT, 0);
+    set_op(0x1001, 2, OP_NEXT, 0);
+    set_op(0x1002, 2, OP_NEXT, 0);
+    set_op(0x1003, 1, OP_NEXT, 0);
+    set_op(0x1004, 1, OP_JCC,  0x1002);
+    set_op(0x1005, 1, OP_JMP,  0x1003);
+}
+
+
+static void random_ops ()
+{
+    size_t i;
+
+    for (i = 0; i < SIZE; i++) {
+        int r = rand() % 10;
+        set_op(BASE + i,
+               1 + (rand() % 4),
+               (r < 5) ? OP_NEXT : (r < 7) ? OP_JCC : (r < 8) ? OP_JMP : OP_RET,
+               BASE + (rand() % SIZE));
+    }
+}
+
+
+// returns the number of problems found
+static int check (const struct _map * mem_map, const char * name)
+{
+    struct _graph    * ins_graph   = recursive_disassemble(mem_map, BASE, decode);
+    struct _graph    * block_graph = block_disassemble(mem_map, BASE, decode);
+    struct _hashmap  * seen        = hashmap_create();
+    struct _graph_it * it;
+    int                errors      = 0;
+    size_t             instructions = 0;
+    size_t             i, j;
+
+    for (it = graph_iterator(block_graph); it != NULL; it = graph_it_next(it)) {
+        struct _vector * block = graph_it_data(it);
+        for (i = 0; i < block->size; i++) {
+            struct _ins * ins = block->items[i];
+            instructions++;
+
+            if (hashmap_insert(seen, ins->address, NULL)) {
+                printf("%s: %llx is in more than one block\n",
+                       name, (unsigned long long) ins->address);
+                errors++;
+            }
+            if (graph_fetch_node(ins_graph, ins->address) == NULL) {
+                printf("%s: %llx is not reachable\n",
+                       name, (unsigned long long) ins->address);
+                errors++;
+            }
+            if (    (i + 1 < block->size)
+                 && (((struct _ins *) block->items[i + 1])->address
+                     != ins->address + ins->size)) {
+                printf("%s: block %llx is not a straight-line run\n",
+                       name, (unsigned long long) graph_it_index(it));
+                errors++;
+            }
+        }
+
+        struct _ins * last = block->items[block->size - 1];
+        for (j = 0; j < last->successors->size; j++) {
+            struct _ins_value * successor = last->successors->items[j];
+            if (    decodes(successor->address)
+                 && (graph_fetch_node(block_graph, successor->address) == NULL)) {
+                printf("%s: branch target %llx does not start a block\n",
+                       name, (unsigned long long) successor->address);
+                errors++;
+            }
+        }
+    }
+
+    if (instructions != ins_graph->size) {
+        printf("%s: %zu instructions in blocks, %zu reachable\n",
+               name, instructions, ins_graph->size);
+        errors++;
+    }
+
+    objects_delete(ins_graph, block_graph, seen, NULL);
+
+    return errors;
+}
+
+
+int main (int argc, char * argv[])
+{
+    int functions = DEFAULT_FUNCTIONS;
+    int errors    = 0;
+    int i;
+
+    if (argc > 1)
+        functions = atoi(argv[1]);
+
+    uint8_t bytes[SIZE] = {0};
+    struct _buffer * buf     = buffer_create(bytes, SIZE);
+    struct _map    * mem_map = map_create();
+    map_insert(mem_map, BASE, buf);
+    object_delete(buf);
+
+    hand_written();
+    errors += check(mem_map, "hand written");
+
+    for (i = 0; i < functions; i++) {
+        char name[32];
+        snprintf(name, 32, "random %d", i);
+        random_ops();
+        errors += check(mem_map, name);
+    }
+
+    object_delete(mem_map);
+
+    printf("%d functions checked, %d problems\n", functions + 1, errors);
+
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,137 @@
+// compares the AA-tree, B+tree and persistent AA-tree backends of _map
+//
+// usage: map_bench [max_exponent]
+// runs each benchmark for 10^3 keys up to 10^max_exponent keys (default 7)
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "index.h"
+#include "map.h"
+
+#define MIN_EXPONENT 3
+#define DEFAULT_MAX_EXPONENT 7
+
+
+static double now ()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec / 1000000000.0);
+}
+
+
+// keys look like instruction addresses, 16 bytes apart
+static uint64_t * shuffled_keys (size_t n)
+{
+    uint64_t * keys = (uint64_t *) malloc(sizeof(uint64_t) * n);
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        keys[i] = 0x400000 + (i * 16);
+
+    for (i = n - 1; i > 0; i--) {
+        size_t j = ((size_t) rand() * (RAND_MAX + 1UL) + rand()) % (i + 1);
+        uint64_t tmp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = tmp;
+    }
+
+    return keys;
+}
+
+
+static void report (const char * backend, const char * name, size_t n,
+                    double start, double end)
+{
+    printf("%-6s %-14s %9zu %10.1f ns/op\n",
+           backend, name, n, ((end - start) * 1000000000.0) / n);
+}
+
+
+static void bench (const char * backend,
+                   struct _map * (* create) (),
+                   size_t n,
+                   const uint64_t * keys,
+                   const struct _index * value)
+{
+    struct _map    * map;
+    struct _map_it * it;
+    double           start;
+    size_t           i;
+    uint64_t         sum = 0;
+
+    map = create();
+    start = now();
+    for (i = 0; i < n; i++)
+        map_insert(map, 0x400000 + (i * 16), value);
+    report(backend, "insert_seq", n, start, now());
+    object_delete(map);
+
+    map = create();
+    start = now();
+    for (i = 0; i < n; i++)
+        map_insert(map, keys[i], value);
+    report(backend, "insert_random", n, start, now());
+
+    start = now();
+    for (i = 0; i < n; i++) {
+        if (map_fetch(map, keys[n - i - 1]) != NULL)
+            sum++;
+    }
+    report(backend, "fetch", n, start, now());
+
+    // every key falls between two entries
+    start = now();
+    for (i = 0; i < n; i++)
+        sum += map_fetch_max_key(map, keys[i] + 8);
+    report(backend, "fetch_max", n, start, now());
+
+    start = now();
+    for (it = map_iterator(map); it != NULL; it = map_it_next(it))
+        sum += map_it_key(it);
+    report(backend, "iterate", n, start, now());
+
+    start = now();
+    for (i = 0; i < n; i++)
+        map_remove(map, keys[i]);
+    report(backend, "remove", n, start, now());
+
+    object_delete(map);
+
+    // keep the loops from being optimized away
+    if (sum == 0)
+        printf("\n");
+}
+
+
+int main (int argc, char * argv[])
+{
+    int max_exponent = DEFAULT_MAX_EXPONENT;
+    int exponent;
+    size_t n = 1;
+
+    if (argc > 1)
+        max_exponent = atoi(argv[1]);
+
+    // every entry shares one value so only the containers are measured
+    struct _index * value = index_create(0);
+
+    for (exponent = 0; exponent <= max_exponent; exponent++) {
+        if (exponent >= MIN_EXPONENT) {
+            uint64_t * keys = shuffled_keys(n);
+            bench("aa",    map_create,       n, keys, value);
+            bench("btree", map_create_btree, n, keys, value);
+            bench("ptree", map_create_persistent, n, keys, value);
+            printf("\n");
+            free(keys);
+        }
+        n *= 10;
+    }
+
+    object_delete(value);
+
+    return 0;
+}
@@ -0,0 +1,228 @@
+// inserts and deletes a large number of keys in an AA-tree, first in
+// ascending order and then shuffled. each run is timed twice, once with
+// tree.c and once with the recursive insert and delete tree.c used before
+// they were made iterative, which are kept below as the baseline
+//
+// usage: tree_stress [keys]
+// defaults to 50 million keys. every key is kept in one array, so this
+// needs a few gigabytes of memory at the default size
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "arena.h"
+#include "index.h"
+#include "tree.h"
+
+#define DEFAULT_KEYS 50000000
+
+
+static double now ()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ((double) ts.tv_nsec / 1000000000.0);
+}
+
+
+static void shuffle (struct _index ** keys, size_t n)
+{
+    size_t i;
+
+    for (i = n - 1; i > 0; i--) {
+        size_t j = ((size_t) rand() * (RAND_MAX + 1UL) + rand()) % (i + 1);
+        struct _index * tmp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = tmp;
+    }
+}
+
+
+/*
+* the recursive AA-tree, as tree.c had it. skew and split are shared, so
+* both trees are rebalanced in the same way
+*/
+
+static struct _tree_node * rec_node_insert (struct _tree_node * node,
+                                            struct _tree_node * new_node)
+{
+    if (node == NULL)
+        return new_node;
+    else if (object_cmp(new_node->data, node->data) < 0)
+        node->left  = rec_node_insert(node->left,  new_node);
+    else
+        node->right = rec_node_insert(node->right, new_node);
+
+    node = tree_node_skew (node);
+    node = tree_node_split(node);
+
+    return node;
+}
+
+
+static struct _tree_node * rec_node_decrease_level (struct _tree_node * node)
+{
+    unsigned int should_be;
+
+    if ((node->left == NULL) || (node->right == NULL))
+        return node;
+
+    should_be =   node->left->level < node->right->level 
+                ? node->left->level : node->right->level;
+    should_be++;
+
+    if (should_be < node->level) {
+        node->level = should_be;
+        if (should_be < node->right->level)
+            node->right->level = should_be;
+    }
+
+    return node;
+}
+
+
+static struct _tree_node * rec_node_delete (struct _tree_node * node,
+                                            const void * data)
+{
+    struct _tree_node * tmp;
+
+    if (node == NULL)
+        return node;
+    if (object_cmp(data, node->data) < 0)
+        node->left = rec_node_delete(node->left, data);
+    else if (object_cmp(data, node->data) > 0)
+        node->right = rec_node_delete(node->right, data);
+    else {
+        if ((node->left == NULL) && (node->right == NULL)) {
+            object_delete(node->data);
+            mem_free(node);
+            return NULL;
+        }
+        else if (node->left == NULL) {
+            for (tmp = node->right; tmp->left != NULL; tmp = tmp->left) ;
+            object_delete(node->data);
+            node->data = object_retain(tmp->data);
+            node->right = rec_node_delete(node->right, tmp->data);
+        }
+        else {
+            for (tmp = node->left; tmp->right != NULL; tmp = tmp->right) ;
+            object_delete(node->data);
+            node->data = object_retain(tmp->data);
+            node->left = rec_node_delete(node->left, tmp->data);
+        }
+    }
+
+    node = rec_node_decrease_level(node);
+    node = tree_node_skew(node);
+    if (node->right != NULL) {
+        node->right = tree_node_skew(node->right);
+        if (node->right->right != NULL)
+            node->right->right = tree_node_skew(node->right->right);
+    }
+    node = tree_node_split(node);
+    if (node->right != NULL)
+        node->right = tree_node_split(node->right);
+
+    return node;
+}
+
+
+static void rec_insert (struct _tree * tree, const void * data)
+{
+    struct _tree_node * node;
+
+    node = tree_node_create(object_retain(data));
+    tree->nodes = rec_node_insert(tree->nodes, node);
+}
+
+
+static void rec_remove (struct _tree * tree, const void * data)
+{
+    tree->nodes = rec_node_delete(tree->nodes, data);
+}
+
+
+static void report (const char * name, size_t n, double start, double end)
+{
+    printf("%-14s %10zu %8.2f s %10.1f ns/op\n",
+           name, n, end - start, ((end - start) * 1000000000.0) / n);
+}
+
+
+static void run (const char * insert_name,
+                 const char * delete_name,
+                 void (* insert) (struct _tree *, const void *),
+                 void (* remove) (struct _tree *, const void *),
+                 struct _index ** keys,
+                 size_t n)
+{
+    struct _tree * tree;
+    double         start;
+    size_t         i;
+
+    tree = tree_create();
+
+    start = now();
+    for (i = 0; i < n; i++)
+        insert(tree, keys[i]);
+    report(insert_name, n, start, now());
+
+    start = now();
+    for (i = 0; i < n; i++)
+        remove(tree, keys[i]);
+    report(delete_name, n, start, now());
+
+    if (tree->nodes != NULL)
+        printf("tree not empty after deleting every key\n");
+
+    object_delete(tree);
+}
+
+
+int main (int argc, char * argv[])
+{
+    struct _index  * storage;
+    struct _index ** keys;
+    struct _index  * template;
+    struct _arena  * arena;
+    size_t           n = DEFAULT_KEYS;
+    size_t           i;
+
+    if (argc > 1)
+        n = strtoull(argv[1], NULL, 0);
+    if (n == 0)
+        return 0;
+
+    // the keys are laid out by hand rather than with index_create, so that
+    // building them costs little next to the tree. the tree holds a
+    // reference of its own, so these are never freed by it
+    template = index_create(0);
+    storage  = (struct _index *)   malloc(sizeof(struct _index)   * n);
+    keys     = (struct _index **)  malloc(sizeof(struct _index *) * n);
+    for (i = 0; i < n; i++) {
+        storage[i]       = *template;
+        storage[i].index = 0x400000 + (i * 16);
+        keys[i]          = &(storage[i]);
+    }
+
+    arena = arena_create();
+    arena_bind(arena);
+
+    run("insert_seq", "delete_seq", tree_insert, tree_remove, keys, n);
+    run("insert_seq_rec", "delete_seq_rec", rec_insert, rec_remove, keys, n);
+
+    shuffle(keys, n);
+    run("insert_random", "delete_random", tree_insert, tree_remove, keys, n);
+    run("insert_rnd_rec", "delete_rnd_rec", rec_insert, rec_remove, keys, n);
+
+    arena_bind(NULL);
+    object_delete(arena);
+
+    free(keys);
+    free(storage);
+    object_delete(template);
+
+    return 0;
+}
@@ -0,0 +1,624 @@
+#include "btree.h"
+
+#include "arena.h"
+
+#include <string.h>
+
+static const struct _object btree_object = {
+    (void     (*) (void *))       btree_delete,
+    (void *   (*) (const void *)) btree_copy,
+    NULL,
+    NULL
+};
+
+
+// number of keys in node < key
+static unsigned int btree_lower_bound (const struct _btree_node * node,
+                                       uint64_t key)
+{
+    unsigned int lo = 0;
+    unsigned int hi = node->size;
+    unsigned int mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (node->keys[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+
+// number of keys in node <= key
+static unsigned int btree_upper_bound (const struct _btree_node * node,
+                                       uint64_t key)
+{
+    unsigned int lo = 0;
+    unsigned int hi = node->size;
+    unsigned int mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (node->keys[mid] <= key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+
+
+static struct _btree_leaf * btree_leaf_create ()
+{
+    struct _btree_leaf * leaf;
+
+    leaf = (struct _btree_leaf *) mem_alloc(sizeof(struct _btree_leaf));
+    leaf->node.leaf = 1;
+    leaf->node.size = 0;
+    leaf->prev      = NULL;
+    leaf->next      = NULL;
+
+    return leaf;
+}
+
+
+static struct _btree_branch * btree_branch_create ()
+{
+    struct _btree_branch * branch;
+
+    branch = (struct _btree_branch *) mem_alloc(sizeof(struct _btree_branch));
+    branch->node.leaf = 0;
+    branch->node.size = 0;
+
+    return branch;
+}
+
+
+static void btree_node_delete (struct _btree_node * node)
+{
+    unsigned int i;
+
+    if (node->leaf) {
+        struct _btree_leaf * leaf = (struct _btree_leaf *) node;
+        for (i = 0; i < node->size; i++) {
+            if (leaf->values[i] != NULL)
+                object_delete(leaf->values[i]);
+        }
+    }
+    else {
+        struct _btree_branch * branch = (struct _btree_branch *) node;
+        for (i = 0; i <= node->size; i++)
+            btree_node_delete(branch->children[i]);
+    }
+
+    mem_free(node);
+}
+
+
+// last is the most recently copied leaf, so the copies can be linked up
+static struct _btree_node * btree_node_copy (const struct _btree_node * node,
+                                             struct _btree_leaf ** last)
+{
+    unsigned int i;
+
+    if (node->leaf) {
+        const struct _btree_leaf * leaf = (const struct _btree_leaf *) node;
+        struct _btree_leaf * new_leaf = btree_leaf_create();
+
+        new_leaf->node = leaf->node;
+        for (i = 0; i < node->size; i++) {
+            if (leaf->values[i] == NULL)
+                new_leaf->values[i] = NULL;
+            else
+                new_leaf->values[i] = object_retain(leaf->values[i]);
+        }
+
+        new_leaf->prev = *last;
+        if (*last != NULL)
+            (*last)->next = new_leaf;
+        *last = new_leaf;
+
+        return (struct _btree_node *) new_leaf;
+    }
+
+    const struct _btree_branch * branch = (const struct _btree_branch *) node;
+    struct _btree_branch * new_branch = btree_branch_create();
+
+    new_branch->node = branch->node;
+    for (i = 0; i <= node->size; i++)
+        new_branch->children[i] = btree_node_copy(branch->children[i], last);
+
+    return (struct _btree_node *) new_branch;
+}
+
+
+
+struct _btree * btree_create ()
+{
+    struct _btree * btree;
+
+    btree = (struct _btree *) mem_alloc(sizeof(struct _btree));
+    btree->object = &btree_object;
+    btree->refs   = 1;
+    btree->root   = (struct _btree_node *) btree_leaf_create();
+
+    return btree;
+}
+
+
+void btree_delete (struct _btree * btree)
+{
+    btree_node_delete(btree->root);
+    mem_free(btree);
+}
+
+
+struct _btree * btree_copy (const struct _btree * btree)
+{
+    struct _btree      * new_btree;
+    struct _btree_leaf * last = NULL;
+
+    new_btree = (struct _btree *) mem_alloc(sizeof(struct _btree));
+    new_btree->object = &btree_object;
+    new_btree->refs   = 1;
+    new_btree->root   = btree_node_copy(btree->root, &last);
+
+    return new_btree;
+}
+
+
+
+// fills the leaves left to right, then builds each row of branches over the
+// row beneath it. entries and children are spread evenly, so every node but
+// a lone root is at least half full
+struct _btree * btree_build_sorted (const uint64_t * keys,
+                                    void ** values,
+                                    size_t n)
+{
+    struct _btree        * btree;
+    struct _btree_node  ** row;
+    uint64_t             * firsts;
+    struct _btree_leaf   * leaf;
+    struct _btree_leaf   * prev = NULL;
+    struct _btree_branch * branch;
+    size_t                 count;
+    size_t                 parents;
+    size_t                 size;
+    size_t                 i, j, k;
+
+    btree = btree_create();
+    if (n == 0)
+        return btree;
+    btree_node_delete(btree->root);
+
+    count  = (n + BTREE_SLOTS - 1) / BTREE_SLOTS;
+    row    = (struct _btree_node **) mem_alloc(sizeof(void *) * count);
+    firsts = (uint64_t *) mem_alloc(sizeof(uint64_t) * count);
+
+    for (i = 0, k = 0; i < count; i++) {
+        size = (n / count) + (i < n % count ? 1 : 0);
+        leaf = btree_leaf_create();
+        leaf->node.size = size;
+        memcpy(leaf->node.keys, &(keys[k]),   sizeof(uint64_t) * size);
+        memcpy(leaf->values,    &(values[k]), sizeof(void *)   * size);
+        k += size;
+
+        leaf->prev = prev;
+        if (prev != NULL)
+            prev->next = leaf;
+        prev = leaf;
+
+        row[i]    = (struct _btree_node *) leaf;
+        firsts[i] = leaf->node.keys[0];
+    }
+
+    // row[i] and firsts[i] are overwritten only once the children they held
+    // have been taken
+    while (count > 1) {
+        parents = (count + BTREE_SLOTS) / (BTREE_SLOTS + 1);
+        for (i = 0, k = 0; i < parents; i++) {
+            size = (count / parents) + (i < count % parents ? 1 : 0);
+            branch = btree_branch_create();
+            branch->node.size = size - 1;
+            for (j = 0; j < size; j++) {
+                branch->children[j] = row[k + j];
+                if (j > 0)
+                    branch->node.keys[j - 1] = firsts[k + j];
+            }
+            firsts[i] = firsts[k];
+            row[i]    = (struct _btree_node *) branch;
+            k += size;
+        }
+        count = parents;
+    }
+
+    btree->root = row[0];
+
+    mem_free(firsts);
+    mem_free(row);
+
+    return btree;
+}
+
+
+
+// if leaf is full it is split, and the new right sibling is returned with
+// split_key set to its first key
+static struct _btree_node * btree_leaf_insert (struct _btree_leaf * leaf,
+                                               unsigned int pos,
+                                               uint64_t     key,
+                                               void       * value,
+                                               uint64_t   * split_key)
+{
+    struct _btree_leaf * right;
+    unsigned int half;
+
+    if (leaf->node.size < BTREE_SLOTS) {
+        memmove(&(leaf->node.keys[pos + 1]), &(leaf->node.keys[pos]),
+                sizeof(uint64_t) * (leaf->node.size - pos));
+        memmove(&(leaf->values[pos + 1]), &(leaf->values[pos]),
+                sizeof(void *) * (leaf->node.size - pos));
+        leaf->node.keys[pos] = key;
+        leaf->values[pos]    = value;
+        leaf->node.size++;
+        return NULL;
+    }
+
+    right = btree_leaf_create();
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next != NULL)
+        leaf->next->prev = right;
+    leaf->next = right;
+
+    // keys usually arrive in ascending order, so when appending to the last
+    // leaf leave it full instead of splitting it in half
+    if ((pos == BTREE_SLOTS) && (right->next == NULL))
+        half = BTREE_SLOTS;
+    else
+        half = BTREE_SLOTS / 2;
+
+    right->node.size = BTREE_SLOTS - half;
+    memcpy(right->node.keys, &(leaf->node.keys[half]),
+           sizeof(uint64_t) * right->node.size);
+    memcpy(right->values, &(leaf->values[half]),
+           sizeof(void *) * right->node.size);
+    leaf->node.size = half;
+
+    if (pos < half)
+        btree_leaf_insert(leaf, pos, key, value, split_key);
+    else
+        btree_leaf_insert(right, pos - half, key, value, split_key);
+
+    *split_key = right->node.keys[0];
+    return (struct _btree_node *) right;
+}
+
+
+// inserts child, whose keys are all >= key, to the right of children[pos].
+// if branch is full it is split, and the new right sibling is returned with
+// split_key set to the key which separates the two
+static struct _btree_node * btree_branch_insert (struct _btree_branch * branch,
+                                                 unsigned int pos,
+                                                 uint64_t     key,
+                                                 struct _btree_node * child,
+                                                 uint64_t   * split_key)
+{
+    uint64_t             keys[BTREE_SLOTS + 1];
+    struct _btree_node * children[BTREE_SLOTS + 2];
+    struct _btree_branch * right;
+    unsigned int size = branch->node.size;
+    unsigned int half;
+
+    if (size < BTREE_SLOTS) {
+        memmove(&(branch->node.keys[pos + 1]), &(branch->node.keys[pos]),
+                sizeof(uint64_t) * (size - pos));
+        memmove(&(branch->children[pos + 2]), &(branch->children[pos + 1]),
+                sizeof(struct _btree_node *) * (size - pos));
+        branch->node.keys[pos]     = key;
+        branch->children[pos + 1]  = child;
+        branch->node.size++;
+        return NULL;
+    }
+
+    memcpy(keys, branch->node.keys, sizeof(uint64_t) * pos);
+    keys[pos] = key;
+    memcpy(&(keys[pos + 1]), &(branch->node.keys[pos]),
+           sizeof(uint64_t) * (size - pos));
+
+    memcpy(children, branch->children, sizeof(struct _btree_node *) * (pos + 1));
+    children[pos + 1] = child;
+    memcpy(&(children[pos + 2]), &(branch->children[pos + 1]),
+           sizeof(struct _btree_node *) * (size - pos));
+
+    // keys[half] moves up into the parent
+    half  = (BTREE_SLOTS + 1) / 2;
+    right = btree_branch_create();
+
+    branch->node.size = half;
+    memcpy(branch->node.keys, keys, sizeof(uint64_t) * half);
+    memcpy(branch->children, children, sizeof(struct _btree_node *) * (half + 1));
+
+    right->node.size = BTREE_SLOTS - half;
+    memcpy(right->node.keys, &(keys[half + 1]),
+           sizeof(uint64_t) * right->node.size);
+    memcpy(right->children, &(children[half + 1]),
+           sizeof(struct _btree_node *) * (right->node.size + 1));
+
+    *split_key = keys[half];
+    return (struct _btree_node *) right;
+}
+
+
+// returns the new right sibling of node if node was split, NULL otherwise
+static struct _btree_node * btree_node_insert (struct _btree_node * node,
+                                               uint64_t   key,
+                                               void     * value,
+                                               uint64_t * split_key,
+                                               int      * result)
+{
+    struct _btree_node * new_node;
+    unsigned int pos;
+
+    if (node->leaf) {
+        pos = btree_lower_bound(node, key);
+        if ((pos < node->size) && (node->keys[pos] == key)) {
+            *result = -1;
+            return NULL;
+        }
+        return btree_leaf_insert((struct _btree_leaf *) node,
+                                 pos, key, value, split_key);
+    }
+
+    struct _btree_branch * branch = (struct _btree_branch *) node;
+
+    pos = btree_upper_bound(node, key);
+    new_node = btree_node_insert(branch->children[pos],
+                                 key, value, split_key, result);
+    if (new_node == NULL)
+        return NULL;
+
+    return btree_branch_insert(branch, pos, *split_key, new_node, split_key);
+}
+
+
+int btree_insert_take (struct _btree * btree, uint64_t key, void * value)
+{
+    struct _btree_node * new_node;
+    uint64_t split_key;
+    int      result = 0;
+
+    new_node = btree_node_insert(btree->root, key, value, &split_key, &result);
+
+    if (new_node != NULL) {
+        struct _btree_branch * root = btree_branch_create();
+        root->node.size    = 1;
+        root->node.keys[0] = split_key;
+        root->children[0]  = btree->root;
+        root->children[1]  = new_node;
+        btree->root = (struct _btree_node *) root;
+    }
+
+    if ((result != 0) && (value != NULL))
+        object_delete(value);
+
+    return result;
+}
+
+
+
+static struct _btree_leaf * btree_find_leaf (const struct _btree * btree,
+                                             uint64_t key)
+{
+    const struct _btree_node * node = btree->root;
+
+    while (! node->leaf) {
+        const struct _btree_branch * branch;
+        branch = (const struct _btree_branch *) node;
+        node   = branch->children[btree_upper_bound(node, key)];
+    }
+
+    return (struct _btree_leaf *) node;
+}
+
+
+void * btree_fetch (const struct _btree * btree, uint64_t key)
+{
+    void ** slot = btree_fetch_slot((struct _btree *) btree, key);
+
+    if (slot == NULL)
+        return NULL;
+    return *slot;
+}
+
+
+void ** btree_fetch_slot (struct _btree * btree, uint64_t key)
+{
+    struct _btree_leaf * leaf = btree_find_leaf(btree, key);
+    unsigned int pos = btree_lower_bound(&(leaf->node), key);
+
+    if ((pos < leaf->node.size) && (leaf->node.keys[pos] == key))
+        return &(leaf->values[pos]);
+    return NULL;
+}
+
+
+int btree_fetch_max (const struct _btree * btree,
+                     uint64_t   key,
+                     uint64_t * found_key,
+                     void    ** value)
+{
+    struct _btree_leaf * leaf = btree_find_leaf(btree, key);
+    unsigned int pos = btree_upper_bound(&(leaf->node), key);
+
+    // every key in the previous leaf is less than every key in this one
+    if (pos == 0) {
+        leaf = leaf->prev;
+        if (leaf == NULL)
+            return -1;
+        pos = leaf->node.size;
+    }
+
+    *found_key = leaf->node.keys[pos - 1];
+    *value     = leaf->values[pos - 1];
+
+    return 0;
+}
+
+
+
+// returns -1 if key was not found, 1 if node is now empty and has been freed,
+// 0 otherwise. underfull nodes are not merged with their siblings, empty ones
+// are removed. the maps we keep are rarely removed from
+static int btree_node_remove (struct _btree * btree,
+                              struct _btree_node * node,
+                              uint64_t key)
+{
+    unsigned int pos;
+    unsigned int key_pos;
+    int result;
+
+    if (node->leaf) {
+        struct _btree_leaf * leaf = (struct _btree_leaf *) node;
+
+        pos = btree_lower_bound(node, key);
+        if ((pos == node->size) || (node->keys[pos] != key))
+            return -1;
+
+        if (leaf->values[pos] != NULL)
+            object_delete(leaf->values[pos]);
+
+        node->size--;
+        memmove(&(node->keys[pos]), &(node->keys[pos + 1]),
+                sizeof(uint64_t) * (node->size - pos));
+        memmove(&(leaf->values[pos]), &(leaf->values[pos + 1]),
+                sizeof(void *) * (node->size - pos));
+
+        if ((node->size > 0) || (node == btree->root))
+            return 0;
+
+        if (leaf->prev != NULL)
+            leaf->prev->next = leaf->next;
+        if (leaf->next != NULL)
+            leaf->next->prev = leaf->prev;
+        mem_free(leaf);
+        return 1;
+    }
+
+    struct _btree_branch * branch = (struct _btree_branch *) node;
+
+    pos    = btree_upper_bound(node, key);
+    result = btree_node_remove(btree, branch->children[pos], key);
+    if (result != 1)
+        return result;
+
+    // children[pos] is gone, drop it and a key bounding it
+    if (node->size == 0) {
+        if (node == btree->root) {
+            btree->root = (struct _btree_node *) btree_leaf_create();
+            mem_free(branch);
+            return 0;
+        }
+        mem_free(branch);
+        return 1;
+    }
+
+    key_pos = (pos > 0) ? pos - 1 : 0;
+    memmove(&(node->keys[key_pos]), &(node->keys[key_pos + 1]),
+            sizeof(uint64_t) * (node->size - key_pos - 1));
+    memmove(&(branch->children[pos]), &(branch->children[pos + 1]),
+            sizeof(struct _btree_node *) * (node->size - pos));
+    node->size--;
+
+    return 0;
+}
+
+
+int btree_remove (struct _btree * btree, uint64_t key)
+{
+    int result = btree_node_remove(btree, btree->root, key);
+
+    // a root with one child is replaced by that child
+    while ((! btree->root->leaf) && (btree->root->size == 0)) {
+        struct _btree_branch * root = (struct _btree_branch *) btree->root;
+        btree->root = root->children[0];
+        mem_free(root);
+    }
+
+    if (result == -1)
+        return -1;
+    return 0;
+}
+
+
+
+struct _btree_leaf * btree_first_leaf (const struct _btree * btree)
+{
+    const struct _btree_node * node = btree->root;
+
+    while (! node->leaf)
+        node = ((const struct _btree_branch *) node)->children[0];
+
+    // only an empty tree has an empty first leaf
+    if (node->size == 0)
+        return NULL;
+
+    return (struct _btree_leaf *) node;
+}
+
+
+struct _btree_it * btree_iterator (const struct _btree * btree)
+{
+    struct _btree_leaf * leaf = btree_first_leaf(btree);
+    struct _btree_it   * btree_it;
+
+    if (leaf == NULL)
+        return NULL;
+
+    btree_it = (struct _btree_it *) mem_alloc(sizeof(struct _btree_it));
+    btree_it->leaf = leaf;
+    btree_it->slot = 0;
+
+    return btree_it;
+}
+
+
+struct _btree_it * btree_it_next (struct _btree_it * btree_it)
+{
+    btree_it->slot++;
+
+    if (btree_it->slot == btree_it->leaf->node.size) {
+        btree_it->leaf = btree_it->leaf->next;
+        btree_it->slot = 0;
+    }
+
+    if (btree_it->leaf == NULL) {
+        mem_free(btree_it);
+        return NULL;
+    }
+
+    return btree_it;
+}
+
+
+void * btree_it_data (const struct _btree_it * btree_it)
+{
+    return btree_it->leaf->values[btree_it->slot];
+}
+
+
+uint64_t btree_it_key (const struct _btree_it * btree_it)
+{
+    return btree_it->leaf->node.keys[btree_it->slot];
+}
+
+
+void btree_it_delete (struct _btree_it * btree_it)
+{
+    mem_free(btree_it);
+}
\ No newline at end of file
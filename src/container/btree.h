@@ -0,0 +1,79 @@
+#ifndef btree_HEADER
+#define btree_HEADER
+
+// a B+tree of uint64_t keys to objects. keys and values are stored in wide
+// sorted nodes, and the leaves are linked for ordered iteration, so lookups
+// and walks touch far fewer cache lines than the AA-tree in tree.c
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "object.h"
+
+#define BTREE_SLOTS 32
+
+struct _btree_node {
+    unsigned int leaf;
+    unsigned int size;
+    uint64_t     keys[BTREE_SLOTS];
+};
+
+struct _btree_leaf {
+    struct _btree_node   node;
+    void               * values[BTREE_SLOTS];
+    struct _btree_leaf * prev;
+    struct _btree_leaf * next;
+};
+
+// children[i] holds keys >= keys[i - 1] and < keys[i]
+struct _btree_branch {
+    struct _btree_node   node;
+    struct _btree_node * children[BTREE_SLOTS + 1];
+};
+
+struct _btree {
+    const struct _object * object;
+    unsigned int           refs;
+    struct _btree_node   * root;
+};
+
+struct _btree_it {
+    struct _btree_leaf * leaf;
+    unsigned int         slot;
+};
+
+
+struct _btree * btree_create ();
+void            btree_delete (struct _btree * btree);
+struct _btree * btree_copy   (const struct _btree * btree);
+
+// builds a tree in O(n) from n strictly ascending keys. takes over the
+// caller's references to values, but not the arrays holding them
+struct _btree * btree_build_sorted (const uint64_t * keys,
+                                    void ** values,
+                                    size_t n);
+
+// returns 0 on success, -1 if key already exists. takes over the caller's
+// reference to value either way. value may be NULL
+int     btree_insert_take (struct _btree * btree, uint64_t key, void * value);
+void *  btree_fetch       (const struct _btree * btree, uint64_t key);
+// returns the slot holding key's value, so it may be replaced in place
+void ** btree_fetch_slot  (struct _btree * btree, uint64_t key);
+// finds the greatest key <= key. returns 0 on success, -1 if there is none
+int     btree_fetch_max   (const struct _btree * btree,
+                           uint64_t   key,
+                           uint64_t * found_key,
+                           void    ** value);
+// returns 0 on success, -1 if key does not exist
+int     btree_remove      (struct _btree * btree, uint64_t key);
+
+// returns NULL if the tree is empty
+struct _btree_leaf * btree_first_leaf (const struct _btree * btree);
+
+struct _btree_it * btree_iterator  (const struct _btree * btree);
+struct _btree_it * btree_it_next   (struct _btree_it * btree_it);
+void *             btree_it_data   (const struct _btree_it * btree_it);
+uint64_t           btree_it_key    (const struct _btree_it * btree_it);
+void               btree_it_delete (struct _btree_it * btree_it);
+
+#endif
\ No newline at end of file
@@ -16,9 +16,11 @@ struct _buffer * buffer_create (const uint8_t * bytes, size_t size)
     struct _buffer * buffer = (struct _buffer *) malloc(sizeof(struct _buffer));
 
     buffer->object      = &buffer_object;
+    buffer->refs        = 1;
     buffer->bytes       = (uint8_t *) malloc(size);
     buffer->size        = size;
     buffer->permissions = 0;
+    buffer->owner       = NULL;
 
     memcpy(buffer->bytes, bytes, size);
 
@@ -31,9 +33,11 @@ struct _buffer * buffer_create_null (size_t size)
     struct _buffer * buffer = (struct _buffer *) malloc(sizeof(struct _buffer));
 
     buffer->object      = &buffer_object;
+    buffer->refs        = 1;
     buffer->bytes       = (uint8_t *) malloc(size);
     buffer->size        = size;
     buffer->permissions = 0;
+    buffer->owner       = NULL;
 
     memset(buffer->bytes, 0, buffer->size);
 
@@ -69,9 +73,27 @@ struct _buffer * buffer_load_file (const char * filename)
 }
 
 
+struct _buffer * buffer_create_alias (const struct _buffer * owner)
+{
+    struct _buffer * buffer = (struct _buffer *) malloc(sizeof(struct _buffer));
+
+    buffer->object      = &buffer_object;
+    buffer->refs        = 1;
+    buffer->bytes       = owner->bytes;
+    buffer->size        = owner->size;
+    buffer->permissions = owner->permissions;
+    buffer->owner       = object_retain(owner);
+
+    return buffer;
+}
+
+
 void buffer_delete (struct _buffer * buffer)
 {
-    free(buffer->bytes);
+    if (buffer->owner != NULL)
+        object_delete(buffer->owner);
+    else
+        free(buffer->bytes);
     free(buffer);
 }
 
@@ -12,14 +12,23 @@
 
 struct _buffer {
     const struct _object * object;
+    unsigned int           refs;
     uint32_t  permissions;
     uint8_t * bytes;
     size_t    size;
+    // an alias views owner's bytes, and holds a reference to owner in place
+    // of bytes of its own. NULL for buffers which own their bytes
+    struct _buffer * owner;
 };
 
 struct _buffer * buffer_create      (const uint8_t * bytes, size_t size);
 struct _buffer * buffer_create_null (size_t size);
 struct _buffer * buffer_load_file   (const char * filename);
+// a buffer with owner's bytes and permissions, which are not copied. an
+// alias keeps reference counts of its own, so threads which must not share
+// owner's count may each retain and release an alias. the alias is made,
+// and deleted, by whichever thread holds owner
+struct _buffer * buffer_create_alias (const struct _buffer * owner);
 void             buffer_delete      (struct _buffer * buffer);
 struct _buffer * buffer_copy        (const struct _buffer * buffer);
 
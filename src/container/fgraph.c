@@ -0,0 +1,189 @@
+#include "fgraph.h"
+
+#include "arena.h"
+
+static const struct _object fgraph_object = {
+    (void     (*) (void *))       fgraph_delete,
+    (void *   (*) (const void *)) fgraph_copy,
+    NULL,
+    NULL
+};
+
+
+// a self loop sits in its node's edge list twice, but is one successor and
+// one predecessor
+static int fgraph_is_second_loop (const struct _graph_edge * edge, int * loops)
+{
+    if (edge->head != edge->tail)
+        return 0;
+    return (*loops)++ > 0;
+}
+
+
+struct _fgraph * graph_freeze (const struct _graph * graph)
+{
+    struct _fgraph     * fgraph;
+    struct _graph_iter   git;
+    struct _graph_node * node;
+    size_t               size = 0;
+    size_t               i, j, succ, pred;
+    int                  loops;
+
+    for (node = graph_iter_first(&git, graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        size++;
+    }
+
+    fgraph = (struct _fgraph *) mem_alloc(sizeof(struct _fgraph));
+    fgraph->object = &fgraph_object;
+    fgraph->refs   = 1;
+    fgraph->size   = size;
+    fgraph->nodes  = (struct _fgraph_node *)
+                        mem_alloc(sizeof(struct _fgraph_node) * (size + 1));
+
+    // lay out the nodes and count their edges
+    succ = 0;
+    pred = 0;
+    i    = 0;
+    for (node = graph_iter_first(&git, graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        fgraph->nodes[i].index = node->index;
+        if (node->data == NULL)
+            fgraph->nodes[i].data = NULL;
+        else
+            fgraph->nodes[i].data = object_retain(node->data);
+        fgraph->nodes[i].succ = succ;
+        fgraph->nodes[i].pred = pred;
+
+        loops = 0;
+        for (j = 0; j < node->edges->size; j++) {
+            struct _graph_edge * edge = node->edges->items[j];
+            if (fgraph_is_second_loop(edge, &loops))
+                continue;
+            if (edge->head == node->index)
+                succ++;
+            if (edge->tail == node->index)
+                pred++;
+        }
+        i++;
+    }
+    fgraph->nodes[size].index = 0;
+    fgraph->nodes[size].data  = NULL;
+    fgraph->nodes[size].succ  = succ;
+    fgraph->nodes[size].pred  = pred;
+
+    fgraph->edges        = succ;
+    fgraph->successors   = (struct _fgraph_edge *)
+                              mem_alloc(sizeof(struct _fgraph_edge) * succ);
+    fgraph->predecessors = (struct _fgraph_edge *)
+                              mem_alloc(sizeof(struct _fgraph_edge) * pred);
+
+    // fill in the edges, in the order the graph holds them
+    succ = 0;
+    pred = 0;
+    for (node = graph_iter_first(&git, graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        loops = 0;
+        for (j = 0; j < node->edges->size; j++) {
+            struct _graph_edge * edge = node->edges->items[j];
+            if (fgraph_is_second_loop(edge, &loops))
+                continue;
+            if (edge->head == node->index) {
+                fgraph->successors[succ].node = fgraph_find(fgraph, edge->tail);
+                if (edge->data == NULL)
+                    fgraph->successors[succ].data = NULL;
+                else
+                    fgraph->successors[succ].data = object_retain(edge->data);
+                succ++;
+            }
+            if (edge->tail == node->index) {
+                fgraph->predecessors[pred].node = fgraph_find(fgraph, edge->head);
+                fgraph->predecessors[pred].data = edge->data;
+                pred++;
+            }
+        }
+    }
+
+    return fgraph;
+}
+
+
+
+void fgraph_delete (struct _fgraph * fgraph)
+{
+    size_t i;
+
+    for (i = 0; i < fgraph->size; i++) {
+        if (fgraph->nodes[i].data != NULL)
+            object_delete(fgraph->nodes[i].data);
+    }
+
+    // predecessor entries borrow their data from the successor entries
+    for (i = 0; i < fgraph->edges; i++) {
+        if (fgraph->successors[i].data != NULL)
+            object_delete(fgraph->successors[i].data);
+    }
+
+    mem_free(fgraph->nodes);
+    mem_free(fgraph->successors);
+    mem_free(fgraph->predecessors);
+    mem_free(fgraph);
+}
+
+
+
+struct _fgraph * fgraph_copy (const struct _fgraph * fgraph)
+{
+    return object_retain(fgraph);
+}
+
+
+
+size_t fgraph_find (const struct _fgraph * fgraph, uint64_t index)
+{
+    size_t lo = 0;
+    size_t hi = fgraph->size;
+    size_t mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (fgraph->nodes[mid].index < index)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if ((lo < fgraph->size) && (fgraph->nodes[lo].index == index))
+        return lo;
+    return FGRAPH_NONE;
+}
+
+
+
+size_t fgraph_successors_n (const struct _fgraph * fgraph, size_t node)
+{
+    return fgraph->nodes[node + 1].succ - fgraph->nodes[node].succ;
+}
+
+
+size_t fgraph_predecessors_n (const struct _fgraph * fgraph, size_t node)
+{
+    return fgraph->nodes[node + 1].pred - fgraph->nodes[node].pred;
+}
+
+
+const struct _fgraph_edge * fgraph_successors (const struct _fgraph * fgraph,
+                                               size_t node)
+{
+    return &(fgraph->successors[fgraph->nodes[node].succ]);
+}
+
+
+const struct _fgraph_edge * fgraph_predecessors (const struct _fgraph * fgraph,
+                                                 size_t node)
+{
+    return &(fgraph->predecessors[fgraph->nodes[node].pred]);
+}
@@ -0,0 +1,66 @@
+#ifndef fgraph_HEADER
+#define fgraph_HEADER
+
+// a frozen graph, made from a finished _graph by graph_freeze
+//
+// the nodes sit in one array sorted by index, and are referred to by their
+// position in it. each node's successor and predecessor edges are runs of
+// two shared edge arrays (compressed sparse rows), so walking a node's edges
+// is a linear scan and degrees are a subtraction. frozen graphs are never
+// modified
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "graph.h"
+#include "object.h"
+
+// returned by fgraph_find when there is no such node
+#define FGRAPH_NONE ((size_t) -1)
+
+struct _fgraph_node {
+    uint64_t index;
+    void   * data;
+    // this node's edges run from succ/pred up to the next node's succ/pred
+    size_t   succ;
+    size_t   pred;
+};
+
+// node is the position of the node at the far end of the edge. an edge's
+// data is shared by its successor and predecessor entries
+struct _fgraph_edge {
+    size_t   node;
+    void   * data;
+};
+
+struct _fgraph {
+    const struct _object * object;
+    unsigned int           refs;
+    size_t                 size;
+    size_t                 edges;
+    // size + 1 entries. the last only marks where the edge runs end
+    struct _fgraph_node  * nodes;
+    struct _fgraph_edge  * successors;
+    struct _fgraph_edge  * predecessors;
+};
+
+
+// node and edge data are shared with graph, not copied
+struct _fgraph * graph_freeze  (const struct _graph * graph);
+
+void             fgraph_delete (struct _fgraph * fgraph);
+// frozen graphs never change, so this returns another reference to fgraph
+struct _fgraph * fgraph_copy   (const struct _fgraph * fgraph);
+
+// returns the position of the node with index, or FGRAPH_NONE
+size_t fgraph_find (const struct _fgraph * fgraph, uint64_t index);
+
+size_t fgraph_successors_n   (const struct _fgraph * fgraph, size_t node);
+size_t fgraph_predecessors_n (const struct _fgraph * fgraph, size_t node);
+
+const struct _fgraph_edge * fgraph_successors   (const struct _fgraph * fgraph,
+                                                 size_t node);
+const struct _fgraph_edge * fgraph_predecessors (const struct _fgraph * fgraph,
+                                                 size_t node);
+
+#endif
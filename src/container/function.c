@@ -1,5 +1,8 @@
 #include "function.h"
 
+#include "arena.h"
+#include "intern.h"
+
 #include <stdlib.h>
 #include <string.h>
 
@@ -12,34 +15,46 @@ static const struct _object function_object = {
 
 
 struct _function * function_create (uint64_t address,
-                                    const struct _graph * graph,
+                                    const struct _fgraph * graph,
                                     const char * name)
 {
     struct _function * function;
 
-    function = (struct _function *) malloc(sizeof(struct _function));
+    function = (struct _function *) mem_alloc(sizeof(struct _function));
     function->object  = &function_object;
+    function->refs    = 1;
     function->address = address;
-    function->graph   = object_copy(graph);
+    function->graph   = NULL;
+    function->ins_ids = NULL;
+    function->ins_n   = 0;
+    function->name    = intern(name);
+
+    if (graph != NULL)
+        function->graph = mem_retain(function, graph);
 
-    if (name == NULL)
-        function->name = NULL;
-    else
-        function->name = strdup(name);
     return function;
 }
 
 
 void function_delete (struct _function * function)
 {
-    object_delete(function->graph);
-    free(function);
+    if (function->graph != NULL)
+        mem_release(function, function->graph);
+    mem_free(function->ins_ids);
+    mem_free(function);
 }
 
 
 struct _function * function_copy (const struct _function * function)
 {
-    return function_create(function->address, function->graph, function->name);
+    struct _function * new_function;
+
+    new_function = function_create(function->address, function->graph, NULL);
+    new_function->name = function->name;
+    if (function->ins_ids != NULL)
+        function_s_ins_ids(new_function, function->ins_ids, function->ins_n);
+
+    return new_function;
 }
 
 
@@ -55,11 +70,16 @@ int function_cmp (const struct _function * lhs, const struct _function * rhs)
 
 void function_s_name (struct _function * function, const char * name)
 {
-    if (function->name != NULL)
-        free((char *) function->name);
+    function->name = intern(name);
+}
+
 
-    if (name == NULL)
-        function->name = NULL;
-    else
-        function->name = strdup(name);
+void function_s_ins_ids (struct _function * function,
+                         const uint32_t * ins_ids,
+                         size_t n)
+{
+    mem_free(function->ins_ids);
+    function->ins_ids = (uint32_t *) mem_alloc(sizeof(uint32_t) * n);
+    memcpy(function->ins_ids, ins_ids, sizeof(uint32_t) * n);
+    function->ins_n = n;
 }
\ No newline at end of file
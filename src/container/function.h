@@ -3,18 +3,32 @@
 
 #include <inttypes.h>
 
+#include "fgraph.h"
 #include "object.h"
 
 struct _function {
     const struct _object * object;
-    const char    * name;
-    uint64_t        address;
-    struct _graph * graph;
+    unsigned int           refs;
+    // an interned string (intern.h)
+    const char     * name;
+    uint64_t         address;
+    // the function's control flow graph. either a graph of its instructions,
+    // or, with ins_ids, the graph ins_store_graph builds, whose node i is
+    // ins_ids[i] and which holds no instructions. may be NULL
+    struct _fgraph * graph;
+    // ids of this function's instructions in a program-wide _ins_store
+    // (ins_store.h), listed by instruction address. ids are handed out in
+    // the order instructions first reach the store, from any function, so
+    // they are not sorted. find an address with ins_store_find, not by
+    // searching ins_ids. NULL when not kept
+    uint32_t       * ins_ids;
+    size_t           ins_n;
 };
 
 
+// graph may be NULL
 struct _function * function_create (uint64_t address,
-                                    const struct _graph * graph,
+                                    const struct _fgraph * graph,
                                     const char * name);
 void               function_delete (struct _function * function);
 struct _function * function_copy   (const struct _function * function);
@@ -22,4 +36,8 @@ int                function_cmp    (const struct _function * lhs,
                                     const struct _function * rhs);
 void               function_s_name (struct _function * function,
                                     const char * name);
+// copies the n ids
+void               function_s_ins_ids (struct _function * function,
+                                       const uint32_t * ins_ids,
+                                       size_t n);
 #endif
\ No newline at end of file
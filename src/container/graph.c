@@ -1,6 +1,7 @@
 #include "graph.h"
 
-#include "index.h"
+#include "arena.h"
+#include "graph_walk.h"
 #include "instruction.h"
 #include "queue.h"
 
@@ -27,18 +28,126 @@ static const struct _object graph_object = {
     (void     (*) (void *, const void *)) graph_merge
 };
 
+// tree_key_cmp for looking up graph nodes by their uint64_t index
+static int graph_node_key_cmp (const void * key, const void * data)
+{
+    uint64_t                   lhs = *((const uint64_t *) key);
+    const struct _graph_node * rhs = data;
+
+    if (lhs < rhs->index)
+        return -1;
+    else if (lhs > rhs->index)
+        return 1;
+    return 0;
+}
+
+
+
+/*
+* THE NODE INDEX
+*
+* besides the tree, which keeps nodes in order, a graph numbers its nodes
+* densely in graph->ids and finds them by index in graph->index
+*/
+static void graph_index_add (struct _graph * graph, struct _graph_node * node)
+{
+    struct _graph_node ** ids;
+    size_t i;
+
+    if (graph->size == graph->ids_size) {
+        graph->ids_size = (graph->ids_size == 0) ? 8 : graph->ids_size * 2;
+        ids = (struct _graph_node **)
+                      mem_alloc(sizeof(struct _graph_node *) * graph->ids_size);
+        for (i = 0; i < graph->size; i++)
+            ids[i] = graph->ids[i];
+        mem_free(graph->ids);
+        graph->ids = ids;
+    }
+
+    node->id = graph->size;
+    graph->ids[graph->size++] = node;
+    hashmap_insert(graph->index, node->index, node);
+}
+
+
+static void graph_index_remove (struct _graph * graph,
+                                struct _graph_node * node)
+{
+    // the last node takes over the removed node's id
+    graph->size--;
+    graph->ids[node->id] = graph->ids[graph->size];
+    graph->ids[node->id]->id = node->id;
+
+    hashmap_remove(graph->index, node->index);
+}
+
+
+
+/*
+* THE EDGE INDEX
+*
+* every edge is also found by its head and tail in graph->edges, a _hashmap
+* keyed by pairs
+*/
+static struct _graph_edge * graph_edges_find (const struct _graph * graph,
+                                              uint64_t head,
+                                              uint64_t tail)
+{
+    return hashmap_fetch_pair(graph->edges, head, tail);
+}
+
+
+// edge must not be in the table already
+static void graph_edges_add (struct _graph * graph, struct _graph_edge * edge)
+{
+    hashmap_insert_pair(graph->edges, edge->head, edge->tail, edge);
+}
+
+
+static void graph_edges_remove (struct _graph * graph,
+                                uint64_t head,
+                                uint64_t tail)
+{
+    hashmap_remove_pair(graph->edges, head, tail);
+}
+
+
+// rebuilds the table from the nodes' edges, for after edges were changed in
+// place
+static void graph_edges_rebuild (struct _graph * graph)
+{
+    struct _graph_node * node;
+    size_t               i, j;
+
+    object_delete(graph->edges);
+    graph->edges = hashmap_create_pairs();
+
+    for (i = 0; i < graph->size; i++) {
+        node = graph->ids[i];
+        for (j = 0; j < node->edges->size; j++) {
+            struct _graph_edge * edge = node->edges->items[j];
+            if (    (edge->head == node->index)
+                 && (graph_edges_find(graph, edge->head, edge->tail) == NULL))
+                graph_edges_add(graph, edge);
+        }
+    }
+}
+
 
 
 
 void graph_debug (const struct _graph * graph)
 {
-    struct _graph_it * it;
-    for (it = graph_iterator(graph); it != NULL; it = graph_it_next(it)) {
-        struct _list_it * edge_it;
+    struct _graph_iter   it;
+    struct _graph_node * node;
+    for (node = graph_iter_first(&it, graph);
+         node != NULL;
+         node = graph_iter_next(&it)) {
         struct _graph_edge * edge;
-        printf("%llx [ ", (unsigned long long) graph_it_index(it));
-        for (edge_it = list_iterator(graph_it_edges(it)); edge_it != NULL; edge_it = edge_it->next) {
-            edge = edge_it->data;
+        size_t i;
+        printf("%llx [ ", (unsigned long long) node->index);
+        for (i = 0; i < node->edges->size; i++) {
+            edge = node->edges->items[i];
             printf("(%llx -> %llx) ",
                    (unsigned long long) edge->head,
                    (unsigned long long) edge->tail);
@@ -53,10 +162,16 @@ struct _graph * graph_create ()
 {
     struct _graph * graph;
 
-    graph = (struct _graph *) malloc(sizeof(struct _graph));
+    graph = (struct _graph *) mem_alloc(sizeof(struct _graph));
     graph->object = &graph_object;
+    graph->refs = 1;
     graph->nodes = tree_create();
     graph->next_index = 1;
+    graph->size = 0;
+    graph->ids_size = 0;
+    graph->ids = NULL;
+    graph->index = hashmap_create();
+    graph->edges = hashmap_create_pairs();
 
     return graph;
 }
@@ -65,100 +180,150 @@ struct _graph * graph_create ()
 
 void graph_delete (struct _graph * graph)
 {
-    tree_delete(graph->nodes);
-    free(graph);
+    objects_delete(graph->index, graph->edges, graph->nodes, NULL);
+    mem_free(graph->ids);
+    mem_free(graph);
+}
+
+
+struct _graph * graph_build_sorted (const uint64_t * indices,
+                                    void ** data,
+                                    size_t n)
+{
+    struct _graph       * graph;
+    struct _graph_node ** nodes;
+    size_t                i;
+
+    graph = graph_create();
+
+    nodes = (struct _graph_node **) mem_alloc(sizeof(void *) * n);
+    for (i = 0; i < n; i++) {
+        nodes[i] = graph_node_create(graph, indices[i], NULL);
+        nodes[i]->data = data[i];
+        if (indices[i] == graph->next_index)
+            graph->next_index++;
+        graph_index_add(graph, nodes[i]);
+    }
+
+    object_delete(graph->nodes);
+    graph->nodes = tree_build_sorted((void **) nodes, n);
+
+    mem_free(nodes);
+
+    return graph;
 }
 
 
+
+// a structural clone, built in one pass over graph. nodes keep their ids and
+// their edge vectors keep their order. each edge is cloned when it is first
+// listed, and its second listing finds the clone in the new edge table
 struct _graph * graph_copy (const struct _graph * graph)
 {
-    struct _graph * new_graph;
+    struct _graph       * new_graph = graph_create();
+    struct _graph_node ** nodes;
+    struct _graph_node  * node;
+    struct _graph_node  * new_node;
+    struct _graph_edge  * edge;
+    struct _graph_edge  * new_edge;
+    struct _graph_iter    it;
+    size_t                n = 0;
+    size_t                i;
 
-    new_graph = graph_create();
+    new_graph->next_index = graph->next_index;
 
-    // we have to manually enter the new graph nodes. copying them will cause
-    // them to point to the old graph
-    struct _graph_it * it;
-    for (it = graph_iterator(graph); it != NULL; it = graph_it_next(it)) {
-        graph_add_node(new_graph, graph_it_index(it), graph_it_data(it));
+    if (graph->size == 0)
+        return new_graph;
+
+    // nodes keep their ids, so ids is sized for them all up front
+    new_graph->ids_size = graph->size;
+    new_graph->ids = (struct _graph_node **)
+                      mem_alloc(sizeof(struct _graph_node *) * graph->size);
+
+    // nodes come out of the tree in order, so the new tree is built in O(n)
+    nodes = (struct _graph_node **) mem_alloc(sizeof(void *) * graph->size);
+    for (node = graph_iter_first(&it, graph);
+         node != NULL;
+         node = graph_iter_next(&it)) {
+        new_node = graph_node_create(new_graph, node->index, node->data);
+        new_node->id = node->id;
+        new_graph->ids[node->id] = new_node;
+        hashmap_insert(new_graph->index, new_node->index, new_node);
+        nodes[n++] = new_node;
     }
-
-    for (it = graph_iterator(graph); it != NULL; it = graph_it_next(it)) {
-        struct _list * edges = graph_it_edges(it);
-        struct _list_it * eit;
-        for (eit = list_iterator(edges); eit != NULL; eit = eit->next) {
-            struct _graph_edge * edge = eit->data;
-            graph_add_edge(new_graph, edge->head, edge->tail, edge->data);
+    new_graph->size = n;
+
+    object_delete(new_graph->nodes);
+    new_graph->nodes = tree_build_sorted((void **) nodes, n);
+    mem_free(nodes);
+
+    for (i = 0; i < graph->size; i++) {
+        node     = graph->ids[i];
+        new_node = new_graph->ids[i];
+        for (n = 0; n < node->edges->size; n++) {
+            edge     = node->edges->items[n];
+            new_edge = graph_edges_find(new_graph, edge->head, edge->tail);
+            if (new_edge != NULL) {
+                vector_append(new_node->edges, new_edge);
+                continue;
+            }
+            new_edge = graph_edge_create(edge->head, edge->tail, edge->data);
+            graph_edges_add(new_graph, new_edge);
+            vector_append_take(new_node->edges, new_edge);
         }
     }
 
-    new_graph->next_index = graph->next_index;
-
     return new_graph;
 }
 
 
 void graph_merge_node_edges (struct _graph_node * lhs, struct _graph_node * rhs)
 {
-    struct _list_it *    rhs_it;
-    struct _graph_edge * rhs_edge;
-    struct _list_it *    lhs_it;
-    struct _graph_edge * lhs_edge;
-    int found;
-
-    for (rhs_it =  list_iterator(rhs->edges);
-         rhs_it != NULL;
-         rhs_it =  rhs_it->next) {
-        rhs_edge = rhs_it->data;
-
-        found = 0;
-        for (lhs_it =  list_iterator(lhs->edges);
-             lhs_it != NULL;
-             lhs_it =  lhs_it->next) {
-
-            lhs_edge = lhs_it->data;
-            if (    (lhs_edge->head == rhs_edge->head)
-                 && (lhs_edge->tail == rhs_edge->tail)) {
-                found = 1;
-                break;
-            }
-        }
+    // a set of lhs's edges, so each of rhs's is checked in O(1)
+    struct _hashset * seen = hashset_create_pairs();
+    size_t            i;
 
-        if (found == 0) {
-            list_append(lhs->edges, rhs_edge);
-        }
+    for (i = 0; i < lhs->edges->size; i++) {
+        struct _graph_edge * lhs_edge = lhs->edges->items[i];
+        hashset_insert_pair(seen, lhs_edge->head, lhs_edge->tail);
     }
+
+    for (i = 0; i < rhs->edges->size; i++) {
+        struct _graph_edge * rhs_edge = rhs->edges->items[i];
+        if (hashset_insert_pair(seen, rhs_edge->head, rhs_edge->tail) == 0)
+            vector_append(lhs->edges, rhs_edge);
+    }
+
+    object_delete(seen);
 }
 
 
 
 void graph_merge (struct _graph * graph, const struct _graph * rhs)
 {
-    struct _queue * queue = queue_create();
-
     // start by adding all new nodes
-    struct _graph_it   * it;
-    for (it = graph_iterator(rhs); it != NULL; it = graph_it_next(it)) {
-        struct _graph_node * node = graph_it_node(it);
-
-        // add this node's edge to queue. Even if this node already exists,
-        // we want all the new edges
-        struct _list_it * eit;
-        for (eit = list_iterator(node->edges); eit != NULL; eit = eit->next) {
-            queue_push(queue, eit->data);
-        }
-
+    struct _graph_iter   it;
+    struct _graph_node * node;
+    for (node = graph_iter_first(&it, rhs);
+         node != NULL;
+         node = graph_iter_next(&it)) {
         if (graph_fetch_node(graph, node->index) != NULL)
             continue;
 
         graph_add_node(graph, node->index, node->data);
     }
 
-    // then add all new edges
-    while (queue->size > 0) {
-        struct _graph_edge * edge = queue_peek(queue);
-        graph_add_edge(graph, edge->head, edge->tail, edge->data);
-        queue_pop(queue);
+    // then add all new edges. even if a node already existed, we want all
+    // its new edges. each edge is listed by both its nodes, and the second
+    // is turned away by the edge index
+    for (node = graph_iter_first(&it, rhs);
+         node != NULL;
+         node = graph_iter_next(&it)) {
+        size_t i;
+        for (i = 0; i < node->edges->size; i++) {
+            struct _graph_edge * edge = node->edges->items[i];
+            graph_add_edge(graph, edge->head, edge->tail, edge->data);
+        }
     }
 }
 
@@ -170,47 +335,44 @@ void graph_reduce (struct _graph * graph)
     // if a node has one successor and that node has one predecessor,
     // merge the nodes into one
 
-    // this is a list of the node indexes we need to check
-    struct _list        * node_list;
-    struct _graph_it    * graph_it;
-    struct _index * index;
-
-    node_list = list_create();
-    for (graph_it = graph_iterator(graph);
-         graph_it != NULL;
-         graph_it = graph_it_next(graph_it)) {
-        index = index_create(graph_it_index(graph_it));
-        list_append(node_list, index);
-        object_delete(index);
+    // these are the indexes of the nodes we need to check
+    uint64_t            * node_list;
+    size_t                node_list_size;
+    size_t                node_i;
+    struct _graph_iter    graph_it;
+    struct _graph_node  * node;
+
+    node_list = (uint64_t *) mem_alloc(sizeof(uint64_t) * (graph->size + 1));
+    node_list_size = 0;
+    for (node = graph_iter_first(&graph_it, graph);
+         node != NULL;
+         node = graph_iter_next(&graph_it)) {
+        node_list[node_list_size++] = node->index;
     }
 
-    struct _list_it * node_it;
     struct _graph_node * head_node;
     struct _graph_node * tail_node;
-    node_it = list_iterator(node_list);
-    while (node_it != NULL) {
+    node_i = 0;
+    while (node_i < node_list_size) {
 
-        index = node_it->data;
-
-        head_node = graph_fetch_node(graph, index->index);
+        head_node = graph_fetch_node(graph, node_list[node_i]);
 
         // we have removed this node from the graph
         if (head_node == NULL) {
-            node_it = node_it->next;
+            node_i++;
             continue;
         }
 
         // if this node has only one successor
         if (graph_node_successors_n(head_node) != 1) {
-            node_it = node_it->next;
+            node_i++;
             continue;
         }
 
         // get that successor
-        struct _list * successors = graph_node_successors(head_node);
-        struct _graph_edge * successor_edge = list_first(successors);
+        struct _graph_edge_iter eit;
+        struct _graph_edge * successor_edge = graph_successors_first(&eit, head_node);
         tail_node = graph_fetch_node(graph, successor_edge->tail);
-        object_delete(successors);
 
         if (tail_node == NULL) {
             fprintf(stderr,
@@ -221,69 +383,65 @@ void graph_reduce (struct _graph * graph)
 
         // how many predecessors does the tail node have?
         if (graph_node_predecessors_n(tail_node) != 1) {
-            node_it = node_it->next;
+            node_i++;
             continue;
         }
 
-        // merge the tail information into head information
+        // merge the tail information into head information. head's data may
+        // be shared with another graph, so make it ours before writing to it
+        head_node->data = object_cow(head_node->data);
         object_merge(head_node->data, tail_node->data);
 
         // head removes its successor
-        struct _list_it * suc_it;
-        for (suc_it = list_iterator(head_node->edges);
-             suc_it != NULL;
-             suc_it = suc_it->next) {
-            successor_edge = suc_it->data;
+        size_t suc_i;
+        for (suc_i = 0; suc_i < head_node->edges->size; suc_i++) {
+            successor_edge = head_node->edges->items[suc_i];
             if (successor_edge->head == head_node->index) {
-                list_remove(head_node->edges, suc_it);
+                vector_remove(head_node->edges, suc_i);
                 break;
             }
         }
 
-        // head creates a new successor using tail's successors
-        // meanwhile, patch tail's successors
-        successors = graph_node_successors(tail_node);
-        // for each of tail's successors
-        for (suc_it = list_iterator(successors);
-             suc_it != NULL;
-             suc_it = suc_it->next) {
-
-            successor_edge = suc_it->data;
-
-            // create an edge in head_node pointing to this successor
-            struct _graph_edge * new_edge;
-            new_edge = object_copy(successor_edge);
-            new_edge->head = head_node->index;
-            list_append(head_node->edges, new_edge);
-            object_delete(new_edge);
-
-            // patch tail's successors
-            struct _graph_node * tail_suc_node;
-            // tail_suc_node is the successor node
-            tail_suc_node = graph_fetch_node(graph, successor_edge->tail);
-            struct _list_it * tail_suc_it;
-            // for each of the successor's edges
-            for (tail_suc_it  = list_iterator(tail_suc_node->edges);
-                 tail_suc_it != NULL;
-                 tail_suc_it  = tail_suc_it->next) {
-                struct _graph_edge * tail_suc_edge = tail_suc_it->data;
-                // if the head of this edge was tail, it is now head
-                if (tail_suc_edge->head == tail_node->index)
-                    tail_suc_edge->head = head_node->index;
-            }
+        // tail's successor edges move to head. an edge is one object, listed
+        // by both its nodes, so changing its head here also patches it in the
+        // successor's list. tail cannot have a self loop, head is its only
+        // predecessor
+        for (successor_edge = graph_successors_first(&eit, tail_node);
+             successor_edge != NULL;
+             successor_edge = graph_edge_iter_next(&eit)) {
+            successor_edge->head = head_node->index;
+            vector_append(head_node->edges, successor_edge);
         }
-        object_delete(successors);
 
         // remove tail node from graph
+        graph_index_remove(graph, tail_node);
         tree_remove(graph->nodes, tail_node);
 
         // continue processing this node
     }
-    object_delete(node_list);
+    mem_free(node_list);
+
+    // edges were moved between nodes in place
+    graph_edges_rebuild(graph);
 }
 
 
 
+// adds node, and its edges to nodes already added, to the new graph in data
+static void graph_family_visit (struct _graph_node * node, void * data)
+{
+    struct _graph * new_graph = data;
+    size_t          i;
+
+    graph_add_node(new_graph, node->index, node->data);
+
+    for (i = 0; i < node->edges->size; i++) {
+        struct _graph_edge * edge = node->edges->items[i];
+        graph_add_edge(new_graph, edge->head, edge->tail, edge->data);
+    }
+}
+
+
 struct _graph * graph_family (const struct _graph * graph, uint64_t indx)
 {
     if (graph_fetch_node(graph, indx) == NULL) {
@@ -292,51 +450,13 @@ struct _graph * graph_family (const struct _graph * graph, uint64_t indx)
         return NULL;
     }
 
-    struct _graph       * new_graph = graph_create();
-    struct _index * index;
-    struct _queue       * queue = queue_create();
-
-    index = index_create(indx);
-    queue_push(queue, index);
-    object_delete(index);
-
-    while (queue->size > 0) {
-        index = object_copy(queue_peek(queue));
-        queue_pop(queue);
-
-        // already added this node to the queue
-        if (graph_fetch_node(new_graph, index->index) != NULL) {
-            object_delete(index);
-            continue;
-        }
-
-        // fetch node
-        struct _graph_node * node = graph_fetch_node(graph, index->index);
-        if (node == NULL) {
-            fprintf(stderr, "graph_family could not find node %llx\n",
-                    (unsigned long long) index->index);
-            exit(-1);
-        }
+    struct _graph      * new_graph = graph_create();
+    struct _graph_walk * walk      = graph_walk_create(graph);
 
-        // create new node with this graph as graph
-        graph_add_node(new_graph, node->index, node->data);
-
-        // add this node's edges and queue up new nodes
-        struct _list_it * it;
-        object_delete(index);
-        for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-            struct _graph_edge * edge = it->data;
-            if (edge->head == node->index)
-                index = index_create(edge->tail);
-            else
-                index = index_create(edge->head);
-            graph_add_edge(new_graph, edge->head, edge->tail, edge->data);
-            queue_push(queue, index);
-            object_delete(index);
-        }
-    }
+    // every node connected to indx, whichever way its edges point
+    graph_walk_bfs(walk, indx, GRAPH_NEIGHBOURS, graph_family_visit, new_graph);
 
-    object_delete(queue);
+    object_delete(walk);
 
     return new_graph;
 }
@@ -352,9 +472,24 @@ void graph_add_node (struct _graph * graph, uint64_t index, const void * data)
     if (index == graph->next_index)
         graph->next_index++;
 
-    tree_insert(graph->nodes, node);
+    graph_index_add(graph, node);
+    tree_insert_take(graph->nodes, node);
+}
+
+
+
+void graph_add_node_take (struct _graph * graph, uint64_t index, void * data)
+{
+    struct _graph_node * node;
+
+    node = graph_node_create(graph, index, NULL);
+    node->data = data;
+
+    if (index == graph->next_index)
+        graph->next_index++;
 
-    object_delete(node);
+    graph_index_add(graph, node);
+    tree_insert_take(graph->nodes, node);
 }
 
 
@@ -369,9 +504,8 @@ uint64_t graph_add_node_autoindex (struct _graph * graph, const void * data)
     while (graph_fetch_node(graph, graph->next_index))
         graph->next_index++;
 
-    tree_insert(graph->nodes, node);
-
-    object_delete(node);
+    graph_index_add(graph, node);
+    tree_insert_take(graph->nodes, node);
 
     return index;
 }
@@ -386,10 +520,9 @@ void graph_remove_node (struct _graph * graph, uint64_t index)
 
     // remove all edges to/from this node
     struct _queue * queue = queue_create();
-    struct _list_it * eit;
-    for (eit = list_iterator(node->edges); eit != NULL; eit = eit->next) {
-        queue_push(queue, eit->data);
-    }
+    size_t i;
+    for (i = 0; i < node->edges->size; i++)
+        queue_push(queue, node->edges->items[i]);
 
     while (queue->size > 0) {
         struct _graph_edge * edge = queue_peek(queue);
@@ -404,6 +537,7 @@ void graph_remove_node (struct _graph * graph, uint64_t index)
 
     object_delete(queue);
 
+    graph_index_remove(graph, node);
     tree_remove(graph->nodes, node);
 }
 
@@ -412,10 +546,14 @@ void graph_remove_node (struct _graph * graph, uint64_t index)
 struct _graph_node * graph_fetch_node (const struct _graph * graph,
                                        uint64_t index)
 {
-    struct _graph_node * node        = graph_node_create(graph, index, NULL);
-    struct _graph_node * target_node = tree_fetch(graph->nodes, node);
-    object_delete(node);
-    return target_node;
+    return hashmap_fetch(graph->index, index);
+}
+
+
+
+struct _graph_node * graph_node_by_id (const struct _graph * graph, size_t id)
+{
+    return graph->ids[id];
 }
 
 
@@ -430,7 +568,7 @@ void * graph_fetch_data (const struct _graph * graph, uint64_t index)
 
 
 
-struct _list * graph_fetch_edges (const struct _graph * graph, uint64_t index)
+struct _vector * graph_fetch_edges (const struct _graph * graph, uint64_t index)
 {
     struct _graph_node * node = graph_fetch_node(graph, index);
     if (node == NULL)
@@ -443,10 +581,7 @@ struct _list * graph_fetch_edges (const struct _graph * graph, uint64_t index)
 struct _graph_node * graph_fetch_node_max (const struct _graph * graph,
                                            uint64_t index)
 {
-    struct _graph_node * node        = graph_node_create(graph, index, NULL);
-    struct _graph_node * target_node = tree_fetch_max(graph->nodes, node);
-    object_delete(node);
-    return target_node;
+    return tree_fetch_max_key(graph->nodes, &index, graph_node_key_cmp);
 }
 
 
@@ -455,6 +590,19 @@ int graph_add_edge (struct _graph * graph,
                     uint64_t head_needle,
                     uint64_t tail_needle,
                     const void * data)
+{
+    if (data == NULL)
+        return graph_add_edge_take(graph, head_needle, tail_needle, NULL);
+    return graph_add_edge_take(graph, head_needle, tail_needle,
+                               object_retain(data));
+}
+
+
+
+int graph_add_edge_take (struct _graph * graph,
+                         uint64_t head_needle,
+                         uint64_t tail_needle,
+                         void * data)
 {
     struct _graph_edge * edge;
     struct _graph_node * head_node;
@@ -463,25 +611,21 @@ int graph_add_edge (struct _graph * graph,
     head_node = graph_fetch_node(graph, head_needle);
     tail_node = graph_fetch_node(graph, tail_needle);
 
-    if ((head_node == NULL) || (tail_node == NULL))
-        return -1;
-
-    edge = graph_edge_create(head_node->index, tail_node->index, data);
-
     // do not add a duplicate edge
-    struct _list_it * it;
-    for (it = list_iterator(head_node->edges); it != NULL; it = it->next) {
-        struct _graph_edge * edge_ptr = it->data;
-        if (object_cmp(edge, edge_ptr) == 0) {
-            object_delete(edge);
-            return -1;
-        }
+    if (    (head_node == NULL)
+         || (tail_node == NULL)
+         || (graph_edges_find(graph, head_needle, tail_needle) != NULL)) {
+        if (data != NULL)
+            object_delete(data);
+        return -1;
     }
 
-    list_append(head_node->edges, edge);
-    list_append(tail_node->edges, edge);
+    edge = graph_edge_create(head_node->index, tail_node->index, NULL);
+    edge->data = data;
 
-    object_delete(edge);
+    graph_edges_add(graph, edge);
+    vector_append(head_node->edges, edge);
+    vector_append_take(tail_node->edges, edge);
 
     return 0;
 }
@@ -505,19 +649,21 @@ int graph_remove_edge (struct _graph * graph,
     edge.head = head_node->index;
     edge.tail = tail_node->index;
 
-    struct _list_it * it;
-    for (it = list_iterator(head_node->edges); it != NULL; it = it->next) {
-        edge_ptr = (struct _graph_edge *) it->data;
+    graph_edges_remove(graph, edge.head, edge.tail);
+
+    size_t i;
+    for (i = 0; i < head_node->edges->size; i++) {
+        edge_ptr = (struct _graph_edge *) head_node->edges->items[i];
         if ((edge_ptr->head == edge.head) && (edge_ptr->tail == edge.tail)) {
-            list_remove(head_node->edges, it);
+            vector_remove(head_node->edges, i);
             break;
         }
     }
 
-    for (it = list_iterator(tail_node->edges); it != NULL; it = it->next) {
-        edge_ptr = (struct _graph_edge *) it->data;
+    for (i = 0; i < tail_node->edges->size; i++) {
+        edge_ptr = (struct _graph_edge *) tail_node->edges->items[i];
         if ((edge_ptr->head == edge.head) && (edge_ptr->tail == edge.tail)) {
-            list_remove(tail_node->edges, it);
+            vector_remove(tail_node->edges, i);
             break;
         }
     }
@@ -533,50 +679,31 @@ void graph_map (struct _graph * graph, void (* callback) (struct _graph_node *))
 }
 
 
+// graph_bfs's callback takes the graph as well as the node
+struct _graph_bfs_callback {
+    struct _graph * graph;
+    void (* callback) (struct _graph *, struct _graph_node *);
+};
+
+
+static void graph_bfs_visit (struct _graph_node * node, void * data)
+{
+    struct _graph_bfs_callback * bfs = data;
+
+    bfs->callback(bfs->graph, node);
+}
+
+
 void graph_bfs (struct _graph * graph,
                 uint64_t        indx,
                 void  (* callback) (struct _graph *, struct _graph_node *))
 {
-    struct _queue       * queue   = queue_create();
-    struct _tree        * visited = tree_create();
-    struct _index * index;
+    struct _graph_bfs_callback bfs;
 
-    // add the first index to the graph
-    index = index_create(indx);
-    queue_push(queue, index);
-    object_delete(index);
-
-    while (queue->size > 0) {
-        index = object_copy(queue_peek(queue));
-        queue_pop(queue);
-        if (tree_fetch(visited, index) != NULL) {
-            object_delete(index);
-            continue;
-        }
-        tree_insert(visited, index);
+    bfs.graph    = graph;
+    bfs.callback = callback;
 
-        struct _graph_node * node = graph_fetch_node(graph, index->index);
-        if (node == NULL) {
-            printf("graph_bfs didn't find node %llx\n",
-                   (unsigned long long) index->index);
-        }
-        object_delete(index);
-
-        callback(graph, node);
-
-        // add successors to the queue
-        struct _list * successors = graph_node_successors(node);
-        struct _list_it * it;
-        for (it = list_iterator(successors); it != NULL; it = it->next) {
-            struct _graph_edge * edge = it->data;
-            index = index_create(edge->tail);
-            queue_push(queue, index);
-            object_delete(index);
-        }
-        object_delete(successors);
-    }
-    object_delete(queue);
-    object_delete(visited);
+    graph_bfs_data(graph, indx, &bfs, graph_bfs_visit);
 }
 
 
@@ -585,58 +712,26 @@ void graph_bfs_data (struct _graph * graph,
                      void          * data,
                      void (* callback) (struct _graph_node *, void * data))
 {
-    struct _queue       * queue   = queue_create();
-    struct _tree        * visited = tree_create();
-    struct _index * index;
+    struct _graph_walk * walk = graph_walk_create(graph);
 
-    // add the first index to the graph
-    index = index_create(indx);
-    queue_push(queue, index);
-    object_delete(index);
-
-    while (queue->size > 0) {
-        index = object_copy(queue_peek(queue));
-        queue_pop(queue);
-        if (tree_fetch(visited, index) != NULL) {
-            object_delete(index);
-            continue;
-        }
-        tree_insert(visited, index);
+    if (graph_walk_bfs(walk, indx, GRAPH_SUCCESSORS, callback, data))
+        printf("graph_bfs didn't find node %llx\n",
+               (unsigned long long) indx);
 
-        struct _graph_node * node = graph_fetch_node(graph, index->index);
-        if (node == NULL) {
-            printf("graph_bfs didn't find node %llx\n",
-                   (unsigned long long) index->index);
-        }
-        object_delete(index);
-
-        callback(node, data);
-
-        // add successors to the queue
-        struct _list * successors = graph_node_successors(node);
-        struct _list_it * it;
-        for (it = list_iterator(successors); it != NULL; it = it->next) {
-            struct _graph_edge * edge = it->data;
-            index = index_create(edge->tail);
-            queue_push(queue, index);
-            object_delete(index);
-        }
-        object_delete(successors);
-    }
-    object_delete(queue);
-    object_delete(visited);
+    object_delete(walk);
 }
 
 
 struct _graph_edge * graph_edge_create (uint64_t head, uint64_t tail, const void * data)
 {
     struct _graph_edge * edge;
-    edge = (struct _graph_edge *) malloc(sizeof(struct _graph_edge));
+    edge = (struct _graph_edge *) mem_alloc(sizeof(struct _graph_edge));
     if (data == NULL)
         edge->data = NULL;
     else
-        edge->data = object_copy(data);
+        edge->data = object_retain(data);
     edge->object = &graph_edge_object;
+    edge->refs = 1;
     edge->head = head;
     edge->tail = tail;
     return edge;
@@ -648,7 +743,7 @@ void graph_edge_delete (struct _graph_edge * edge)
 {
     if (edge->data != NULL)
         object_delete(edge->data);
-    free(edge);
+    mem_free(edge);
 }
 
 
@@ -680,15 +775,17 @@ struct _graph_node * graph_node_create (const struct _graph * graph,
                                         const void *          data)
 {
     struct _graph_node * node;
-    node = (struct _graph_node *) malloc(sizeof(struct _graph_node));
+    node = (struct _graph_node *) mem_alloc(sizeof(struct _graph_node));
     node->object = &graph_node_object;
+    node->refs   = 1;
     node->graph  = graph;
     node->index  = index;
+    node->id     = 0;
     if (data == NULL)
         node->data = NULL;
     else
-        node->data = object_copy(data);
-    node->edges = list_create();
+        node->data = object_retain(data);
+    node->edges = vector_create();
 
     return node;
 }
@@ -700,7 +797,7 @@ void graph_node_delete (struct _graph_node * node)
     if (node->data != NULL)
         object_delete(node->data);
     object_delete(node->edges);
-    free(node);
+    mem_free(node);
 }
 
 
@@ -711,6 +808,7 @@ struct _graph_node * graph_node_copy (const struct _graph_node * node)
     new_node = graph_node_create(node->graph, node->index, node->data);
     object_delete(new_node->edges);
     new_node->edges = object_copy(node->edges);
+    new_node->id    = node->id;
     return new_node;
 }
 
@@ -728,10 +826,10 @@ int graph_node_cmp (const struct _graph_node * lhs, const struct _graph_node * r
 
 inline size_t graph_node_successors_n (const struct _graph_node * node)
 {
-    struct _list_it * it;
+    size_t i;
     size_t successors = 0;
-    for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
+    for (i = 0; i < node->edges->size; i++) {
+        struct _graph_edge * edge = node->edges->items[i];
         if (edge->head == node->index)
             successors++;
     }
@@ -745,13 +843,13 @@ inline size_t graph_node_successors_n (const struct _graph_node * node)
 *   successor, and one is for successor to predecessor. We have to account for
 *   this and insure we only return one successor node.
 */
-struct _list * graph_node_successors (const struct _graph_node * node)
+struct _vector * graph_node_successors (const struct _graph_node * node)
 {
     int loop_count = 0;
-    struct _list_it * it;
-    struct _list * successors = list_create();
-    for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
+    size_t i;
+    struct _vector * successors = vector_create();
+    for (i = 0; i < node->edges->size; i++) {
+        struct _graph_edge * edge = node->edges->items[i];
         if (edge->head == node->index) {
             if (edge->head == edge->tail) {
                 if (loop_count == 0)
@@ -759,7 +857,7 @@ struct _list * graph_node_successors (const struct _graph_node * node)
                 else
                     continue;
             }
-            list_append(successors, edge);
+            vector_append(successors, edge);
         }
     }
     return successors;
@@ -769,10 +867,10 @@ struct _list * graph_node_successors (const struct _graph_node * node)
 
 size_t graph_node_predecessors_n (const struct _graph_node * node)
 {
-    struct _list_it * it;
+    size_t i;
     size_t predecessors = 0;
-    for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
+    for (i = 0; i < node->edges->size; i++) {
+        struct _graph_edge * edge = node->edges->items[i];
         if (edge->tail == node->index)
             predecessors++;
     }
@@ -783,13 +881,13 @@ size_t graph_node_predecessors_n (const struct _graph_node * node)
 /*
 *   See note for graph_node_predecessors
 */
-struct _list * graph_node_predecessors (const struct _graph_node * node)
+struct _vector * graph_node_predecessors (const struct _graph_node * node)
 {
     int loop_count = 0;
-    struct _list_it * it;
-    struct _list * predecessors = list_create();
-    for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
+    size_t i;
+    struct _vector * predecessors = vector_create();
+    for (i = 0; i < node->edges->size; i++) {
+        struct _graph_edge * edge = node->edges->items[i];
         if (edge->tail == node->index) {
             if (edge->head == edge->tail) {
                 if (loop_count == 0)
@@ -797,7 +895,7 @@ struct _list * graph_node_predecessors (const struct _graph_node * node)
                 else
                     continue;
             }
-            list_append(predecessors, edge);
+            vector_append(predecessors, edge);
         }
     }
     return predecessors;
@@ -805,15 +903,64 @@ struct _list * graph_node_predecessors (const struct _graph_node * node)
 
 
 
+struct _graph_edge * graph_edge_iter_first (struct _graph_edge_iter * iter,
+                                            const struct _graph_node * node,
+                                            int direction)
+{
+    iter->node      = node;
+    iter->i         = 0;
+    iter->direction = direction;
+    iter->loops     = 0;
+
+    return graph_edge_iter_next(iter);
+}
+
+
+struct _graph_edge * graph_successors_first (struct _graph_edge_iter * iter,
+                                             const struct _graph_node * node)
+{
+    return graph_edge_iter_first(iter, node, GRAPH_SUCCESSORS);
+}
+
+
+struct _graph_edge * graph_predecessors_first (struct _graph_edge_iter * iter,
+                                               const struct _graph_node * node)
+{
+    return graph_edge_iter_first(iter, node, GRAPH_PREDECESSORS);
+}
+
+
+// a self loop is listed twice by its node, see graph_node_successors
+struct _graph_edge * graph_edge_iter_next (struct _graph_edge_iter * iter)
+{
+    const struct _vector * edges = iter->node->edges;
+    uint64_t               index = iter->node->index;
+
+    while (iter->i < edges->size) {
+        struct _graph_edge * edge = edges->items[iter->i++];
+
+        if (    ! ((iter->direction & GRAPH_SUCCESSORS) && (edge->head == index))
+             && ! ((iter->direction & GRAPH_PREDECESSORS) && (edge->tail == index)))
+            continue;
+        if ((edge->head == edge->tail) && (iter->loops++ > 0))
+            continue;
+        return edge;
+    }
+
+    return NULL;
+}
+
+
+
 struct _graph_it * graph_iterator (const struct _graph * graph)
 {
     struct _graph_it * it;
 
-    it = malloc(sizeof(struct _graph_it));
+    it = mem_alloc(sizeof(struct _graph_it));
 
     it->it = tree_iterator(graph->nodes);
     if (it->it == NULL) {
-        free(it);
+        mem_free(it);
         return NULL;
     }
     return it;
@@ -823,7 +970,7 @@ struct _graph_it * graph_iterator (const struct _graph * graph)
 void graph_it_delete (struct _graph_it * graph_it)
 {
     tree_it_delete(graph_it->it);
-    free(graph_it);
+    mem_free(graph_it);
 }
 
 
@@ -831,7 +978,7 @@ struct _graph_it * graph_it_next (struct _graph_it * graph_it)
 {
     graph_it->it = tree_it_next(graph_it->it);
     if (graph_it->it == NULL) {
-        free(graph_it);
+        mem_free(graph_it);
         return NULL;
     }
     return graph_it;
@@ -868,11 +1015,24 @@ uint64_t graph_it_index (const struct _graph_it * graph_it)
 }
 
 
-struct _list * graph_it_edges (const struct _graph_it * graph_it)
+struct _vector * graph_it_edges (const struct _graph_it * graph_it)
 {
     struct _graph_node * node;
     node = tree_it_data(graph_it->it);
     if (node == NULL)
         return NULL;
     return node->edges;
+}
+
+
+struct _graph_node * graph_iter_first (struct _graph_iter * iter,
+                                       const struct _graph * graph)
+{
+    return tree_iter_first(&(iter->tree), graph->nodes);
+}
+
+
+struct _graph_node * graph_iter_next (struct _graph_iter * iter)
+{
+    return tree_iter_next(&(iter->tree));
 }
\ No newline at end of file
@@ -3,9 +3,10 @@
 
 #include <inttypes.h>
 
-#include "list.h"
+#include "hashmap.h"
 #include "object.h"
 #include "tree.h"
+#include "vector.h"
 
 // generic function pointers that need to be implemented for graph_node->data
 // delete, copy, merge
@@ -14,8 +15,26 @@ struct _graph_it {
     struct _tree_it * it;
 };
 
+struct _graph_iter {
+    struct _tree_iter tree;
+};
+
+// directions for graph_edge_iter_first
+#define GRAPH_SUCCESSORS   (1 << 0)
+#define GRAPH_PREDECESSORS (1 << 1)
+#define GRAPH_NEIGHBOURS   (GRAPH_SUCCESSORS | GRAPH_PREDECESSORS)
+
+// a node's edges, filtered by direction. see graph_successors_first
+struct _graph_edge_iter {
+    const struct _graph_node * node;
+    size_t                     i;
+    int                        direction;
+    int                        loops;
+};
+
 struct _graph_edge {
     const struct _object * object;
+    unsigned int           refs;
     void   * data;
     uint64_t head;
     uint64_t tail;
@@ -23,16 +42,28 @@ struct _graph_edge {
 
 struct _graph_node {
     const struct _object * object;
+    unsigned int           refs;
     const struct _graph * graph;
     uint64_t        index;
     void          * data;
-    struct _list  * edges;
+    struct _vector * edges;
+    size_t          id;
 };
 
+// nodes are kept in order in a tree, by dense id in ids, and by index in a
+// _hashmap, so looking a node up by index is O(1). edges are also kept in a
+// _hashmap keyed by head and tail, so checking for an edge is O(1) however
+// many edges its nodes have
 struct _graph {
     const struct _object * object;
+    unsigned int           refs;
     struct _tree         * nodes;
     uint64_t next_index;
+    size_t                 size;
+    size_t                 ids_size;
+    struct _graph_node  ** ids;
+    struct _hashmap      * index;
+    struct _hashmap      * edges;
 };
 
 
@@ -45,6 +76,12 @@ void graph_debug (const struct _graph * graph);
 struct _graph * graph_create      ();
 void            graph_delete      (struct _graph * graph);
 struct _graph * graph_copy        (const struct _graph * graph);
+// builds a graph without edges in O(n) from n nodes in strictly ascending
+// order of index. takes over the caller's references to data, which may be
+// NULL, but not the arrays holding them
+struct _graph * graph_build_sorted (const uint64_t * indices,
+                                    void ** data,
+                                    size_t n);
 
 /*
 * GENERAL GRAPH METHODS
@@ -53,7 +90,8 @@ struct _graph * graph_copy        (const struct _graph * graph);
 void graph_merge (struct _graph * graph, const struct _graph * rhs);
 
 // removes edges between nodes that are singly-linked and merges
-// their data
+// their data. to form basic blocks from an instruction graph use
+// ins_graph_to_block_graph (util.h), which is linear
 void graph_reduce (struct _graph * graph);
 
 // returns a graph that contains all reachable nodes from the given
@@ -64,6 +102,11 @@ void graph_add_node (struct _graph * graph,
                      uint64_t        index,
                      const void *    data);
 
+// like graph_add_node, but takes over the caller's reference to data
+void graph_add_node_take (struct _graph * graph,
+                          uint64_t        index,
+                          void *          data);
+
 uint64_t graph_add_node_autoindex (struct _graph * graph,const  void * data);
 
 void graph_remove_node (struct _graph * graph, uint64_t index);
@@ -72,16 +115,28 @@ struct _graph_node * graph_fetch_node  (const struct _graph * graph, uint64_t in
 
 void               * graph_fetch_data  (const struct _graph * graph, uint64_t index);
 
-struct _list       * graph_fetch_edges (const struct _graph * graph, uint64_t index);
+struct _vector     * graph_fetch_edges (const struct _graph * graph, uint64_t index);
 
 struct _graph_node * graph_fetch_node_max (const struct _graph * graph, uint64_t index);
 
+// nodes are numbered densely from 0 to graph->size - 1, so algorithms can keep
+// per-node state in flat arrays indexed by node->id. removing a node hands
+// its id to the node which had the highest id
+struct _graph_node * graph_node_by_id (const struct _graph * graph, size_t id);
+
 // returns -1 on error, 0 on success
 int graph_add_edge (struct _graph * graph,
                     uint64_t        head_needle,
                     uint64_t        tail_needle,
                     const void    * data);
 
+// like graph_add_edge, but takes over the caller's reference to data. data
+// is released if the edge is not added
+int graph_add_edge_take (struct _graph * graph,
+                         uint64_t        head_needle,
+                         uint64_t        tail_needle,
+                         void          * data);
+
 int graph_remove_edge (struct _graph * graph,
                        uint64_t head_needle,
                        uint64_t tail_needle);
@@ -121,11 +176,34 @@ int                  graph_node_cmp         (const struct _graph_node * lhs,
 /*
 * GRAPH NODE EDGE ACCESSORS
 */
-size_t         graph_node_successors_n   (const struct _graph_node * node);
-size_t         graph_node_predecessors_n (const struct _graph_node * node);
+size_t           graph_node_successors_n   (const struct _graph_node * node);
+size_t           graph_node_predecessors_n (const struct _graph_node * node);
 
-struct _list * graph_node_successors     (const struct _graph_node * node);
-struct _list * graph_node_predecessors   (const struct _graph_node * node);
+// snapshots of a node's successor or predecessor edges, for callers which
+// add or remove edges of the node while going through them
+struct _vector * graph_node_successors     (const struct _graph_node * node);
+struct _vector * graph_node_predecessors   (const struct _graph_node * node);
+
+/*
+* Edge iterators borrow the node's own edges and allocate nothing. they
+* return each successor (or predecessor) once, as graph_node_successors
+* does, and NULL when there are none left. the node must not gain or lose
+* edges while it is iterated
+*
+* struct _graph_edge_iter eit;
+* struct _graph_edge    * edge;
+* for (edge = graph_successors_first(&eit, node);
+*      edge != NULL;
+*      edge = graph_edge_iter_next(&eit)) {
+*/
+struct _graph_edge * graph_edge_iter_first    (struct _graph_edge_iter * iter,
+                                               const struct _graph_node * node,
+                                               int direction);
+struct _graph_edge * graph_successors_first   (struct _graph_edge_iter * iter,
+                                               const struct _graph_node * node);
+struct _graph_edge * graph_predecessors_first (struct _graph_edge_iter * iter,
+                                               const struct _graph_node * node);
+struct _graph_edge * graph_edge_iter_next     (struct _graph_edge_iter * iter);
 
 
 /*
@@ -141,7 +219,21 @@ struct _graph_it *   graph_it_next   (struct _graph_it * graph_it);
 void *               graph_it_data   (const struct _graph_it * graph_it);
 uint64_t             graph_it_index  (const struct _graph_it * graph_it);
 struct _graph_node * graph_it_node   (const struct _graph_it * graph_it);
-struct _list *       graph_it_edges  (const struct _graph_it * graph_it);
+struct _vector *     graph_it_edges  (const struct _graph_it * graph_it);
+
+/*
+* Stack iterators need no freeing, and are not leaked by breaking out of a
+* loop. first/next return NULL when there are no nodes left
+*
+* struct _graph_iter   git;
+* struct _graph_node * node;
+* for (node = graph_iter_first(&git, graph);
+*      node != NULL;
+*      node = graph_iter_next(&git)) {
+*/
+struct _graph_node * graph_iter_first (struct _graph_iter * iter,
+                                       const struct _graph * graph);
+struct _graph_node * graph_iter_next  (struct _graph_iter * iter);
 
 
 #endif
\ No newline at end of file
@@ -0,0 +1,292 @@
+#include "graph_walk.h"
+
+#include "arena.h"
+
+#include <string.h>
+
+static const struct _object graph_walk_object = {
+    (void     (*) (void *)) graph_walk_delete,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+struct _graph_walk * graph_walk_create (const struct _graph * graph)
+{
+    struct _graph_walk * walk;
+
+    walk = (struct _graph_walk *) mem_alloc(sizeof(struct _graph_walk));
+    walk->object     = &graph_walk_object;
+    walk->refs       = 1;
+    walk->graph      = graph;
+    walk->generation = 1;
+    walk->capacity   = 0;
+    walk->marks      = NULL;
+    walk->finished   = NULL;
+    walk->stack      = NULL;
+    walk->queue      = NULL;
+
+    return walk;
+}
+
+
+
+void graph_walk_delete (struct _graph_walk * walk)
+{
+    if (walk->capacity > 0) {
+        mem_free(walk->marks);
+        mem_free(walk->finished);
+        mem_free(walk->stack);
+        mem_free(walk->queue);
+    }
+    mem_free(walk);
+}
+
+
+
+void graph_walk_reset (struct _graph_walk * walk)
+{
+    walk->generation++;
+
+    // a mark left from 2^32 generations ago would look current
+    if (walk->generation == 0) {
+        memset(walk->marks,    0, sizeof(unsigned int) * walk->capacity);
+        memset(walk->finished, 0, sizeof(unsigned int) * walk->capacity);
+        walk->generation = 1;
+    }
+}
+
+
+
+int graph_walk_marked (const struct _graph_walk * walk,
+                       const struct _graph_node * node)
+{
+    if (node->id >= walk->capacity)
+        return 0;
+    return walk->marks[node->id] == walk->generation;
+}
+
+
+
+// grows the marks for nodes added to the graph since the last traversal.
+// new marks are 0, which is never a generation
+static void graph_walk_fit (struct _graph_walk * walk)
+{
+    size_t         capacity = walk->capacity;
+    unsigned int * marks;
+    unsigned int * finished;
+
+    if (walk->graph->size <= capacity)
+        return;
+
+    if (capacity == 0)
+        capacity = 16;
+    while (capacity < walk->graph->size)
+        capacity *= 2;
+
+    marks    = (unsigned int *) mem_alloc(sizeof(unsigned int) * capacity);
+    finished = (unsigned int *) mem_alloc(sizeof(unsigned int) * capacity);
+    memset(marks,    0, sizeof(unsigned int) * capacity);
+    memset(finished, 0, sizeof(unsigned int) * capacity);
+
+    if (walk->capacity > 0) {
+        memcpy(marks,    walk->marks,    sizeof(unsigned int) * walk->capacity);
+        memcpy(finished, walk->finished, sizeof(unsigned int) * walk->capacity);
+        mem_free(walk->marks);
+        mem_free(walk->finished);
+        mem_free(walk->stack);
+        mem_free(walk->queue);
+    }
+
+    walk->marks    = marks;
+    walk->finished = finished;
+    // a node is on the stack, or in the queue, at most once
+    walk->stack    = mem_alloc(sizeof(struct _graph_edge_iter) * capacity);
+    walk->queue    = mem_alloc(sizeof(struct _graph_node *) * capacity);
+    walk->capacity = capacity;
+}
+
+
+
+// returns the node index, if it is there and unmarked
+static struct _graph_node * graph_walk_start (struct _graph_walk * walk,
+                                              uint64_t index)
+{
+    struct _graph_node * node = graph_fetch_node(walk->graph, index);
+
+    graph_walk_fit(walk);
+
+    if ((node == NULL) || (walk->marks[node->id] == walk->generation))
+        return NULL;
+    return node;
+}
+
+
+
+// the node at the other end of edge from node
+static struct _graph_node * graph_walk_neighbour (const struct _graph_walk * walk,
+                                                  const struct _graph_node * node,
+                                                  const struct _graph_edge * edge)
+{
+    if (edge->head == node->index)
+        return graph_fetch_node(walk->graph, edge->tail);
+    return graph_fetch_node(walk->graph, edge->head);
+}
+
+
+
+int graph_walk_dfs (struct _graph_walk * walk,
+                    uint64_t index,
+                    int direction,
+                    graph_walk_node_f pre,
+                    graph_walk_node_f post,
+                    graph_walk_edge_f edge_callback,
+                    void * data)
+{
+    struct _graph_node      * node = graph_walk_start(walk, index);
+    struct _graph_node      * next;
+    struct _graph_edge      * edge;
+    struct _graph_edge_iter * top;
+    size_t                    depth = 0;
+    int                       type;
+
+    if (node == NULL)
+        return -1;
+
+    walk->marks[node->id] = walk->generation;
+    if (pre != NULL)
+        pre(node, data);
+    edge = graph_edge_iter_first(&(walk->stack[depth++]), node, direction);
+
+    // edge is the next edge to follow from the node on top of the stack, or
+    // NULL once that node has none left
+    while (depth > 0) {
+        top  = &(walk->stack[depth - 1]);
+        node = (struct _graph_node *) top->node;
+
+        if (edge == NULL) {
+            walk->finished[node->id] = walk->generation;
+            if (post != NULL)
+                post(node, data);
+            depth--;
+            if (depth > 0)
+                edge = graph_edge_iter_next(&(walk->stack[depth - 1]));
+            continue;
+        }
+
+        next = graph_walk_neighbour(walk, node, edge);
+
+        if (walk->marks[next->id] != walk->generation)
+            type = GRAPH_WALK_TREE;
+        else if (walk->finished[next->id] != walk->generation)
+            type = GRAPH_WALK_BACK;
+        else
+            type = GRAPH_WALK_VISITED;
+
+        if (edge_callback != NULL)
+            edge_callback(edge, type, data);
+
+        if (type != GRAPH_WALK_TREE) {
+            edge = graph_edge_iter_next(top);
+            continue;
+        }
+
+        walk->marks[next->id] = walk->generation;
+        if (pre != NULL)
+            pre(next, data);
+        edge = graph_edge_iter_first(&(walk->stack[depth++]), next, direction);
+    }
+
+    return 0;
+}
+
+
+
+int graph_walk_bfs (struct _graph_walk * walk,
+                    uint64_t index,
+                    int direction,
+                    graph_walk_node_f visit,
+                    void * data)
+{
+    struct _graph_node    * node = graph_walk_start(walk, index);
+    struct _graph_node    * next;
+    struct _graph_edge_iter eit;
+    struct _graph_edge    * edge;
+    size_t                  front = 0;
+    size_t                  back  = 0;
+
+    if (node == NULL)
+        return -1;
+
+    // nodes are marked as they are queued, so each is queued once
+    walk->marks[node->id] = walk->generation;
+    walk->queue[back++] = node;
+
+    while (front < back) {
+        node = walk->queue[front++];
+
+        // so a later depth-first traversal does not take it for a cycle
+        walk->finished[node->id] = walk->generation;
+
+        if (visit != NULL)
+            visit(node, data);
+
+        for (edge = graph_edge_iter_first(&eit, node, direction);
+             edge != NULL;
+             edge = graph_edge_iter_next(&eit)) {
+            next = graph_walk_neighbour(walk, node, edge);
+            if (walk->marks[next->id] == walk->generation)
+                continue;
+            walk->marks[next->id] = walk->generation;
+            walk->queue[back++] = next;
+        }
+    }
+
+    return 0;
+}
+
+
+
+struct _graph_walk_order {
+    struct _graph_node ** order;
+    size_t                size;
+};
+
+
+static void graph_walk_rpo_post (struct _graph_node * node, void * data)
+{
+    struct _graph_walk_order * order = data;
+
+    order->order[order->size++] = node;
+}
+
+
+size_t graph_walk_rpo (struct _graph_walk * walk,
+                       uint64_t index,
+                       int direction,
+                       struct _graph_node ** order)
+{
+    struct _graph_walk_order post_order;
+    struct _graph_node     * node;
+    size_t                   i;
+
+    post_order.order = order;
+    post_order.size  = 0;
+
+    graph_walk_dfs(walk,
+                   index,
+                   direction,
+                   NULL,
+                   graph_walk_rpo_post,
+                   NULL,
+                   &post_order);
+
+    for (i = 0; i < post_order.size / 2; i++) {
+        node = order[i];
+        order[i] = order[post_order.size - 1 - i];
+        order[post_order.size - 1 - i] = node;
+    }
+
+    return post_order.size;
+}
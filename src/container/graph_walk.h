@@ -0,0 +1,92 @@
+#ifndef graph_walk_HEADER
+#define graph_walk_HEADER
+
+// iterative traversals of a _graph
+//
+// a walk keeps one visit mark per node, indexed by node->id. a node is marked
+// when its mark equals the walk's generation, so graph_walk_reset forgets
+// every mark in O(1) by moving to the next generation. the marks and the
+// stack and queue the traversals work in are kept by the walk, so a walk
+// reused for several traversals allocates only when the graph grows
+//
+// traversals do not reset the walk themselves. a node marked by an earlier
+// traversal is treated as already reached, which lets one traversal pick up
+// where another left off. nodes reached from index are visited, in the
+// direction given, GRAPH_SUCCESSORS, GRAPH_PREDECESSORS or GRAPH_NEIGHBOURS
+// (see graph.h)
+//
+// callbacks must not add or remove nodes or edges. collect them and change
+// the graph once the traversal returns
+
+#include <stdlib.h>
+
+#include "graph.h"
+#include "object.h"
+
+// the kinds of edges passed to a depth-first edge callback
+// leads to a node reached for the first time, which is walked next
+#define GRAPH_WALK_TREE    0
+// leads to a node still on the depth-first path, closing a cycle
+#define GRAPH_WALK_BACK    1
+// leads to a node already finished, a forward or cross edge, or to a node
+// marked by an earlier traversal
+#define GRAPH_WALK_VISITED 2
+
+typedef void (* graph_walk_node_f) (struct _graph_node * node, void * data);
+typedef void (* graph_walk_edge_f) (struct _graph_edge * edge,
+                                    int type,
+                                    void * data);
+
+struct _graph_walk {
+    const struct _object    * object;
+    unsigned int              refs;
+    const struct _graph     * graph;
+    unsigned int              generation;
+    // entries for node ids up to capacity
+    size_t                    capacity;
+    // marks[id] == generation once node id has been reached
+    unsigned int            * marks;
+    // finished[id] == generation once a depth-first traversal has left it
+    unsigned int            * finished;
+    struct _graph_edge_iter * stack;
+    struct _graph_node     ** queue;
+};
+
+
+struct _graph_walk * graph_walk_create (const struct _graph * graph);
+void                 graph_walk_delete (struct _graph_walk * walk);
+
+// unmarks every node
+void graph_walk_reset  (struct _graph_walk * walk);
+int  graph_walk_marked (const struct _graph_walk * walk,
+                        const struct _graph_node * node);
+
+// depth-first from index. pre is called as each node is reached, post as it
+// is left, and edge for every edge followed, with its GRAPH_WALK_ type. any
+// callback may be NULL. returns -1 if there is no node index, or it is
+// already marked
+int graph_walk_dfs (struct _graph_walk * walk,
+                    uint64_t index,
+                    int direction,
+                    graph_walk_node_f pre,
+                    graph_walk_node_f post,
+                    graph_walk_edge_f edge,
+                    void * data);
+
+// breadth-first from index, calling visit for each node in the order nodes
+// are reached. returns -1 if there is no node index, or it is already marked
+int graph_walk_bfs (struct _graph_walk * walk,
+                    uint64_t index,
+                    int direction,
+                    graph_walk_node_f visit,
+                    void * data);
+
+// fills order, which must have room for graph->size nodes, with the nodes
+// reached from index in reverse post-order, and returns how many there are.
+// in an acyclic graph this is a topological order
+size_t graph_walk_rpo (struct _graph_walk * walk,
+                       uint64_t index,
+                       int direction,
+                       struct _graph_node ** order);
+
+#endif
@@ -0,0 +1,655 @@
+#include "hashmap.h"
+
+#include "arena.h"
+
+// a new table has 1 << HASHMAP_MIN_BITS slots
+#define HASHMAP_MIN_BITS 4
+
+static const struct _object hashmap_object = {
+    (void     (*) (void *))       hashmap_delete,
+    (void *   (*) (const void *)) hashmap_copy,
+    NULL,
+    NULL
+};
+
+static const struct _object hashset_object = {
+    (void     (*) (void *))       hashset_delete,
+    (void *   (*) (const void *)) hashset_copy,
+    NULL,
+    NULL
+};
+
+
+
+/*
+* THE TABLE
+*
+* maps and sets share their probing. used marks the occupied slots, since any
+* key, 0 included, is a valid key. values is NULL for sets. a key is width
+* words, 1, or 2 for tables keyed by pairs, stored together in keys
+*/
+static size_t hash_slot (unsigned int bits,
+                         unsigned int width,
+                         const uint64_t * key)
+{
+    uint64_t hash = key[0];
+
+    if (width == 2)
+        hash = (hash * 0x9e3779b97f4a7c15ULL) ^ key[1];
+
+    // fibonacci hashing, so addresses a fixed stride apart still spread out
+    return (size_t) ((hash * 0x9e3779b97f4a7c15ULL) >> (64 - bits));
+}
+
+
+static int hash_key_is (const uint64_t * keys,
+                        size_t           slot,
+                        unsigned int     width,
+                        const uint64_t * key)
+{
+    keys += slot * width;
+    return (keys[0] == key[0]) && ((width == 1) || (keys[1] == key[1]));
+}
+
+
+static void hash_key_set (uint64_t       * keys,
+                          size_t           slot,
+                          unsigned int     width,
+                          const uint64_t * key)
+{
+    keys[slot * width] = key[0];
+    if (width == 2)
+        keys[slot * width + 1] = key[1];
+}
+
+
+// returns the slot holding key, or the empty slot where key would go
+static size_t hash_probe (unsigned int          bits,
+                          unsigned int          width,
+                          const unsigned char * used,
+                          const uint64_t      * keys,
+                          const uint64_t      * key)
+{
+    size_t mask = ((size_t) 1 << bits) - 1;
+    size_t slot = hash_slot(bits, width, key);
+
+    while (used[slot] && (! hash_key_is(keys, slot, width, key)))
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+
+static void hash_alloc (unsigned int     bits,
+                        unsigned int     width,
+                        unsigned char ** used,
+                        uint64_t      ** keys,
+                        void        *** values)
+{
+    size_t slots = (size_t) 1 << bits;
+    size_t i;
+
+    *used = (unsigned char *) mem_alloc(slots);
+    *keys = (uint64_t *) mem_alloc(sizeof(uint64_t) * width * slots);
+    if (values != NULL)
+        *values = (void **) mem_alloc(sizeof(void *) * slots);
+    for (i = 0; i < slots; i++)
+        (*used)[i] = 0;
+}
+
+
+// empties slot, pulling back any later entry of the run that would
+// otherwise become unreachable from its home slot
+static void hash_erase (unsigned int    bits,
+                        unsigned int    width,
+                        unsigned char * used,
+                        uint64_t      * keys,
+                        void         ** values,
+                        size_t          slot)
+{
+    size_t mask = ((size_t) 1 << bits) - 1;
+    size_t next;
+    size_t home;
+
+    for (next = (slot + 1) & mask; used[next]; next = (next + 1) & mask) {
+        home = hash_slot(bits, width, &(keys[next * width]));
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            hash_key_set(keys, slot, width, &(keys[next * width]));
+            if (values != NULL)
+                values[slot] = values[next];
+            slot = next;
+        }
+    }
+    used[slot] = 0;
+}
+
+
+// moves every entry of the old table into the new, larger, one
+static void hash_rehash (unsigned int          bits,
+                         unsigned int          width,
+                         unsigned char       * used,
+                         uint64_t            * keys,
+                         void               ** values,
+                         size_t                old_slots,
+                         const unsigned char * old_used,
+                         const uint64_t      * old_keys,
+                         void * const        * old_values)
+{
+    size_t i, slot;
+
+    for (i = 0; i < old_slots; i++) {
+        if (! old_used[i])
+            continue;
+        slot = hash_probe(bits, width, used, keys, &(old_keys[i * width]));
+        used[slot] = 1;
+        hash_key_set(keys, slot, width, &(old_keys[i * width]));
+        if (values != NULL)
+            values[slot] = old_values[i];
+    }
+}
+
+
+
+/*
+* HASHMAP
+*/
+static struct _hashmap * hashmap_create_width (unsigned int width)
+{
+    struct _hashmap * hashmap;
+
+    hashmap = (struct _hashmap *) mem_alloc(sizeof(struct _hashmap));
+    hashmap->object = &hashmap_object;
+    hashmap->refs   = 1;
+    hashmap->size   = 0;
+    hashmap->bits   = HASHMAP_MIN_BITS;
+    hashmap->width  = width;
+    hash_alloc(hashmap->bits,
+               width,
+               &hashmap->used,
+               &hashmap->keys,
+               &hashmap->values);
+
+    return hashmap;
+}
+
+
+struct _hashmap * hashmap_create ()
+{
+    return hashmap_create_width(1);
+}
+
+
+struct _hashmap * hashmap_create_pairs ()
+{
+    return hashmap_create_width(2);
+}
+
+
+
+void hashmap_delete (struct _hashmap * hashmap)
+{
+    size_t i;
+
+    for (i = 0; i < ((size_t) 1 << hashmap->bits); i++) {
+        if ((hashmap->used[i]) && (hashmap->values[i] != NULL))
+            object_delete(hashmap->values[i]);
+    }
+
+    mem_free(hashmap->used);
+    mem_free(hashmap->keys);
+    mem_free(hashmap->values);
+    mem_free(hashmap);
+}
+
+
+
+struct _hashmap * hashmap_copy (const struct _hashmap * hashmap)
+{
+    struct _hashmap * new_hashmap;
+    size_t            slots = (size_t) 1 << hashmap->bits;
+    size_t            i;
+
+    new_hashmap = (struct _hashmap *) mem_alloc(sizeof(struct _hashmap));
+    new_hashmap->object = &hashmap_object;
+    new_hashmap->refs   = 1;
+    new_hashmap->size   = hashmap->size;
+    new_hashmap->bits   = hashmap->bits;
+    new_hashmap->width  = hashmap->width;
+    hash_alloc(new_hashmap->bits,
+               new_hashmap->width,
+               &new_hashmap->used,
+               &new_hashmap->keys,
+               &new_hashmap->values);
+
+    // same table size, so every entry keeps its slot
+    for (i = 0; i < slots; i++) {
+        if (! hashmap->used[i])
+            continue;
+        new_hashmap->used[i] = 1;
+        hash_key_set(new_hashmap->keys,
+                     i,
+                     hashmap->width,
+                     &(hashmap->keys[i * hashmap->width]));
+        if (hashmap->values[i] == NULL)
+            new_hashmap->values[i] = NULL;
+        else
+            new_hashmap->values[i] = object_retain(hashmap->values[i]);
+    }
+
+    return new_hashmap;
+}
+
+
+
+static void hashmap_grow (struct _hashmap * hashmap)
+{
+    unsigned char * used   = hashmap->used;
+    uint64_t      * keys   = hashmap->keys;
+    void         ** values = hashmap->values;
+
+    hashmap->bits++;
+    hash_alloc(hashmap->bits,
+               hashmap->width,
+               &hashmap->used,
+               &hashmap->keys,
+               &hashmap->values);
+    hash_rehash(hashmap->bits, hashmap->width,
+                hashmap->used, hashmap->keys, hashmap->values,
+                (size_t) 1 << (hashmap->bits - 1), used, keys, values);
+
+    mem_free(used);
+    mem_free(keys);
+    mem_free(values);
+}
+
+
+
+static int hashmap_insert_key (struct _hashmap * hashmap,
+                               const uint64_t * key,
+                               void * value)
+{
+    size_t slot;
+
+    slot = hash_probe(hashmap->bits, hashmap->width,
+                      hashmap->used, hashmap->keys, key);
+    if (hashmap->used[slot]) {
+        if (value != NULL)
+            object_delete(value);
+        return -1;
+    }
+
+    if (((hashmap->size + 1) * 2) > ((size_t) 1 << hashmap->bits)) {
+        hashmap_grow(hashmap);
+        slot = hash_probe(hashmap->bits, hashmap->width,
+                          hashmap->used, hashmap->keys, key);
+    }
+
+    hashmap->used[slot]   = 1;
+    hash_key_set(hashmap->keys, slot, hashmap->width, key);
+    hashmap->values[slot] = value;
+    hashmap->size++;
+
+    return 0;
+}
+
+
+static void * hashmap_fetch_key (const struct _hashmap * hashmap,
+                                 const uint64_t * key)
+{
+    size_t slot;
+
+    slot = hash_probe(hashmap->bits, hashmap->width,
+                      hashmap->used, hashmap->keys, key);
+    if (hashmap->used[slot])
+        return hashmap->values[slot];
+    return NULL;
+}
+
+
+static int hashmap_contains_key (const struct _hashmap * hashmap,
+                                 const uint64_t * key)
+{
+    size_t slot;
+
+    slot = hash_probe(hashmap->bits, hashmap->width,
+                      hashmap->used, hashmap->keys, key);
+    return hashmap->used[slot];
+}
+
+
+static int hashmap_remove_key (struct _hashmap * hashmap, const uint64_t * key)
+{
+    size_t slot;
+
+    slot = hash_probe(hashmap->bits, hashmap->width,
+                      hashmap->used, hashmap->keys, key);
+    if (! hashmap->used[slot])
+        return -1;
+
+    if (hashmap->values[slot] != NULL)
+        object_delete(hashmap->values[slot]);
+    hash_erase(hashmap->bits,
+               hashmap->width,
+               hashmap->used,
+               hashmap->keys,
+               hashmap->values,
+               slot);
+    hashmap->size--;
+
+    return 0;
+}
+
+
+
+int hashmap_insert (struct _hashmap * hashmap, uint64_t key, const void * value)
+{
+    if (value == NULL)
+        return hashmap_insert_key(hashmap, &key, NULL);
+    return hashmap_insert_key(hashmap, &key, object_retain(value));
+}
+
+
+int hashmap_insert_take (struct _hashmap * hashmap, uint64_t key, void * value)
+{
+    return hashmap_insert_key(hashmap, &key, value);
+}
+
+
+void * hashmap_fetch (const struct _hashmap * hashmap, uint64_t key)
+{
+    return hashmap_fetch_key(hashmap, &key);
+}
+
+
+int hashmap_contains (const struct _hashmap * hashmap, uint64_t key)
+{
+    return hashmap_contains_key(hashmap, &key);
+}
+
+
+int hashmap_remove (struct _hashmap * hashmap, uint64_t key)
+{
+    return hashmap_remove_key(hashmap, &key);
+}
+
+
+
+int hashmap_insert_pair (struct _hashmap * hashmap,
+                         uint64_t key,
+                         uint64_t key2,
+                         const void * value)
+{
+    uint64_t pair[2] = {key, key2};
+
+    if (value == NULL)
+        return hashmap_insert_key(hashmap, pair, NULL);
+    return hashmap_insert_key(hashmap, pair, object_retain(value));
+}
+
+
+void * hashmap_fetch_pair (const struct _hashmap * hashmap,
+                           uint64_t key,
+                           uint64_t key2)
+{
+    uint64_t pair[2] = {key, key2};
+
+    return hashmap_fetch_key(hashmap, pair);
+}
+
+
+int hashmap_remove_pair (struct _hashmap * hashmap, uint64_t key, uint64_t key2)
+{
+    uint64_t pair[2] = {key, key2};
+
+    return hashmap_remove_key(hashmap, pair);
+}
+
+
+
+// leaves iter on the first occupied slot from slot onwards
+static int hashmap_iter_seek (struct _hashmap_iter * iter, size_t slot)
+{
+    const struct _hashmap * hashmap = iter->hashmap;
+    size_t                  slots   = (size_t) 1 << hashmap->bits;
+
+    while ((slot < slots) && (! hashmap->used[slot]))
+        slot++;
+    iter->slot = slot;
+    if (slot == slots)
+        return 0;
+
+    iter->key   = hashmap->keys[slot * hashmap->width];
+    iter->key2  = hashmap->keys[slot * hashmap->width + hashmap->width - 1];
+    iter->value = hashmap->values[slot];
+    return 1;
+}
+
+
+int hashmap_iter_first (struct _hashmap_iter * iter,
+                        const struct _hashmap * hashmap)
+{
+    iter->hashmap = hashmap;
+    return hashmap_iter_seek(iter, 0);
+}
+
+
+int hashmap_iter_next (struct _hashmap_iter * iter)
+{
+    return hashmap_iter_seek(iter, iter->slot + 1);
+}
+
+
+
+/*
+* HASHSET
+*/
+static struct _hashset * hashset_create_width (unsigned int width)
+{
+    struct _hashset * hashset;
+
+    hashset = (struct _hashset *) mem_alloc(sizeof(struct _hashset));
+    hashset->object = &hashset_object;
+    hashset->refs   = 1;
+    hashset->size   = 0;
+    hashset->bits   = HASHMAP_MIN_BITS;
+    hashset->width  = width;
+    hash_alloc(hashset->bits, width, &hashset->used, &hashset->keys, NULL);
+
+    return hashset;
+}
+
+
+struct _hashset * hashset_create ()
+{
+    return hashset_create_width(1);
+}
+
+
+struct _hashset * hashset_create_pairs ()
+{
+    return hashset_create_width(2);
+}
+
+
+
+void hashset_delete (struct _hashset * hashset)
+{
+    mem_free(hashset->used);
+    mem_free(hashset->keys);
+    mem_free(hashset);
+}
+
+
+
+struct _hashset * hashset_copy (const struct _hashset * hashset)
+{
+    struct _hashset * new_hashset;
+    size_t            slots = (size_t) 1 << hashset->bits;
+    size_t            i;
+
+    new_hashset = (struct _hashset *) mem_alloc(sizeof(struct _hashset));
+    new_hashset->object = &hashset_object;
+    new_hashset->refs   = 1;
+    new_hashset->size   = hashset->size;
+    new_hashset->bits   = hashset->bits;
+    new_hashset->width  = hashset->width;
+    hash_alloc(new_hashset->bits,
+               new_hashset->width,
+               &new_hashset->used,
+               &new_hashset->keys,
+               NULL);
+
+    for (i = 0; i < slots; i++)
+        new_hashset->used[i] = hashset->used[i];
+    for (i = 0; i < slots * hashset->width; i++)
+        new_hashset->keys[i] = hashset->keys[i];
+
+    return new_hashset;
+}
+
+
+
+static void hashset_grow (struct _hashset * hashset)
+{
+    unsigned char * used = hashset->used;
+    uint64_t      * keys = hashset->keys;
+
+    hashset->bits++;
+    hash_alloc(hashset->bits, hashset->width,
+               &hashset->used, &hashset->keys, NULL);
+    hash_rehash(hashset->bits, hashset->width,
+                hashset->used, hashset->keys, NULL,
+                (size_t) 1 << (hashset->bits - 1), used, keys, NULL);
+
+    mem_free(used);
+    mem_free(keys);
+}
+
+
+
+static int hashset_insert_key (struct _hashset * hashset, const uint64_t * key)
+{
+    size_t slot;
+
+    slot = hash_probe(hashset->bits, hashset->width,
+                      hashset->used, hashset->keys, key);
+    if (hashset->used[slot])
+        return -1;
+
+    if (((hashset->size + 1) * 2) > ((size_t) 1 << hashset->bits)) {
+        hashset_grow(hashset);
+        slot = hash_probe(hashset->bits, hashset->width,
+                          hashset->used, hashset->keys, key);
+    }
+
+    hashset->used[slot] = 1;
+    hash_key_set(hashset->keys, slot, hashset->width, key);
+    hashset->size++;
+
+    return 0;
+}
+
+
+static int hashset_contains_key (const struct _hashset * hashset,
+                                 const uint64_t * key)
+{
+    size_t slot;
+
+    slot = hash_probe(hashset->bits, hashset->width,
+                      hashset->used, hashset->keys, key);
+    return hashset->used[slot];
+}
+
+
+static int hashset_remove_key (struct _hashset * hashset, const uint64_t * key)
+{
+    size_t slot;
+
+    slot = hash_probe(hashset->bits, hashset->width,
+                      hashset->used, hashset->keys, key);
+    if (! hashset->used[slot])
+        return -1;
+
+    hash_erase(hashset->bits, hashset->width,
+               hashset->used, hashset->keys, NULL, slot);
+    hashset->size--;
+
+    return 0;
+}
+
+
+
+int hashset_insert (struct _hashset * hashset, uint64_t key)
+{
+    return hashset_insert_key(hashset, &key);
+}
+
+
+int hashset_contains (const struct _hashset * hashset, uint64_t key)
+{
+    return hashset_contains_key(hashset, &key);
+}
+
+
+int hashset_remove (struct _hashset * hashset, uint64_t key)
+{
+    return hashset_remove_key(hashset, &key);
+}
+
+
+
+int hashset_insert_pair (struct _hashset * hashset, uint64_t key, uint64_t key2)
+{
+    uint64_t pair[2] = {key, key2};
+
+    return hashset_insert_key(hashset, pair);
+}
+
+
+int hashset_contains_pair (const struct _hashset * hashset,
+                           uint64_t key,
+                           uint64_t key2)
+{
+    uint64_t pair[2] = {key, key2};
+
+    return hashset_contains_key(hashset, pair);
+}
+
+
+int hashset_remove_pair (struct _hashset * hashset, uint64_t key, uint64_t key2)
+{
+    uint64_t pair[2] = {key, key2};
+
+    return hashset_remove_key(hashset, pair);
+}
+
+
+
+static int hashset_iter_seek (struct _hashset_iter * iter, size_t slot)
+{
+    const struct _hashset * hashset = iter->hashset;
+    size_t                  slots   = (size_t) 1 << hashset->bits;
+
+    while ((slot < slots) && (! hashset->used[slot]))
+        slot++;
+    iter->slot = slot;
+    if (slot == slots)
+        return 0;
+
+    iter->key  = hashset->keys[slot * hashset->width];
+    iter->key2 = hashset->keys[slot * hashset->width + hashset->width - 1];
+    return 1;
+}
+
+
+int hashset_iter_first (struct _hashset_iter * iter,
+                        const struct _hashset * hashset)
+{
+    iter->hashset = hashset;
+    return hashset_iter_seek(iter, 0);
+}
+
+
+int hashset_iter_next (struct _hashset_iter * iter)
+{
+    return hashset_iter_seek(iter, iter->slot + 1);
+}
@@ -0,0 +1,111 @@
+#ifndef hashmap_HEADER
+#define hashmap_HEADER
+
+// unordered maps of uint64_t to values, and sets of uint64_t
+//
+// both are open addressing hash tables, probed linearly and kept at most
+// half full, so a lookup is usually one or two adjacent slots. they are for
+// the many places which only ask whether an address has been seen. use a
+// _map when entries are wanted in order
+//
+// a table created with _create_pairs is keyed by pairs of uint64_t instead,
+// such as the head and tail of an edge, and is only used through the _pair
+// functions
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "object.h"
+
+struct _hashmap {
+    const struct _object * object;
+    unsigned int           refs;
+    size_t                 size;
+    // the table has 1 << bits slots
+    unsigned int           bits;
+    // words per key, 1, or 2 for pairs
+    unsigned int           width;
+    unsigned char        * used;
+    uint64_t             * keys;
+    void                ** values;
+};
+
+struct _hashset {
+    const struct _object * object;
+    unsigned int           refs;
+    size_t                 size;
+    unsigned int           bits;
+    unsigned int           width;
+    unsigned char        * used;
+    uint64_t             * keys;
+};
+
+
+// stack iterators. while first/next return 1, key (and value) hold the
+// current entry. they return 0 when there are no entries left. entries come
+// in no particular order, and the table must not change while iterating.
+// key2 is the second key of a pair
+struct _hashmap_iter {
+    uint64_t                key;
+    uint64_t                key2;
+    void                  * value;
+    const struct _hashmap * hashmap;
+    size_t                  slot;
+};
+
+struct _hashset_iter {
+    uint64_t                key;
+    uint64_t                key2;
+    const struct _hashset * hashset;
+    size_t                  slot;
+};
+
+
+struct _hashmap * hashmap_create ();
+void              hashmap_delete (struct _hashmap * hashmap);
+struct _hashmap * hashmap_copy   (const struct _hashmap * hashmap);
+
+// returns 0 on success, -1 on error (key already exists). value may be NULL
+int    hashmap_insert      (struct _hashmap *, uint64_t key, const void * value);
+// like hashmap_insert, but takes over the caller's reference to value. if
+// key already exists value is released
+int    hashmap_insert_take (struct _hashmap *, uint64_t key, void * value);
+void * hashmap_fetch       (const struct _hashmap *, uint64_t key);
+// returns 1 if key is in the map, even when its value is NULL
+int    hashmap_contains    (const struct _hashmap *, uint64_t key);
+// returns 0 on success, -1 if key was not in the map
+int    hashmap_remove      (struct _hashmap *, uint64_t key);
+
+struct _hashmap * hashmap_create_pairs ();
+int    hashmap_insert_pair (struct _hashmap *,
+                            uint64_t key,
+                            uint64_t key2,
+                            const void * value);
+void * hashmap_fetch_pair  (const struct _hashmap *, uint64_t key, uint64_t key2);
+int    hashmap_remove_pair (struct _hashmap *, uint64_t key, uint64_t key2);
+
+int hashmap_iter_first (struct _hashmap_iter * iter,
+                        const struct _hashmap * hashmap);
+int hashmap_iter_next  (struct _hashmap_iter * iter);
+
+
+struct _hashset * hashset_create ();
+void              hashset_delete (struct _hashset * hashset);
+struct _hashset * hashset_copy   (const struct _hashset * hashset);
+
+// returns 0 if key was added, -1 if it was already in the set
+int hashset_insert   (struct _hashset *, uint64_t key);
+int hashset_contains (const struct _hashset *, uint64_t key);
+// returns 0 on success, -1 if key was not in the set
+int hashset_remove   (struct _hashset *, uint64_t key);
+
+struct _hashset * hashset_create_pairs ();
+int hashset_insert_pair   (struct _hashset *, uint64_t key, uint64_t key2);
+int hashset_contains_pair (const struct _hashset *, uint64_t key, uint64_t key2);
+int hashset_remove_pair   (struct _hashset *, uint64_t key, uint64_t key2);
+
+int hashset_iter_first (struct _hashset_iter * iter,
+                        const struct _hashset * hashset);
+int hashset_iter_next  (struct _hashset_iter * iter);
+
+#endif
@@ -1,5 +1,7 @@
 #include "index.h"
 
+#include "arena.h"
+
 #include <stdlib.h>
 
 static const struct _object index_object = {
@@ -14,8 +16,9 @@ static const struct _object index_object = {
 struct _index * index_create (uint64_t index)
 {
     struct _index * index_ptr;
-    index_ptr = (struct _index *) malloc(sizeof(struct _index));
+    index_ptr = (struct _index *) mem_alloc(sizeof(struct _index));
     index_ptr->object = &index_object;
+    index_ptr->refs   = 1;
     index_ptr->index  = index;
     return index_ptr;
 }
@@ -24,7 +27,7 @@ struct _index * index_create (uint64_t index)
 
 void index_delete (struct _index * index)
 {
-    free(index);
+    mem_free(index);
 }
 
 
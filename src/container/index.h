@@ -10,6 +10,7 @@
 
 struct _index {
     const struct _object * object;
+    unsigned int           refs;
     uint64_t index;
 };
 
@@ -0,0 +1,359 @@
+#include "ins_store.h"
+
+#include <string.h>
+
+// a new store has room for INS_STORE_MIN instructions
+#define INS_STORE_MIN      64
+#define INS_STORE_MIN_BITS 7
+
+static const struct _object ins_store_object = {
+    (void     (*) (void *))       ins_store_delete,
+    (void *   (*) (const void *)) ins_store_copy,
+    NULL,
+    NULL
+};
+
+
+struct _ins_store * ins_store_create ()
+{
+    struct _ins_store * store;
+
+    store = (struct _ins_store *) malloc(sizeof(struct _ins_store));
+    store->object         = &ins_store_object;
+    store->refs           = 1;
+    store->size           = 0;
+    store->capacity       = INS_STORE_MIN;
+    store->edges          = 0;
+    store->edges_capacity = INS_STORE_MIN;
+
+    store->addresses       = malloc(sizeof(uint64_t) * store->capacity);
+    store->sizes           = malloc(store->capacity);
+    store->flags           = malloc(store->capacity);
+    store->descriptions    = malloc(sizeof(const char *) * store->capacity);
+    store->successor_start = malloc(sizeof(uint32_t) * (store->capacity + 1));
+    store->successor_start[0] = 0;
+
+    store->successor_addresses = malloc(sizeof(uint64_t) * store->edges_capacity);
+    store->successor_types     = malloc(store->edges_capacity);
+
+    store->bits  = INS_STORE_MIN_BITS;
+    store->slots = calloc((size_t) 1 << store->bits, sizeof(uint32_t));
+
+    return store;
+}
+
+
+
+void ins_store_delete (struct _ins_store * store)
+{
+    free(store->addresses);
+    free(store->sizes);
+    free(store->flags);
+    free(store->descriptions);
+    free(store->successor_start);
+    free(store->successor_addresses);
+    free(store->successor_types);
+    free(store->slots);
+    free(store);
+}
+
+
+
+struct _ins_store * ins_store_copy (const struct _ins_store * store)
+{
+    struct _ins_store * new_store;
+    size_t              slots = (size_t) 1 << store->bits;
+
+    new_store = (struct _ins_store *) malloc(sizeof(struct _ins_store));
+    memcpy(new_store, store, sizeof(struct _ins_store));
+    new_store->refs = 1;
+
+    new_store->addresses       = malloc(sizeof(uint64_t) * store->capacity);
+    new_store->sizes           = malloc(store->capacity);
+    new_store->flags           = malloc(store->capacity);
+    new_store->descriptions    = malloc(sizeof(const char *) * store->capacity);
+    new_store->successor_start = malloc(sizeof(uint32_t) * (store->capacity + 1));
+    memcpy(new_store->addresses, store->addresses, sizeof(uint64_t) * store->size);
+    memcpy(new_store->sizes, store->sizes, store->size);
+    memcpy(new_store->flags, store->flags, store->size);
+    memcpy(new_store->descriptions,
+           store->descriptions,
+           sizeof(const char *) * store->size);
+    memcpy(new_store->successor_start,
+           store->successor_start,
+           sizeof(uint32_t) * (store->size + 1));
+
+    new_store->successor_addresses = malloc(sizeof(uint64_t) * store->edges_capacity);
+    new_store->successor_types     = malloc(store->edges_capacity);
+    memcpy(new_store->successor_addresses,
+           store->successor_addresses,
+           sizeof(uint64_t) * store->edges);
+    memcpy(new_store->successor_types, store->successor_types, store->edges);
+
+    new_store->slots = malloc(sizeof(uint32_t) * slots);
+    memcpy(new_store->slots, store->slots, sizeof(uint32_t) * slots);
+
+    return new_store;
+}
+
+
+
+// fibonacci hashing, as in hashmap.c
+static size_t ins_store_slot (unsigned int bits, uint64_t address)
+{
+    return (size_t) ((address * 0x9e3779b97f4a7c15ULL) >> (64 - bits));
+}
+
+
+// returns the slot holding address, or the empty slot where it would go
+static size_t ins_store_probe (const struct _ins_store * store,
+                               uint64_t address)
+{
+    size_t mask = ((size_t) 1 << store->bits) - 1;
+    size_t slot = ins_store_slot(store->bits, address);
+
+    while (    (store->slots[slot] != 0)
+            && (store->addresses[store->slots[slot] - 1] != address))
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+
+
+static void ins_store_grow_index (struct _ins_store * store)
+{
+    size_t i;
+
+    free(store->slots);
+    store->bits++;
+    store->slots = calloc((size_t) 1 << store->bits, sizeof(uint32_t));
+
+    for (i = 0; i < store->size; i++)
+        store->slots[ins_store_probe(store, store->addresses[i])] = i + 1;
+}
+
+
+
+static void ins_store_reserve (struct _ins_store * store, size_t edges)
+{
+    size_t capacity;
+
+    if (store->size == store->capacity) {
+        capacity = store->capacity * 2;
+        store->addresses    = realloc(store->addresses,
+                                      sizeof(uint64_t) * capacity);
+        store->sizes        = realloc(store->sizes, capacity);
+        store->flags        = realloc(store->flags, capacity);
+        store->descriptions = realloc(store->descriptions,
+                                      sizeof(const char *) * capacity);
+        store->successor_start = realloc(store->successor_start,
+                                         sizeof(uint32_t) * (capacity + 1));
+        store->capacity = capacity;
+    }
+
+    if (store->edges + edges > store->edges_capacity) {
+        capacity = store->edges_capacity * 2;
+        while (capacity < store->edges + edges)
+            capacity *= 2;
+        store->successor_addresses = realloc(store->successor_addresses,
+                                             sizeof(uint64_t) * capacity);
+        store->successor_types     = realloc(store->successor_types, capacity);
+        store->edges_capacity = capacity;
+    }
+}
+
+
+
+// fills in a new instruction's columns and returns its id. address is not
+// in the store yet, and slot is its empty index slot. the caller appends the
+// instruction's edges successors afterwards
+static uint32_t ins_store_append (struct _ins_store * store,
+                                  size_t slot,
+                                  uint64_t address,
+                                  uint8_t size,
+                                  uint8_t flags,
+                                  const char * description,
+                                  size_t edges)
+{
+    uint32_t id;
+
+    ins_store_reserve(store, edges);
+
+    id = store->size;
+    store->addresses[id]    = address;
+    store->sizes[id]        = size;
+    store->flags[id]        = flags;
+    store->descriptions[id] = description;
+
+    store->successor_start[id + 1] = store->edges + edges;
+
+    store->slots[slot] = id + 1;
+    store->size++;
+
+    return id;
+}
+
+
+// keep the index at most half full
+static void ins_store_appended (struct _ins_store * store)
+{
+    if (store->size * 2 > ((size_t) 1 << store->bits))
+        ins_store_grow_index(store);
+}
+
+
+
+uint32_t ins_store_add (struct _ins_store * store, const struct _ins * ins)
+{
+    size_t   slot;
+    size_t   i;
+    uint32_t id;
+
+    slot = ins_store_probe(store, ins->address);
+    if (store->slots[slot] != 0)
+        return store->slots[slot] - 1;
+
+    // the description is already interned
+    id = ins_store_append(store,
+                          slot,
+                          ins->address,
+                          ins->size,
+                          ins_is_call(ins) ? INS_STORE_CALL : 0,
+                          ins->description,
+                          ins->successors->size);
+
+    for (i = 0; i < ins->successors->size; i++) {
+        struct _ins_value * successor = ins->successors->items[i];
+        store->successor_addresses[store->edges] = successor->address;
+        store->successor_types[store->edges]     = successor->type;
+        store->edges++;
+    }
+
+    ins_store_appended(store);
+
+    return id;
+}
+
+
+
+uint32_t ins_store_add_from (struct _ins_store * store,
+                             const struct _ins_store * from,
+                             uint32_t id)
+{
+    uint32_t first = from->successor_start[id];
+    uint32_t last  = from->successor_start[id + 1];
+    size_t   slot;
+    uint32_t new_id;
+
+    slot = ins_store_probe(store, from->addresses[id]);
+    if (store->slots[slot] != 0)
+        return store->slots[slot] - 1;
+
+    new_id = ins_store_append(store,
+                              slot,
+                              from->addresses[id],
+                              from->sizes[id],
+                              from->flags[id],
+                              from->descriptions[id],
+                              last - first);
+
+    memcpy(&(store->successor_addresses[store->edges]),
+           &(from->successor_addresses[first]),
+           sizeof(uint64_t) * (last - first));
+    memcpy(&(store->successor_types[store->edges]),
+           &(from->successor_types[first]),
+           last - first);
+    store->edges += last - first;
+
+    ins_store_appended(store);
+
+    return new_id;
+}
+
+
+
+uint32_t ins_store_find (const struct _ins_store * store, uint64_t address)
+{
+    size_t slot = ins_store_probe(store, address);
+
+    return store->slots[slot] - 1;
+}
+
+
+
+size_t ins_store_successors_n (const struct _ins_store * store, uint32_t id)
+{
+    return store->successor_start[id + 1] - store->successor_start[id];
+}
+
+
+
+struct _fgraph * ins_store_graph (const struct _ins_store * store,
+                                  const uint32_t * ins_ids,
+                                  size_t n)
+{
+    uint64_t       * addresses;
+    void          ** data;
+    struct _graph  * graph;
+    struct _fgraph * fgraph;
+    size_t           i;
+    uint32_t         j;
+
+    addresses = (uint64_t *) malloc(sizeof(uint64_t) * n);
+    data      = (void **) calloc(n, sizeof(void *));
+    for (i = 0; i < n; i++)
+        addresses[i] = store->addresses[ins_ids[i]];
+
+    graph = graph_build_sorted(addresses, data, n);
+
+    // edges are added as recursive_disassemble adds them, so the frozen
+    // graph lists them in the same order
+    for (i = 0; i < n; i++) {
+        uint32_t id = ins_ids[i];
+        for (j = store->successor_start[id];
+             j < store->successor_start[id + 1];
+             j++) {
+            if (store->successor_types[j] == INS_SUC_CALL)
+                continue;
+            graph_add_edge(graph, addresses[i], store->successor_addresses[j], NULL);
+        }
+    }
+
+    fgraph = graph_freeze(graph);
+
+    object_delete(graph);
+    free(addresses);
+    free(data);
+
+    return fgraph;
+}
+
+
+
+struct _ins * ins_store_ins (const struct _ins_store * store,
+                             const struct _map * mem_map,
+                             uint32_t id)
+{
+    uint64_t         address = store->addresses[id];
+    struct _buffer * buf     = map_fetch_max(mem_map, address);
+    uint64_t         base    = map_fetch_max_key(mem_map, address);
+    struct _ins    * ins;
+    uint32_t         i;
+
+    if ((buf == NULL) || (address - base + store->sizes[id] > buf->size))
+        return NULL;
+
+    ins = ins_create_view(address,
+                          buf,
+                          address - base,
+                          store->sizes[id],
+                          store->descriptions[id],
+                          NULL);
+
+    for (i = store->successor_start[id]; i < store->successor_start[id + 1]; i++)
+        ins_add_successor(ins,
+                          store->successor_addresses[i],
+                          store->successor_types[i]);
+
+    return ins;
+}
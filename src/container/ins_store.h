@@ -0,0 +1,86 @@
+#ifndef ins_store_HEADER
+#define ins_store_HEADER
+
+// a program-wide store of decoded instructions, kept column by column
+//
+// every instruction added gets a dense id, its position in the columns, and
+// is stored once however many functions reach it. an instruction costs its
+// address, size, flags, successor range and description handle, a few tens
+// of bytes, where a _ins with its successor vector and _ins_value objects
+// costs several hundred. the bytes are not kept, they are still in the
+// memory map, and neither are comments
+//
+// instructions are only ever added, so ids stay valid for the life of the
+// store
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+#include "fgraph.h"
+#include "instruction.h"
+#include "map.h"
+#include "object.h"
+
+// returned by ins_store_find when there is no such instruction
+#define INS_STORE_NONE ((uint32_t) -1)
+
+// flags
+#define INS_STORE_CALL (1 << 0)
+
+struct _ins_store {
+    const struct _object * object;
+    unsigned int           refs;
+    size_t                 size;
+    size_t                 capacity;
+    size_t                 edges;
+    size_t                 edges_capacity;
+    // one entry per instruction
+    uint64_t             * addresses;
+    uint8_t              * sizes;
+    uint8_t              * flags;
+    // interned, see intern.h
+    const char          ** descriptions;
+    // size + 1 entries. instruction id's successors run from
+    // successor_start[id] up to successor_start[id + 1]
+    uint32_t             * successor_start;
+    // the shared successor columns, one entry per edge
+    uint64_t             * successor_addresses;
+    uint8_t              * successor_types;
+    // address to id index, 1 << bits slots holding id + 1, or 0 when empty
+    unsigned int           bits;
+    uint32_t             * slots;
+};
+
+
+struct _ins_store * ins_store_create ();
+void                ins_store_delete (struct _ins_store * store);
+struct _ins_store * ins_store_copy   (const struct _ins_store * store);
+
+// returns the id of ins in store, adding it if no instruction at its address
+// is there yet
+uint32_t ins_store_add  (struct _ins_store * store, const struct _ins * ins);
+// as ins_store_add, for instruction id of another store, from
+uint32_t ins_store_add_from (struct _ins_store * store,
+                             const struct _ins_store * from,
+                             uint32_t id);
+// returns the id of the instruction at address, or INS_STORE_NONE
+uint32_t ins_store_find (const struct _ins_store * store, uint64_t address);
+
+size_t   ins_store_successors_n (const struct _ins_store * store, uint32_t id);
+
+// builds the control flow graph of the n instructions ins_ids, which are
+// listed by address, from their successors in store. node i is instruction
+// ins_ids[i], indexed by its address. nodes and edges carry no data, an
+// edge's type is in successor_types. call edges are left out, as are edges
+// to instructions not in ins_ids
+struct _fgraph * ins_store_graph (const struct _ins_store * store,
+                                  const uint32_t * ins_ids,
+                                  size_t n);
+
+// rebuilds instruction id as a _ins viewing its bytes in mem_map. returns
+// NULL if mem_map no longer holds them
+struct _ins * ins_store_ins (const struct _ins_store * store,
+                             const struct _map * mem_map,
+                             uint32_t id);
+
+#endif
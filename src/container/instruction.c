@@ -1,5 +1,8 @@
 #include "instruction.h"
 
+#include "arena.h"
+#include "intern.h"
+
 #include <string.h>
 
 static const struct _object ins_object = {
@@ -16,35 +19,79 @@ static const struct _object ins_value_object = {
     NULL
 };
 
+// an instruction with no bytes, text or successors yet
+static struct _ins * ins_alloc (uint64_t address)
+{
+    struct _ins * ins;
+
+    ins = (struct _ins *) mem_alloc(sizeof(struct _ins));
+
+    ins->object      = &ins_object;
+    ins->refs        = 1;
+    ins->address     = address;
+    ins->bytes       = NULL;
+    ins->size        = 0;
+    ins->segment     = NULL;
+    ins->description = NULL;
+    ins->comment     = NULL;
+    ins->successors  = vector_create();
+
+    return ins;
+}
+
+
+static void ins_s_bytes (struct _ins * ins, const uint8_t * bytes, size_t size)
+{
+    uint8_t * copy = mem_alloc(size);
+
+    memcpy(copy, bytes, size);
+
+    ins->bytes = copy;
+    ins->size  = size;
+}
+
+
+static void ins_s_view (struct _ins * ins,
+                        const struct _buffer * segment,
+                        size_t offset,
+                        size_t size)
+{
+    ins->segment = mem_retain(ins, segment);
+    ins->bytes   = &(segment->bytes[offset]);
+    ins->size    = size;
+}
+
+
 struct _ins * ins_create  (uint64_t address,
                            const uint8_t * bytes,
                            size_t size,
                            const char * description,
                            const char * comment)
 {
-    struct _ins * ins;
-
-    ins = (struct _ins *) malloc(sizeof(struct _ins));
-
-    ins->object  = &ins_object;
-    ins->address = address;
+    struct _ins * ins = ins_alloc(address);
 
-    ins->bytes = malloc(size);
-    memcpy(ins->bytes, bytes, size);
+    ins_s_bytes(ins, bytes, size);
+    ins->description = intern(description);
+    if (comment != NULL)
+        ins->comment = intern(comment);
 
-    ins->size = size;
+    return ins;
+}
 
-    if (description == NULL)
-        ins->description = NULL;
-    else
-        ins->description = strdup(description);
 
-    if (comment == NULL)
-        ins->comment = NULL;
-    else
-        ins->comment = strdup(comment);
+struct _ins * ins_create_view (uint64_t address,
+                               const struct _buffer * segment,
+                               size_t offset,
+                               size_t size,
+                               const char * description,
+                               const char * comment)
+{
+    struct _ins * ins = ins_alloc(address);
 
-    ins->successors = list_create();
+    ins_s_view(ins, segment, offset, size);
+    ins->description = intern(description);
+    if (comment != NULL)
+        ins->comment = intern(comment);
 
     return ins;
 }
@@ -52,23 +99,30 @@ struct _ins * ins_create  (uint64_t address,
 
 void ins_delete (struct _ins * ins)
 {
-    free(ins->bytes);
-    if (ins->description != NULL)
-        free(ins->description);
-    if (ins->comment != NULL)
-        free(ins->comment);
+    if (ins->segment != NULL)
+        mem_release(ins, ins->segment);
+    else
+        mem_free((uint8_t *) ins->bytes);
     object_delete(ins->successors);
-    free(ins);
+    mem_free(ins);
 }
 
 
 struct _ins * ins_copy (const struct _ins * ins)
 {
-    struct _ins * new_ins = ins_create(ins->address,
-                                       ins->bytes,
-                                       ins->size,
-                                       ins->description,
-                                       ins->comment);
+    struct _ins * new_ins = ins_alloc(ins->address);
+
+    if (ins->segment != NULL)
+        ins_s_view(new_ins,
+                   ins->segment,
+                   ins->bytes - ins->segment->bytes,
+                   ins->size);
+    else
+        ins_s_bytes(new_ins, ins->bytes, ins->size);
+
+    // interned strings are shared, not copied
+    new_ins->description = ins->description;
+    new_ins->comment     = ins->comment;
     object_delete(new_ins->successors);
     new_ins->successors = object_copy(ins->successors);
 
@@ -88,41 +142,30 @@ int ins_cmp (const struct _ins * lhs, const struct _ins * rhs)
 
 void ins_s_description (struct _ins * ins, const char * description)
 {
-    if (ins->description != NULL)
-        free(ins->description);
-
-    if (description == NULL)
-        ins->description = NULL;
-    else
-        ins->description = strdup(description);
+    ins->description = intern(description);
 }
 
 
 void ins_s_comment (struct _ins * ins, const char * comment)
 {
-    if (ins->comment != NULL)
-        free(ins->comment);
-
     if ((comment == NULL) || (strlen(comment) == 0))
         ins->comment = NULL;
     else
-        ins->comment = strdup(comment);
+        ins->comment = intern(comment);
 }
 
 
 void ins_add_successor (struct _ins * ins, uint64_t address, int type)
 {
-    struct _ins_value * successor = ins_value_create(address, type);
-    list_append(ins->successors, successor);
-    object_delete(successor);
+    vector_append_take(ins->successors, ins_value_create(address, type));
 }
 
 
 int ins_is_call (const struct _ins * ins)
 {
-    struct _list_it * lit;
-    for (lit = list_iterator(ins->successors); lit != NULL; lit = lit->next) {
-        struct _ins_value * successor = lit->data;
+    size_t i;
+    for (i = 0; i < ins->successors->size; i++) {
+        struct _ins_value * successor = ins->successors->items[i];
         if (successor->type == INS_SUC_CALL)
             return 1;
     }
@@ -132,9 +175,10 @@ int ins_is_call (const struct _ins * ins)
 
 struct _ins_value * ins_value_create (uint64_t address, int type)
 {
-    struct _ins_value * value = malloc(sizeof(struct _ins_value));
+    struct _ins_value * value = mem_alloc(sizeof(struct _ins_value));
 
     value->object  = &ins_value_object;
+    value->refs    = 1;
     value->address = address;
     value->type    = type;
 
@@ -144,7 +188,7 @@ struct _ins_value * ins_value_create (uint64_t address, int type)
 
 void ins_value_delete (struct _ins_value * value)
 {
-    free(value);
+    mem_free(value);
 }
 
 
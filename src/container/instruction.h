@@ -4,8 +4,9 @@
 #include <inttypes.h>
 #include <stdlib.h>
 
-#include "list.h"
+#include "buffer.h"
 #include "object.h"
+#include "vector.h"
 
 /*
 *  Changes to instructions should maybe pay attention to rdis_regraph_function
@@ -22,17 +23,24 @@ enum {
 
 struct _ins {
     const struct _object * object;
-    uint64_t       address;
-    struct _list * successors; // of type _ins_value
-    uint8_t *      bytes;
-    size_t         size;
-    char *         description;
-    char *         comment;
+    unsigned int           refs;
+    uint64_t         address;
+    struct _vector * successors; // of type _ins_value
+    // a decoded instruction views its bytes in the segment it was decoded
+    // from, holding a reference to the segment (mem_retain, arena.h).
+    // otherwise segment is NULL and bytes is an allocation of its own
+    const uint8_t *  bytes;
+    size_t           size;
+    struct _buffer * segment;
+    // interned, see intern.h
+    const char *     description;
+    const char *     comment;
 };
 
 
 struct _ins_value {
     const struct _object * object;
+    unsigned int           refs;
     uint64_t address;
     int      type;
 };
@@ -44,6 +52,15 @@ struct _ins * ins_create    (uint64_t address,
                              const char * description,
                              const char * comment);
 
+// like ins_create, but the instruction's bytes are the size bytes at offset
+// in segment, which are not copied
+struct _ins * ins_create_view (uint64_t address,
+                               const struct _buffer * segment,
+                               size_t offset,
+                               size_t size,
+                               const char * description,
+                               const char * comment);
+
 void          ins_delete      (struct _ins * ins);
 struct _ins * ins_copy        (const struct _ins * ins);
 int           ins_cmp         (const struct _ins * lhs, const struct _ins * rhs);
@@ -1,5 +1,7 @@
 #include "list.h"
 
+#include "arena.h"
+
 #include <stdlib.h>
 #include <string.h>
 
@@ -12,8 +14,9 @@ static const struct _object list_object = {
 
 struct _list * list_create ()
 {
-    struct _list * list = (struct _list *) malloc(sizeof(struct _list));
+    struct _list * list = (struct _list *) mem_alloc(sizeof(struct _list));
     list->object = &list_object;
+    list->refs = 1;
     list->first = NULL; 
     list->last  = NULL;
     list->size = 0;
@@ -34,21 +37,27 @@ void list_delete (struct _list * list)
 
         object_delete(current->data);
 
-        free(current);
+        mem_free(current);
         
         current = next;
     }
 
-    free(list);
+    mem_free(list);
 }
 
 
 void list_append (struct _list * list, void * data)
+{
+    list_append_take(list, object_retain(data));
+}
+
+
+void list_append_take (struct _list * list, void * data)
 {
     struct _list_it * list_it;
 
-    list_it = (struct _list_it *) malloc(sizeof(struct _list_it));
-    list_it->data = object_copy(data);
+    list_it = (struct _list_it *) mem_alloc(sizeof(struct _list_it));
+    list_it->data = data;
     list_it->next = NULL;
     list_it->prev = list->last;
 
@@ -119,7 +128,7 @@ struct _list_it * list_remove (struct _list * list, struct _list_it * iterator)
         list->last = iterator->prev;
     
     object_delete(iterator->data);
-    free(iterator);
+    mem_free(iterator);
 
     list->size--;
 
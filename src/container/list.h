@@ -13,6 +13,7 @@ struct _list_it {
 
 struct _list {
     const struct _object * object;
+    unsigned int           refs;
     struct _list_it * first;
     struct _list_it * last;
     size_t size;
@@ -22,6 +23,8 @@ struct _list * list_create      ();
 void           list_delete      (struct _list * list);
 
 void              list_append      (struct _list * list, void * data);
+// like list_append, but takes over the caller's reference to data
+void              list_append_take (struct _list * list, void * data);
 void              list_append_list (struct _list * list, const struct _list * rhs);
 struct _list_it * list_iterator    (const struct _list * list);
 struct _list    * list_copy        (const struct _list * list);
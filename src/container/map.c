@@ -1,5 +1,7 @@
 #include "map.h"
 
+#include "arena.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -18,34 +20,88 @@ static const struct _object map_node_object = {
 };
 
 
+// tree_key_cmp for looking up map nodes by their uint64_t key
+static int map_node_key_cmp (const void * key, const void * data)
+{
+    uint64_t                 lhs = *((const uint64_t *) key);
+    const struct _map_node * rhs = data;
+
+    if (lhs < rhs->key)
+        return -1;
+    else if (lhs > rhs->key)
+        return 1;
+    return 0;
+}
+
+
+
+// takes over the caller's reference to map_node
+static int map_insert_node (struct _map * map, struct _map_node * map_node)
+{
+    if (map->ptree != NULL) {
+        if (ptree_fetch_key(map->ptree, &(map_node->key), map_node_key_cmp) != NULL) {
+            object_delete(map_node);
+            return -1;
+        }
+        ptree_insert_take(map->ptree, map_node);
+        map->size++;
+        return 0;
+    }
+
+    if (tree_fetch_key(map->tree, &(map_node->key), map_node_key_cmp) != NULL) {
+        object_delete(map_node);
+        return -1;
+    }
+
+    tree_insert_take(map->tree, map_node);
+    map->size++;
+
+    return 0;
+}
+
+
+
 int map_insert (struct _map * map, uint64_t key, const void * value)
 {
-    int result = 0;
+    if (map->btree != NULL) {
+        if (value == NULL)
+            return map_insert_take(map, key, NULL);
+        return map_insert_take(map, key, object_retain(value));
+    }
+
+    return map_insert_node(map, map_node_create(key, value));
+}
+
 
-    struct _map_node * map_node = map_node_create(key, value);
 
-    if (tree_fetch(map->tree, map_node) == NULL) {
-        tree_insert(map->tree, map_node);
+int map_insert_take (struct _map * map, uint64_t key, void * value)
+{
+    if (map->btree != NULL) {
+        if (btree_insert_take(map->btree, key, value))
+            return -1;
         map->size++;
+        return 0;
     }
-    else
-        result = -1;
 
-    object_delete(map_node);
+    struct _map_node * map_node = map_node_create(key, NULL);
+    map_node->value = value;
 
-    return result;
+    return map_insert_node(map, map_node);
 }
 
 
 
 void * map_fetch (const struct _map * map, uint64_t key)
 {
-    struct _map_node * needle = map_node_create(key, NULL);
     struct _map_node * map_node;
 
-    map_node = tree_fetch(map->tree, needle);
+    if (map->btree != NULL)
+        return btree_fetch(map->btree, key);
 
-    object_delete(needle);
+    if (map->ptree != NULL)
+        map_node = ptree_fetch_key(map->ptree, &key, map_node_key_cmp);
+    else
+        map_node = tree_fetch_key(map->tree, &key, map_node_key_cmp);
 
     if (map_node == NULL)
         return NULL;
@@ -57,12 +113,19 @@ void * map_fetch (const struct _map * map, uint64_t key)
 
 void * map_fetch_max (const struct _map * map, uint64_t key)
 {
-    struct _map_node * needle = map_node_create(key, NULL);
     struct _map_node * map_node;
 
-    map_node = tree_fetch_max(map->tree, needle);
+    if (map->btree != NULL) {
+        void * value;
+        if (btree_fetch_max(map->btree, key, &key, &value))
+            return NULL;
+        return value;
+    }
 
-    object_delete(needle);
+    if (map->ptree != NULL)
+        map_node = ptree_fetch_max_key(map->ptree, &key, map_node_key_cmp);
+    else
+        map_node = tree_fetch_max_key(map->tree, &key, map_node_key_cmp);
 
     if (map_node == NULL)
         return NULL;
@@ -74,12 +137,19 @@ void * map_fetch_max (const struct _map * map, uint64_t key)
 
 uint64_t map_fetch_max_key (const struct _map * map, uint64_t key)
 {
-    struct _map_node * needle = map_node_create(key, NULL);
     struct _map_node * map_node;
 
-    map_node = tree_fetch_max(map->tree, needle);
+    if (map->btree != NULL) {
+        void * value;
+        if (btree_fetch_max(map->btree, key, &key, &value))
+            return -1;
+        return key;
+    }
 
-    object_delete(needle);
+    if (map->ptree != NULL)
+        map_node = ptree_fetch_max_key(map->ptree, &key, map_node_key_cmp);
+    else
+        map_node = tree_fetch_max_key(map->tree, &key, map_node_key_cmp);
 
     if (map_node == NULL)
         return -1;
@@ -89,21 +159,75 @@ uint64_t map_fetch_max_key (const struct _map * map, uint64_t key)
 
 
 
+void * map_fetch_writable (struct _map * map, uint64_t key)
+{
+    struct _tree_node * node;
+    struct _map_node  * map_node;
+    void             ** data;
+
+    if (map->btree != NULL) {
+        void ** slot = btree_fetch_slot(map->btree, key);
+        if ((slot == NULL) || (*slot == NULL))
+            return NULL;
+        *slot = object_cow(*slot);
+        return *slot;
+    }
+
+    if (map->ptree != NULL) {
+        // copies the tree nodes on the way down which other copies share
+        data = ptree_fetch_slot_key(map->ptree, &key, map_node_key_cmp);
+        if (data == NULL)
+            return NULL;
+    }
+    else {
+        node = tree_node_fetch_key(map->tree->nodes, &key, map_node_key_cmp);
+        if (node == NULL)
+            return NULL;
+        data = &(node->data);
+    }
+
+    // map nodes are shared between copies of a map, and values between
+    // everyone who inserted them
+    *data    = object_cow(*data);
+    map_node = *data;
+
+    if (map_node->value != NULL)
+        map_node->value = object_cow(map_node->value);
+
+    return map_node->value;
+}
+
+
+
 int map_remove (struct _map * map, uint64_t key)
 {
-    int result = 0;
+    struct _map_node * map_node;
 
-    struct _map_node * needle = map_node_create(key, NULL);
+    if (map->btree != NULL) {
+        if (btree_remove(map->btree, key))
+            return -1;
+        map->size--;
+        return 0;
+    }
 
-    if (tree_fetch(map->tree, needle) == NULL)
-        result = -1;
-    else {
-        tree_remove(map->tree, needle);
+    if (map->ptree != NULL) {
+        map_node = ptree_fetch_key(map->ptree, &key, map_node_key_cmp);
+        if (map_node == NULL)
+            return -1;
+        ptree_remove(map->ptree, map_node);
         map->size--;
+        return 0;
     }
 
-    object_delete(needle);
-    return result;
+    map_node = tree_fetch_key(map->tree, &key, map_node_key_cmp);
+    if (map_node == NULL)
+        return -1;
+
+    // the stored node serves as its own needle
+    tree_remove(map->tree, map_node);
+    map->size--;
+
+    return 0;
 }
 
 
@@ -112,27 +236,128 @@ struct _map * map_create ()
 {
     struct _map * map;
 
-    map = (struct _map *) malloc(sizeof(struct _map));
+    map = (struct _map *) mem_alloc(sizeof(struct _map));
     map->object = &map_object;
+    map->refs = 1;
     map->tree = tree_create();
+    map->btree = NULL;
+    map->ptree = NULL;
+    map->size = 0;
+
+    return map;
+}
+
+
+struct _map * map_create_btree ()
+{
+    struct _map * map;
+
+    map = (struct _map *) mem_alloc(sizeof(struct _map));
+    map->object = &map_object;
+    map->refs = 1;
+    map->tree = NULL;
+    map->btree = btree_create();
+    map->ptree = NULL;
+    map->size = 0;
+
+    return map;
+}
+
+
+struct _map * map_create_persistent ()
+{
+    struct _map * map;
+
+    map = (struct _map *) mem_alloc(sizeof(struct _map));
+    map->object = &map_object;
+    map->refs = 1;
+    map->tree = NULL;
+    map->btree = NULL;
+    map->ptree = ptree_create();
     map->size = 0;
 
     return map;
 }
 
 
+struct _map * map_build_sorted (const uint64_t * keys,
+                                void ** values,
+                                size_t n)
+{
+    struct _map       * map;
+    struct _map_node ** nodes;
+    size_t              i;
+
+    nodes = (struct _map_node **) mem_alloc(sizeof(void *) * n);
+    for (i = 0; i < n; i++) {
+        nodes[i] = map_node_create(keys[i], NULL);
+        nodes[i]->value = values[i];
+    }
+
+    map = (struct _map *) mem_alloc(sizeof(struct _map));
+    map->object = &map_object;
+    map->refs = 1;
+    map->tree = tree_build_sorted((void **) nodes, n);
+    map->btree = NULL;
+    map->ptree = NULL;
+    map->size = n;
+
+    mem_free(nodes);
+
+    return map;
+}
+
+
+struct _map * map_build_sorted_btree (const uint64_t * keys,
+                                      void ** values,
+                                      size_t n)
+{
+    struct _map * map;
+
+    map = (struct _map *) mem_alloc(sizeof(struct _map));
+    map->object = &map_object;
+    map->refs = 1;
+    map->tree = NULL;
+    map->btree = btree_build_sorted(keys, values, n);
+    map->ptree = NULL;
+    map->size = n;
+
+    return map;
+}
+
+
 void map_delete (struct _map * map)
 {
-    object_delete(map->tree);
-    free(map);
+    if (map->btree != NULL)
+        object_delete(map->btree);
+    else if (map->ptree != NULL)
+        object_delete(map->ptree);
+    else
+        object_delete(map->tree);
+    mem_free(map);
 }
 
 
 struct _map * map_copy (const struct _map * map)
 {
-    struct _map * new_map = map_create();
-    object_delete(new_map->tree);
-    new_map->tree = object_copy(map->tree);
+    struct _map * new_map;
+
+    if (map->btree != NULL) {
+        new_map = map_create_btree();
+        object_delete(new_map->btree);
+        new_map->btree = object_copy(map->btree);
+    }
+    else if (map->ptree != NULL) {
+        // O(1), the two maps share the tree until one of them changes
+        new_map = map_create_persistent();
+        object_delete(new_map->ptree);
+        new_map->ptree = object_copy(map->ptree);
+    }
+    else {
+        new_map = map_create();
+        object_delete(new_map->tree);
+        new_map->tree = object_copy(map->tree);
+    }
     new_map->size = map->size;
 
     return new_map;
@@ -143,13 +368,14 @@ struct _map_node * map_node_create (uint64_t key, const void * value)
 {
     struct _map_node * map_node;
 
-    map_node = (struct _map_node *) malloc(sizeof(struct _map_node));
+    map_node = (struct _map_node *) mem_alloc(sizeof(struct _map_node));
     map_node->object = &map_node_object;
+    map_node->refs   = 1;
     map_node->key    = key;
     if (value == NULL)
         map_node->value = NULL;
     else
-        map_node->value = object_copy(value);
+        map_node->value = object_retain(value);
 
     return map_node;
 }
@@ -159,7 +385,7 @@ void map_node_delete (struct _map_node * map_node)
 {
     if (map_node->value != NULL)
         object_delete(map_node->value);
-    free(map_node);
+    mem_free(map_node);
 }
 
 
@@ -183,12 +409,37 @@ struct _map_it * map_iterator (const struct _map * map)
 {
     struct _map_it * map_it;
 
-    map_it = (struct _map_it *) malloc(sizeof(struct _map_it));
+    map_it = (struct _map_it *) mem_alloc(sizeof(struct _map_it));
+
+    map_it->pit = NULL;
+
+    if (map->btree != NULL) {
+        map_it->it  = NULL;
+        map_it->bit = btree_iterator(map->btree);
+        if (map_it->bit == NULL) {
+            mem_free(map_it);
+            return NULL;
+        }
+        return map_it;
+    }
+
+    map_it->bit = NULL;
+
+    if (map->ptree != NULL) {
+        map_it->it  = NULL;
+        map_it->pit = mem_alloc(sizeof(struct _ptree_iter));
+        if (ptree_iter_first(map_it->pit, map->ptree) == NULL) {
+            mem_free(map_it->pit);
+            mem_free(map_it);
+            return NULL;
+        }
+        return map_it;
+    }
 
-    map_it->it = tree_iterator(map->tree);
+    map_it->it  = tree_iterator(map->tree);
 
     if (map_it->it == NULL) {
-        free(map_it);
+        mem_free(map_it);
         return NULL;
     }
 
@@ -198,10 +449,28 @@ struct _map_it * map_iterator (const struct _map * map)
 
 struct _map_it * map_it_next (struct _map_it * map_it)
 {
+    if (map_it->bit != NULL) {
+        map_it->bit = btree_it_next(map_it->bit);
+        if (map_it->bit == NULL) {
+            mem_free(map_it);
+            return NULL;
+        }
+        return map_it;
+    }
+
+    if (map_it->pit != NULL) {
+        if (ptree_iter_next(map_it->pit) == NULL) {
+            mem_free(map_it->pit);
+            mem_free(map_it);
+            return NULL;
+        }
+        return map_it;
+    }
+
     map_it->it = tree_it_next(map_it->it);
 
     if (map_it->it == NULL) {
-        free(map_it);
+        mem_free(map_it);
         return NULL;
     }
 
@@ -209,9 +478,21 @@ struct _map_it * map_it_next (struct _map_it * map_it)
 }
 
 
+// the map node under a tree or persistent tree iterator
+static struct _map_node * map_it_node (const struct _map_it * map_it)
+{
+    if (map_it->pit != NULL)
+        return map_it->pit->stack[map_it->pit->depth - 1]->data;
+    return tree_it_data(map_it->it);
+}
+
+
 void * map_it_data (const struct _map_it * map_it)
 {
-    struct _map_node * map_node = tree_it_data(map_it->it);
+    if (map_it->bit != NULL)
+        return btree_it_data(map_it->bit);
+
+    struct _map_node * map_node = map_it_node(map_it);
 
     if (map_node == NULL)
         return NULL;
@@ -222,7 +503,10 @@ void * map_it_data (const struct _map_it * map_it)
 
 uint64_t map_it_key (const struct _map_it * map_it)
 {
-    struct _map_node * map_node = tree_it_data(map_it->it);
+    if (map_it->bit != NULL)
+        return btree_it_key(map_it->bit);
+
+    struct _map_node * map_node = map_it_node(map_it);
 
     if (map_node == NULL)
         return -1;
@@ -233,6 +517,69 @@ uint64_t map_it_key (const struct _map_it * map_it)
 
 void map_it_delete (struct _map_it * map_it)
 {
-    tree_it_delete(map_it->it);
-    free(map_it);
+    if (map_it->bit != NULL)
+        btree_it_delete(map_it->bit);
+    else if (map_it->pit != NULL)
+        mem_free(map_it->pit);
+    else
+        tree_it_delete(map_it->it);
+    mem_free(map_it);
+}
+
+
+
+static int map_iter_load (struct _map_iter * iter, struct _map_node * map_node)
+{
+    if (map_node == NULL)
+        return 0;
+
+    iter->key   = map_node->key;
+    iter->value = map_node->value;
+    return 1;
+}
+
+
+static int map_iter_load_leaf (struct _map_iter * iter)
+{
+    if (iter->leaf == NULL)
+        return 0;
+
+    iter->key   = iter->leaf->node.keys[iter->slot];
+    iter->value = iter->leaf->values[iter->slot];
+    return 1;
+}
+
+
+int map_iter_first (struct _map_iter * iter, const struct _map * map)
+{
+    iter->btree = (map->btree != NULL);
+    iter->ptree = (map->ptree != NULL);
+
+    if (iter->ptree)
+        return map_iter_load(iter,
+                             ptree_iter_first(&(iter->nodes.ptree), map->ptree));
+    if (! iter->btree)
+        return map_iter_load(iter, tree_iter_first(&(iter->nodes.tree), map->tree));
+
+    iter->leaf = btree_first_leaf(map->btree);
+    iter->slot = 0;
+
+    return map_iter_load_leaf(iter);
+}
+
+
+int map_iter_next (struct _map_iter * iter)
+{
+    if (iter->ptree)
+        return map_iter_load(iter, ptree_iter_next(&(iter->nodes.ptree)));
+    if (! iter->btree)
+        return map_iter_load(iter, tree_iter_next(&(iter->nodes.tree)));
+
+    iter->slot++;
+    if (iter->slot == iter->leaf->node.size) {
+        iter->leaf = iter->leaf->next;
+        iter->slot = 0;
+    }
+
+    return map_iter_load_leaf(iter);
 }
\ No newline at end of file
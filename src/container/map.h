@@ -2,14 +2,24 @@
 #define map_HEADER
 
 // a 1-to-1 mapping of uint64_t to values
+//
+// a map is backed by the AA-tree in tree.c, the B+tree in btree.c or the
+// persistent AA-tree in ptree.c, chosen when the map is created. large maps
+// which are mostly inserted into and looked up, like memory maps, should use
+// the B+tree. maps which are copied often and then changed a little, like
+// snapshots of analysis state, should use the persistent tree, whose copies
+// are O(1) and share everything the copies do not change
 
 #include <inttypes.h>
 
 #include "object.h"
+#include "btree.h"
+#include "ptree.h"
 #include "tree.h"
 
 struct _map_node {
     const struct _object * object;
+    unsigned int           refs;
     uint64_t key;
     void   * value;
 };
@@ -17,27 +27,66 @@ struct _map_node {
 
 struct _map {
     const struct _object * object;
+    unsigned int           refs;
     size_t size;
-    struct _tree * tree;
+    // exactly one of these is not NULL
+    struct _tree  * tree;
+    struct _btree * btree;
+    struct _ptree * ptree;
 };
 
 
 struct _map_it {
-    struct _tree_it * it;
+    struct _tree_it    * it;
+    struct _btree_it   * bit;
+    struct _ptree_iter * pit;
+};
+
+
+// a stack iterator. while first/next return 1, key and value hold the
+// current entry. they return 0 when there are no entries left
+struct _map_iter {
+    uint64_t             key;
+    void               * value;
+    int                  btree;
+    int                  ptree;
+    union {
+        struct _tree_iter  tree;
+        struct _ptree_iter ptree;
+    } nodes;
+    struct _btree_leaf * leaf;
+    unsigned int         slot;
 };
 
 
 // returns 0 on success, -1 on error (key already exists)
 int      map_insert        (struct _map *, uint64_t key, const void * value);
+// like map_insert, but takes over the caller's reference to value. if key
+// already exists value is released
+int      map_insert_take   (struct _map *, uint64_t key, void * value);
 void *   map_fetch         (const struct _map *, uint64_t key);
 void *   map_fetch_max     (const struct _map *, uint64_t key);
 uint64_t map_fetch_max_key (const struct _map *, uint64_t key);
 int      map_remove        (struct _map *, uint64_t key);
 
-
-struct _map * map_create      ();
-void          map_delete      (struct _map *);
-struct _map * map_copy        (const struct _map *);
+// like map_fetch, but the value is first made private to this map (see
+// object_cow) so the caller may modify it in place
+void *   map_fetch_writable (struct _map *, uint64_t key);
+
+
+struct _map * map_create       ();
+struct _map * map_create_btree ();
+struct _map * map_create_persistent ();
+// build a map in O(n) from n strictly ascending keys. take over the caller's
+// references to values, which may be NULL, but not the arrays holding them
+struct _map * map_build_sorted       (const uint64_t * keys,
+                                      void ** values,
+                                      size_t n);
+struct _map * map_build_sorted_btree (const uint64_t * keys,
+                                      void ** values,
+                                      size_t n);
+void          map_delete       (struct _map *);
+struct _map * map_copy         (const struct _map *);
 
 struct _map_node * map_node_create      (uint64_t key, const void * value);
 void               map_node_delete      (struct _map_node *);
@@ -50,5 +99,8 @@ void *           map_it_data   (const struct _map_it * map_it);
 uint64_t         map_it_key    (const struct _map_it * map_it);
 void             map_it_delete (struct _map_it * map_it);
 
+int map_iter_first (struct _map_iter * iter, const struct _map * map);
+int map_iter_next  (struct _map_iter * iter);
+
 
 #endif
\ No newline at end of file
@@ -0,0 +1,467 @@
+#include "ptree.h"
+
+#include "arena.h"
+
+static const struct _object ptree_object = {
+    (void     (*) (void *))       ptree_delete,
+    (void *   (*) (const void *)) ptree_copy,
+    NULL,
+    NULL
+};
+
+
+
+/*
+* NODES
+*
+* a node is shared when more than one parent, or tree, points at it. before
+* a shared node is changed, the pointer leading to it is moved to a private
+* copy, which shares the node's children in turn
+*/
+// takes over the caller's reference to data
+static struct _ptree_node * ptree_node_create (void * data)
+{
+    struct _ptree_node * node;
+
+    node = (struct _ptree_node *) mem_alloc(sizeof(struct _ptree_node));
+    node->refs  = 1;
+    node->level = 0;
+    node->data  = data;
+    node->left  = NULL;
+    node->right = NULL;
+
+    return node;
+}
+
+
+// drops a reference to node, freeing it and releasing its children when
+// none remain. a freed node leaves at most one pending subtree per level
+static void ptree_node_release (struct _ptree_node * node)
+{
+    struct _ptree_node * stack[TREE_ITER_DEPTH * 2];
+    struct _ptree_node * left;
+    unsigned int depth = 0;
+
+    while (1) {
+        if ((node != NULL) && (--node->refs == 0)) {
+            if (node->right != NULL)
+                stack[depth++] = node->right;
+            left = node->left;
+            object_delete(node->data);
+            mem_free(node);
+            node = left;
+            continue;
+        }
+        if (depth == 0)
+            break;
+        node = stack[--depth];
+    }
+}
+
+
+// makes *slot a node the caller may modify, copying it if it is shared
+static struct _ptree_node * ptree_node_own (struct _ptree_node ** slot)
+{
+    struct _ptree_node * node = *slot;
+    struct _ptree_node * copy;
+
+    if ((node == NULL) || (node->refs == 1))
+        return node;
+
+    copy = ptree_node_create(object_retain(node->data));
+    copy->level = node->level;
+    copy->left  = node->left;
+    copy->right = node->right;
+    if (copy->left != NULL)
+        copy->left->refs++;
+    if (copy->right != NULL)
+        copy->right->refs++;
+
+    // still held by whoever else shares it
+    node->refs--;
+    *slot = copy;
+
+    return copy;
+}
+
+
+
+/*
+* skew and split rotate the subtree at *slot, writing the new top to *slot.
+* the caller must own the node holding slot. the nodes rotated are made
+* private first
+*/
+static void ptree_node_skew (struct _ptree_node ** slot)
+{
+    struct _ptree_node * node = *slot;
+    struct _ptree_node * L;
+
+    if ((node == NULL) || (node->left == NULL))
+        return;
+    if (node->level != node->left->level)
+        return;
+
+    node = ptree_node_own(slot);
+    L    = ptree_node_own(&(node->left));
+
+    node->left = L->right;
+    L->right   = node;
+    *slot      = L;
+}
+
+
+static void ptree_node_split (struct _ptree_node ** slot)
+{
+    struct _ptree_node * node = *slot;
+    struct _ptree_node * R;
+
+    if ((node == NULL) || (node->right == NULL) || (node->right->right == NULL))
+        return;
+    if (node->level != node->right->right->level)
+        return;
+
+    node = ptree_node_own(slot);
+    R    = ptree_node_own(&(node->right));
+
+    node->right = R->left;
+    R->left     = node;
+    R->level++;
+    *slot       = R;
+}
+
+
+// node must be private
+static void ptree_node_decrease_level (struct _ptree_node * node)
+{
+    unsigned int should_be;
+
+    if ((node->left == NULL) || (node->right == NULL))
+        return;
+
+    should_be =   node->left->level < node->right->level
+                ? node->left->level : node->right->level;
+    should_be++;
+
+    if (should_be < node->level) {
+        node->level = should_be;
+        if (should_be < node->right->level)
+            ptree_node_own(&(node->right))->level = should_be;
+    }
+}
+
+
+static void ptree_node_reattach (struct _ptree_node * parent,
+                                 struct _ptree_node * old,
+                                 struct _ptree_node * node)
+{
+    if (parent->left == old)
+        parent->left = node;
+    else
+        parent->right = node;
+}
+
+
+
+/*
+* PTREE
+*/
+struct _ptree * ptree_create ()
+{
+    struct _ptree * ptree;
+
+    ptree = (struct _ptree *) mem_alloc(sizeof(struct _ptree));
+    ptree->object = &ptree_object;
+    ptree->refs   = 1;
+    ptree->nodes  = NULL;
+
+    return ptree;
+}
+
+
+
+void ptree_delete (struct _ptree * ptree)
+{
+    ptree_node_release(ptree->nodes);
+    mem_free(ptree);
+}
+
+
+
+struct _ptree * ptree_copy (const struct _ptree * ptree)
+{
+    struct _ptree * new_ptree = ptree_create();
+
+    new_ptree->nodes = ptree->nodes;
+    if (new_ptree->nodes != NULL)
+        new_ptree->nodes->refs++;
+
+    return new_ptree;
+}
+
+
+
+void ptree_insert (struct _ptree * ptree, const void * data)
+{
+    ptree_insert_take(ptree, object_retain(data));
+}
+
+
+
+// walks down to data's place, making the path private, then skews and
+// splits each node on the way back up
+void ptree_insert_take (struct _ptree * ptree, void * data)
+{
+    struct _ptree_node * path[TREE_ITER_DEPTH];
+    struct _ptree_node * node;
+    struct _ptree_node * old;
+    struct _ptree_node * top;
+    unsigned int depth = 0;
+
+    if (ptree->nodes == NULL) {
+        ptree->nodes = ptree_node_create(data);
+        return;
+    }
+
+    node = ptree_node_own(&(ptree->nodes));
+    while (1) {
+        path[depth++] = node;
+        if (object_cmp(data, node->data) < 0) {
+            if (node->left == NULL) {
+                node->left = ptree_node_create(data);
+                break;
+            }
+            node = ptree_node_own(&(node->left));
+        }
+        else {
+            if (node->right == NULL) {
+                node->right = ptree_node_create(data);
+                break;
+            }
+            node = ptree_node_own(&(node->right));
+        }
+    }
+
+    while (depth > 0) {
+        old = top = path[--depth];
+        ptree_node_skew(&top);
+        ptree_node_split(&top);
+        if (depth > 0)
+            ptree_node_reattach(path[depth - 1], old, top);
+    }
+
+    ptree->nodes = top;
+}
+
+
+
+// finds data, then keeps trading it with its in-order neighbour until it sits
+// in a leaf, which is unlinked. every node on the path down to that leaf is
+// made private, and rebalanced on the way back up
+void ptree_remove (struct _ptree * ptree, const void * data)
+{
+    struct _ptree_node * path[TREE_ITER_DEPTH];
+    struct _ptree_node * old;
+    struct _ptree_node * top;
+    struct _ptree_node * tmp;
+    void               * swap;
+    unsigned int depth = 0;
+    int c;
+
+    // nothing is copied when data is not in the tree
+    if (ptree_fetch(ptree, data) == NULL)
+        return;
+
+    tmp = ptree_node_own(&(ptree->nodes));
+    while (1) {
+        path[depth++] = tmp;
+        c = object_cmp(data, tmp->data);
+        if (c == 0)
+            break;
+        else if (c < 0)
+            tmp = ptree_node_own(&(tmp->left));
+        else
+            tmp = ptree_node_own(&(tmp->right));
+    }
+
+    while ((tmp->left != NULL) || (tmp->right != NULL)) {
+        old = tmp;
+        if (tmp->left == NULL) {
+            tmp = ptree_node_own(&(tmp->right));
+            path[depth++] = tmp;
+            while (tmp->left != NULL) {
+                tmp = ptree_node_own(&(tmp->left));
+                path[depth++] = tmp;
+            }
+        }
+        else {
+            tmp = ptree_node_own(&(tmp->left));
+            path[depth++] = tmp;
+            while (tmp->right != NULL) {
+                tmp = ptree_node_own(&(tmp->right));
+                path[depth++] = tmp;
+            }
+        }
+        swap      = old->data;
+        old->data = tmp->data;
+        tmp->data = swap;
+    }
+
+    depth--;
+    if (depth == 0) {
+        ptree_node_release(tmp);
+        ptree->nodes = NULL;
+        return;
+    }
+    ptree_node_reattach(path[depth - 1], tmp, NULL);
+    ptree_node_release(tmp);
+
+    while (depth > 0) {
+        old = top = path[--depth];
+        ptree_node_decrease_level(top);
+        ptree_node_skew(&top);
+        if (top->right != NULL) {
+            ptree_node_skew(&(top->right));
+            if (    (top->right->right != NULL)
+                 && (top->right->right->left != NULL)
+                 && (top->right->right->level == top->right->right->left->level)) {
+                ptree_node_own(&(top->right));
+                ptree_node_skew(&(top->right->right));
+            }
+        }
+        ptree_node_split(&top);
+        if (top->right != NULL)
+            ptree_node_split(&(top->right));
+        if (depth > 0)
+            ptree_node_reattach(path[depth - 1], old, top);
+    }
+
+    ptree->nodes = top;
+}
+
+
+
+void * ptree_fetch (const struct _ptree * ptree, const void * data)
+{
+    struct _ptree_node * node = ptree->nodes;
+    int c;
+
+    while (node != NULL) {
+        c = object_cmp(data, node->data);
+        if (c == 0)
+            return node->data;
+        else if (c < 0)
+            node = node->left;
+        else
+            node = node->right;
+    }
+
+    return NULL;
+}
+
+
+
+void * ptree_fetch_key (const struct _ptree * ptree,
+                        const void * key,
+                        tree_key_cmp cmp)
+{
+    struct _ptree_node * node = ptree->nodes;
+    int c;
+
+    while (node != NULL) {
+        c = cmp(key, node->data);
+        if (c == 0)
+            return node->data;
+        else if (c < 0)
+            node = node->left;
+        else
+            node = node->right;
+    }
+
+    return NULL;
+}
+
+
+
+void * ptree_fetch_max_key (const struct _ptree * ptree,
+                            const void * key,
+                            tree_key_cmp cmp)
+{
+    struct _ptree_node * node  = ptree->nodes;
+    struct _ptree_node * found = NULL;
+    int c;
+
+    // found is the greatest node seen so far that is less than key
+    while (node != NULL) {
+        c = cmp(key, node->data);
+        if (c == 0)
+            return node->data;
+        else if (c < 0)
+            node = node->left;
+        else {
+            found = node;
+            node  = node->right;
+        }
+    }
+
+    if (found == NULL)
+        return NULL;
+    return found->data;
+}
+
+
+
+void ** ptree_fetch_slot_key (struct _ptree * ptree,
+                              const void * key,
+                              tree_key_cmp cmp)
+{
+    struct _ptree_node * node;
+    int c;
+
+    if (ptree_fetch_key(ptree, key, cmp) == NULL)
+        return NULL;
+
+    node = ptree_node_own(&(ptree->nodes));
+    while (1) {
+        c = cmp(key, node->data);
+        if (c == 0)
+            return &(node->data);
+        else if (c < 0)
+            node = ptree_node_own(&(node->left));
+        else
+            node = ptree_node_own(&(node->right));
+    }
+}
+
+
+
+// pushes node and its left descendants
+static void ptree_iter_left (struct _ptree_iter * iter, struct _ptree_node * node)
+{
+    while (node != NULL) {
+        iter->stack[iter->depth++] = node;
+        node = node->left;
+    }
+}
+
+
+void * ptree_iter_first (struct _ptree_iter * iter, const struct _ptree * ptree)
+{
+    iter->depth = 0;
+    ptree_iter_left(iter, ptree->nodes);
+
+    if (iter->depth == 0)
+        return NULL;
+    return iter->stack[iter->depth - 1]->data;
+}
+
+
+void * ptree_iter_next (struct _ptree_iter * iter)
+{
+    struct _ptree_node * node = iter->stack[--iter->depth];
+
+    ptree_iter_left(iter, node->right);
+
+    if (iter->depth == 0)
+        return NULL;
+    return iter->stack[iter->depth - 1]->data;
+}
@@ -0,0 +1,68 @@
+#ifndef ptree_HEADER
+#define ptree_HEADER
+
+// a persistent AA-tree
+//
+// ptree_copy is O(1): the copy shares every node with the original. nodes
+// are reference counted, and an insert or remove copies only the shared
+// nodes on its path, O(log n) of them, leaving every other version of the
+// tree as it was. nodes which are not shared are modified in place, so a
+// tree which is never copied costs about what a _tree does
+//
+// like _tree, nodes hold references to objects ordered by object_cmp
+
+#include <stdlib.h>
+
+#include "object.h"
+#include "tree.h"
+
+struct _ptree_node {
+    unsigned int         refs;
+    unsigned int         level;
+    void               * data;
+    struct _ptree_node * left;
+    struct _ptree_node * right;
+};
+
+struct _ptree {
+    const struct _object * object;
+    unsigned int           refs;
+    struct _ptree_node   * nodes;
+};
+
+// a stack iterator, as _tree_iter. a version of the tree does not change
+// while it is iterated unless it is itself modified
+struct _ptree_iter {
+    unsigned int         depth;
+    struct _ptree_node * stack[TREE_ITER_DEPTH];
+};
+
+
+struct _ptree * ptree_create ();
+void            ptree_delete (struct _ptree * ptree);
+// O(1), the copy shares all of ptree's nodes
+struct _ptree * ptree_copy   (const struct _ptree * ptree);
+
+void   ptree_insert      (struct _ptree * ptree, const void * data);
+// like ptree_insert, but takes over the caller's reference to data
+void   ptree_insert_take (struct _ptree * ptree, void * data);
+void   ptree_remove      (struct _ptree * ptree, const void * data);
+void * ptree_fetch       (const struct _ptree * ptree, const void * data);
+
+void * ptree_fetch_key     (const struct _ptree * ptree,
+                            const void * key,
+                            tree_key_cmp cmp);
+void * ptree_fetch_max_key (const struct _ptree * ptree,
+                            const void * key,
+                            tree_key_cmp cmp);
+// returns the slot holding the data matching key in a node private to
+// ptree, so the caller may replace the data. NULL if there is no such data
+void ** ptree_fetch_slot_key (struct _ptree * ptree,
+                              const void * key,
+                              tree_key_cmp cmp);
+
+void * ptree_iter_first (struct _ptree_iter * iter,
+                         const struct _ptree * ptree);
+void * ptree_iter_next  (struct _ptree_iter * iter);
+
+#endif
@@ -1,5 +1,10 @@
 #include "queue.h"
 
+#include "arena.h"
+
+// a new queue has room for this many entries before it grows
+#define QUEUE_MIN_CAPACITY 8
+
 static const struct _object queue_object = {
     (void   (*) (void *))         queue_delete, 
     (void * (*) (const void *))         queue_copy,
@@ -7,16 +12,25 @@ static const struct _object queue_object = {
     NULL
 };
 
+static const struct _object queue_u64_object = {
+    (void   (*) (void *))         queue_u64_delete,
+    (void * (*) (const void *))   queue_u64_copy,
+    NULL,
+    NULL
+};
+
 
 struct _queue * queue_create ()
 {
     struct _queue * queue;
 
-    queue = malloc(sizeof(struct _queue));
-    queue->object = &queue_object;
-    queue->size   = 0;
-    queue->front  = NULL;
-    queue->back   = NULL;
+    queue = mem_alloc(sizeof(struct _queue));
+    queue->object   = &queue_object;
+    queue->refs     = 1;
+    queue->size     = 0;
+    queue->capacity = QUEUE_MIN_CAPACITY;
+    queue->front    = 0;
+    queue->items    = (void **) mem_alloc(sizeof(void *) * queue->capacity);
 
     return queue;
 }
@@ -25,29 +39,25 @@ struct _queue * queue_create ()
 
 void queue_delete (struct _queue * queue)
 {
-    struct _queue_it * it;
-    struct _queue_it * next;
-
-    it = queue->front;
-    while (it != NULL) {
-        next = it->next;
-        object_delete(it);
-        free(it);
-        it = next;
-    }
+    size_t mask = queue->capacity - 1;
+    size_t i;
+
+    for (i = 0; i < queue->size; i++)
+        object_delete(queue->items[(queue->front + i) & mask]);
 
-    free(queue);
+    mem_free(queue->items);
+    mem_free(queue);
 }
 
 
 
 struct _queue * queue_copy (const struct _queue * queue) {
     struct _queue * new_queue = queue_create();
-    struct _queue_it * it;
+    size_t mask = queue->capacity - 1;
+    size_t i;
 
-    for (it = queue->front; it != NULL; it = it->next) {
-        queue_push(new_queue, it->data);
-    }
+    for (i = 0; i < queue->size; i++)
+        queue_push(new_queue, queue->items[(queue->front + i) & mask]);
 
     return new_queue;
 }
@@ -56,17 +66,21 @@ struct _queue * queue_copy (const struct _queue * queue) {
 
 void queue_push (struct _queue * queue, const void * data)
 {
-    struct _queue_it * it = queue_it_create(data);
-
-    if (queue->back == NULL) {
-        queue->back = it;
-        queue->front = it;
-    }
-    else {
-        queue->back->next = it;
-        queue->back = it;
+    size_t i;
+
+    // unwrap the entries into a buffer twice the size
+    if (queue->size == queue->capacity) {
+        void ** items = (void **) mem_alloc(sizeof(void *) * queue->capacity * 2);
+        for (i = 0; i < queue->size; i++)
+            items[i] = queue->items[(queue->front + i) & (queue->capacity - 1)];
+        mem_free(queue->items);
+        queue->items     = items;
+        queue->capacity *= 2;
+        queue->front     = 0;
     }
 
+    i = (queue->front + queue->size) & (queue->capacity - 1);
+    queue->items[i] = object_retain(data);
     queue->size++;
 }
 
@@ -74,40 +88,100 @@ void queue_push (struct _queue * queue, const void * data)
 
 void * queue_peek (const struct _queue * queue)
 {
-    if (queue->front == NULL)
+    if (queue->size == 0)
         return NULL;
-    return queue->front->data;
+    return queue->items[queue->front];
 }
 
 
 
 void queue_pop (struct _queue * queue)
 {
-    struct _queue_it * it;
-
-    if (queue->front == NULL)
+    if (queue->size == 0)
         return;
 
-    it = queue->front;
-    queue->front = it->next;
-    if (queue->front == NULL)
-        queue->back = NULL;
+    object_delete(queue->items[queue->front]);
+    queue->front = (queue->front + 1) & (queue->capacity - 1);
+    queue->size--;
+}
 
-    object_delete(it->data);
-    free(it);
 
-    queue->size--;
+
+struct _queue_u64 * queue_u64_create ()
+{
+    struct _queue_u64 * queue;
+
+    queue = mem_alloc(sizeof(struct _queue_u64));
+    queue->object   = &queue_u64_object;
+    queue->refs     = 1;
+    queue->size     = 0;
+    queue->capacity = QUEUE_MIN_CAPACITY;
+    queue->front    = 0;
+    queue->items    = (uint64_t *) mem_alloc(sizeof(uint64_t) * queue->capacity);
+
+    return queue;
+}
+
+
+
+void queue_u64_delete (struct _queue_u64 * queue)
+{
+    mem_free(queue->items);
+    mem_free(queue);
+}
+
+
+
+struct _queue_u64 * queue_u64_copy (const struct _queue_u64 * queue)
+{
+    struct _queue_u64 * new_queue = queue_u64_create();
+    size_t mask = queue->capacity - 1;
+    size_t i;
+
+    for (i = 0; i < queue->size; i++)
+        queue_u64_push(new_queue, queue->items[(queue->front + i) & mask]);
+
+    return new_queue;
+}
+
+
+
+void queue_u64_push (struct _queue_u64 * queue, uint64_t value)
+{
+    size_t i;
+
+    if (queue->size == queue->capacity) {
+        uint64_t * items = (uint64_t *)
+                          mem_alloc(sizeof(uint64_t) * queue->capacity * 2);
+        for (i = 0; i < queue->size; i++)
+            items[i] = queue->items[(queue->front + i) & (queue->capacity - 1)];
+        mem_free(queue->items);
+        queue->items     = items;
+        queue->capacity *= 2;
+        queue->front     = 0;
+    }
+
+    i = (queue->front + queue->size) & (queue->capacity - 1);
+    queue->items[i] = value;
+    queue->size++;
 }
 
 
 
-struct _queue_it * queue_it_create (const void * data)
+uint64_t queue_u64_peek (const struct _queue_u64 * queue)
 {
-    struct _queue_it * it;
+    if (queue->size == 0)
+        return 0;
+    return queue->items[queue->front];
+}
 
-    it = (struct _queue_it *) malloc(sizeof(struct _queue_it));
-    it->data = object_copy(data);
-    it->next = NULL;
 
-    return it;
-}
\ No newline at end of file
+
+void queue_u64_pop (struct _queue_u64 * queue)
+{
+    if (queue->size == 0)
+        return;
+
+    queue->front = (queue->front + 1) & (queue->capacity - 1);
+    queue->size--;
+}
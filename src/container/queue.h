@@ -1,20 +1,35 @@
 #ifndef queue_HEADER
 #define queue_HEADER
 
+// first in, first out queues, kept in growable ring buffers
+//
+// a _queue holds references to objects. a _queue_u64 holds plain uint64_t,
+// which is what most worklists of addresses want, without boxing each one
+// in an _index
+
 #include "object.h"
 
+#include <inttypes.h>
 #include <stdlib.h>
 
-struct _queue_it {
-    void * data;
-    struct _queue_it * next;
-};
-
 struct _queue {
     const struct _object * object;
+    unsigned int           refs;
     size_t size;
-    struct _queue_it * front;
-    struct _queue_it * back;
+    // the front entry is items[front], and entries wrap around at capacity,
+    // which is always a power of two
+    size_t  capacity;
+    size_t  front;
+    void ** items;
+};
+
+struct _queue_u64 {
+    const struct _object * object;
+    unsigned int           refs;
+    size_t     size;
+    size_t     capacity;
+    size_t     front;
+    uint64_t * items;
 };
 
 struct _queue * queue_create ();
@@ -25,6 +40,13 @@ void            queue_push   (struct _queue * queue, const void * data);
 void            queue_pop    (struct _queue * queue);
 void *          queue_peek   (const struct _queue * queue);
 
-struct _queue_it * queue_it_create (const void * data);
+struct _queue_u64 * queue_u64_create ();
+void                queue_u64_delete (struct _queue_u64 * queue);
+struct _queue_u64 * queue_u64_copy   (const struct _queue_u64 * queue);
+
+void                queue_u64_push   (struct _queue_u64 * queue, uint64_t value);
+void                queue_u64_pop    (struct _queue_u64 * queue);
+// returns 0 when the queue is empty
+uint64_t            queue_u64_peek   (const struct _queue_u64 * queue);
 
-#endif
\ No newline at end of file
+#endif
@@ -1,5 +1,7 @@
 #include "tree.h"
 
+#include "arena.h"
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,8 +17,9 @@ struct _tree * tree_create ()
 {
     struct _tree * tree;
 
-    tree = (struct _tree *) malloc(sizeof(struct _tree));
+    tree = (struct _tree *) mem_alloc(sizeof(struct _tree));
     tree->object = &tree_object;
+    tree->refs = 1;
     tree->nodes = NULL;
 
     return tree;
@@ -24,14 +27,25 @@ struct _tree * tree_create ()
 
 
 
+// rotates left children up until the node on top has none, then frees it and
+// moves on to its right child. needs no stack however the subtree is shaped
 void tree_delete_node_delete (struct _tree_node * node)
 {
-    if (node == NULL)
-        return;
-    tree_delete_node_delete(node->left);
-    tree_delete_node_delete(node->right);
-    object_delete(node->data);
-    free(node);
+    struct _tree_node * next;
+
+    while (node != NULL) {
+        if (node->left != NULL) {
+            next = node->left;
+            node->left  = next->right;
+            next->right = node;
+        }
+        else {
+            next = node->right;
+            object_delete(node->data);
+            mem_free(node);
+        }
+        node = next;
+    }
 }
 
 
@@ -39,25 +53,82 @@ void tree_delete_node_delete (struct _tree_node * node)
 void tree_delete (struct _tree * tree)
 {
     tree_delete_node_delete(tree->nodes);
-    free(tree); 
+    mem_free(tree); 
 }
 
 
+// the data is already in order, so the copy is built in one pass rather than
+// by inserting and rebalancing one node at a time
 struct _tree * tree_copy (const struct _tree * tree)
 {
-    struct _tree    * new_tree;
-    struct _tree_it * it;
+    struct _tree      * new_tree;
+    struct _tree_iter   it;
+    void              * data;
+    void             ** sorted;
+    size_t              n = 0;
+
+    for (data = tree_iter_first(&it, tree);
+         data != NULL;
+         data = tree_iter_next(&it)) {
+        n++;
+    }
 
-    new_tree = tree_create();
-    for (it = tree_iterator(tree); it != NULL; it = tree_it_next(it)) {
-        tree_insert(new_tree, tree_it_data(it));
+    sorted = (void **) mem_alloc(sizeof(void *) * n);
+    n = 0;
+    for (data = tree_iter_first(&it, tree);
+         data != NULL;
+         data = tree_iter_next(&it)) {
+        sorted[n++] = object_retain(data);
     }
 
+    new_tree = tree_build_sorted(sorted, n);
+    mem_free(sorted);
+
     return new_tree;
 }
 
 
 
+// the middle element becomes the root of each subtree. a node's level is one
+// less than the number of complete rows beneath and including it, which keeps
+// left children one level down and never gives a right child a right child
+// of its own level
+static struct _tree_node * tree_node_build_sorted (void ** data, size_t n)
+{
+    struct _tree_node * node;
+    size_t              middle;
+    size_t              rows;
+
+    if (n == 0)
+        return NULL;
+
+    middle = (n - 1) / 2;
+
+    node = tree_node_create(data[middle]);
+    node->left  = tree_node_build_sorted(data, middle);
+    node->right = tree_node_build_sorted(&(data[middle + 1]), n - middle - 1);
+
+    for (rows = 0; (n + 1) >> (rows + 1) != 0; rows++)
+        ;
+    node->level = rows - 1;
+
+    return node;
+}
+
+
+
+struct _tree * tree_build_sorted (void ** data, size_t n)
+{
+    struct _tree * tree;
+
+    tree = tree_create();
+    tree->nodes = tree_node_build_sorted(data, n);
+
+    return tree;
+}
+
+
+
 void tree_map (struct _tree * tree, void (* callback) (void *))
 {
     tree_node_map(tree->nodes, callback);
@@ -66,6 +137,13 @@ void tree_map (struct _tree * tree, void (* callback) (void *))
 
 
 void tree_insert (struct _tree * tree, const void * data)
+{
+    tree_insert_take(tree, object_retain(data));
+}
+
+
+
+void tree_insert_take (struct _tree * tree, void * data)
 {
     struct _tree_node * node;
 
@@ -101,6 +179,35 @@ void * tree_fetch_max (const struct _tree * tree, const void * data)
 }
 
 
+void * tree_fetch_key (const struct _tree * tree,
+                       const void * key,
+                       tree_key_cmp cmp)
+{
+    struct _tree_node * node;
+
+    node = tree_node_fetch_key(tree->nodes, key, cmp);
+    if (node == NULL)
+        return NULL;
+
+    return node->data;
+}
+
+
+
+void * tree_fetch_max_key (const struct _tree * tree,
+                           const void * key,
+                           tree_key_cmp cmp)
+{
+    struct _tree_node * node;
+
+    node = tree_node_fetch_max_key(tree->nodes, key, cmp);
+    if (node == NULL)
+        return NULL;
+
+    return node->data;
+}
+
+
 void tree_remove (struct _tree * tree, const void * data)
 {
     tree->nodes = tree_node_delete(tree, tree->nodes, data);
@@ -108,12 +215,12 @@ void tree_remove (struct _tree * tree, const void * data)
 
 
 
-struct _tree_node * tree_node_create (const void * data)
+struct _tree_node * tree_node_create (void * data)
 {
     struct _tree_node * node;
 
-    node = (struct _tree_node *) malloc(sizeof(struct _tree_node));
-    node->data = object_copy(data);
+    node = (struct _tree_node *) mem_alloc(sizeof(struct _tree_node));
+    node->data = data;
 
     node->level     = 0;
     node->left      = NULL;
@@ -124,30 +231,80 @@ struct _tree_node * tree_node_create (const void * data)
 
 
 
+// visits a node before its left and then its right subtree. at most one
+// pending right subtree is stacked per level
 void tree_node_map (struct _tree_node * node, void (* callback) (void *))
 {
-    if (node == NULL)
-        return;
-    callback(node->data);
-    tree_node_map(node->left,  callback);
-    tree_node_map(node->right, callback);
+    struct _tree_node * stack[TREE_ITER_DEPTH];
+    unsigned int depth = 0;
+
+    while (1) {
+        while (node != NULL) {
+            callback(node->data);
+            if (node->right != NULL)
+                stack[depth++] = node->right;
+            node = node->left;
+        }
+        if (depth == 0)
+            break;
+        node = stack[--depth];
+    }
 }
 
 
 
+// points parent at node where it pointed at old, after old's subtree has been
+// rebalanced into one rooted at node
+static void tree_node_reattach (struct _tree_node * parent,
+                                struct _tree_node * old,
+                                struct _tree_node * node)
+{
+    if (parent->left == old)
+        parent->left = node;
+    else
+        parent->right = node;
+}
+
+
+
+// walks down to new_node's place, remembering the path, then skews and splits
+// each node on the way back up
 struct _tree_node * tree_node_insert (struct _tree * tree,
                                       struct _tree_node * node,
                                       struct _tree_node * new_node)
 {
+    struct _tree_node * path[TREE_ITER_DEPTH];
+    struct _tree_node * old;
+    unsigned int depth = 0;
+
     if (node == NULL)
         return new_node;
-    else if (object_cmp(new_node->data, node->data) < 0)
-        node->left  = tree_node_insert(tree, node->left,  new_node);
-    else
-        node->right = tree_node_insert(tree, node->right, new_node);
 
-    node = tree_node_skew (node);
-    node = tree_node_split(node);
+    while (1) {
+        path[depth++] = node;
+        if (object_cmp(new_node->data, node->data) < 0) {
+            if (node->left == NULL) {
+                node->left = new_node;
+                break;
+            }
+            node = node->left;
+        }
+        else {
+            if (node->right == NULL) {
+                node->right = new_node;
+                break;
+            }
+            node = node->right;
+        }
+    }
+
+    while (depth > 0) {
+        old  = path[--depth];
+        node = tree_node_skew (old);
+        node = tree_node_split(node);
+        if (depth > 0)
+            tree_node_reattach(path[depth - 1], old, node);
+    }
 
     return node;
 }
@@ -158,14 +315,19 @@ struct _tree_node * tree_node_fetch   (const struct _tree * tree,
                                        struct _tree_node * node,
                                        const void * data)
 {
-    if (node == NULL)
-        return NULL;
-    if (object_cmp(data, node->data) == 0)
-        return node;
-    else if (object_cmp(data, node->data) < 0)
-        return tree_node_fetch(tree, node->left, data);
-    else
-        return tree_node_fetch(tree, node->right, data);
+    int c;
+
+    while (node != NULL) {
+        c = object_cmp(data, node->data);
+        if (c == 0)
+            return node;
+        else if (c < 0)
+            node = node->left;
+        else
+            node = node->right;
+    }
+
+    return NULL;
 }
 
 
@@ -174,19 +336,67 @@ struct _tree_node * tree_node_fetch_max (const struct _tree * tree,
                                          struct _tree_node * node,
                                          const void * data)
 {
-    struct _tree_node * found;
+    struct _tree_node * found = NULL;
+    int c;
+
+    while (node != NULL) {
+        c = object_cmp(data, node->data);
+        if (c == 0)
+            return node;
+        else if (c < 0)
+            node = node->left;
+        else {
+            found = node;
+            node  = node->right;
+        }
+    }
 
-    if (node == NULL)
-        return NULL;
-    if (object_cmp(data, node->data) == 0)
-        return node;
-    else if (object_cmp(data, node->data) < 0)
-        found = tree_node_fetch_max(tree, node->left, data);
-    else
-        found = tree_node_fetch_max(tree, node->right, data);
+    return found;
+}
+
+
+
+struct _tree_node * tree_node_fetch_key (struct _tree_node * node,
+                                         const void * key,
+                                         tree_key_cmp cmp)
+{
+    int c;
+
+    while (node != NULL) {
+        c = cmp(key, node->data);
+        if (c == 0)
+            return node;
+        else if (c < 0)
+            node = node->left;
+        else
+            node = node->right;
+    }
+
+    return NULL;
+}
+
+
+
+struct _tree_node * tree_node_fetch_max_key (struct _tree_node * node,
+                                             const void * key,
+                                             tree_key_cmp cmp)
+{
+    struct _tree_node * found = NULL;
+    int c;
+
+    // found is the greatest node seen so far that is less than key
+    while (node != NULL) {
+        c = cmp(key, node->data);
+        if (c == 0)
+            return node;
+        else if (c < 0)
+            node = node->left;
+        else {
+            found = node;
+            node  = node->right;
+        }
+    }
 
-    if ((found == NULL) && (object_cmp(data, node->data) > 0))
-        return node;
     return found;
 }
 
@@ -238,47 +448,83 @@ struct _tree_node * tree_node_decrease_level (struct _tree_node * node)
 
 
 
+// finds data, then keeps trading it with its in-order neighbour until it sits
+// in a leaf, which is unlinked. every node on the path down to that leaf is
+// rebalanced on the way back up
 struct _tree_node * tree_node_delete (struct _tree * tree,
                                       struct _tree_node * node,
                                       const void * data)
 {
+    struct _tree_node * path[TREE_ITER_DEPTH];
+    struct _tree_node * old;
     struct _tree_node * tmp;
+    void              * swap;
+    unsigned int depth = 0;
+    int c;
+
+    tmp = node;
+    while (tmp != NULL) {
+        path[depth++] = tmp;
+        c = object_cmp(data, tmp->data);
+        if (c == 0)
+            break;
+        else if (c < 0)
+            tmp = tmp->left;
+        else
+            tmp = tmp->right;
+    }
+    if (depth == 0)
+        return NULL;
 
-    if (node == NULL)
-        return node;
-    if (object_cmp(data, node->data) < 0)
-        node->left = tree_node_delete(tree, node->left, data);
-    else if (object_cmp(data, node->data) > 0)
-        node->right = tree_node_delete(tree, node->right, data);
-    else {
-        if ((node->left == NULL) && (node->right == NULL)) {
-            tree_delete_node_delete(node);
-            return NULL;
-        }
-        else if (node->left == NULL) {
-            tmp = tree_node_successor(node);
-            object_delete(node->data);
-            node->data = object_copy(tmp->data);
-            node->right = tree_node_delete(tree, node->right, tmp->data);
+    while ((tmp != NULL) && ((tmp->left != NULL) || (tmp->right != NULL))) {
+        old = tmp;
+        if (tmp->left == NULL) {
+            tmp = tmp->right;
+            path[depth++] = tmp;
+            while (tmp->left != NULL) {
+                tmp = tmp->left;
+                path[depth++] = tmp;
+            }
         }
         else {
-            tmp = tree_node_predecessor(node);
-            object_delete(node->data);
-            node->data = object_copy(tmp->data);
-            node->left = tree_node_delete(tree, node->left, tmp->data);
+            tmp = tmp->left;
+            path[depth++] = tmp;
+            while (tmp->right != NULL) {
+                tmp = tmp->right;
+                path[depth++] = tmp;
+            }
         }
+        swap      = old->data;
+        old->data = tmp->data;
+        tmp->data = swap;
     }
 
-    node = tree_node_decrease_level(node);
-    node = tree_node_skew(node);
-    if (node->right != NULL) {
-        node->right = tree_node_skew(node->right);
-        if (node->right->right != NULL)
-            node->right->right = tree_node_skew(node->right->right);
+    // when data is not in the tree the path is rebalanced all the same
+    if (tmp != NULL) {
+        depth--;
+        if (depth == 0) {
+            tree_delete_node_delete(tmp);
+            return NULL;
+        }
+        tree_node_reattach(path[depth - 1], tmp, NULL);
+        tree_delete_node_delete(tmp);
+    }
+
+    while (depth > 0) {
+        old  = path[--depth];
+        node = tree_node_decrease_level(old);
+        node = tree_node_skew(node);
+        if (node->right != NULL) {
+            node->right = tree_node_skew(node->right);
+            if (node->right->right != NULL)
+                node->right->right = tree_node_skew(node->right->right);
+        }
+        node = tree_node_split(node);
+        if (node->right != NULL)
+            node->right = tree_node_split(node->right);
+        if (depth > 0)
+            tree_node_reattach(path[depth - 1], old, node);
     }
-    node = tree_node_split(node);
-    if (node->right != NULL)
-        node->right = tree_node_split(node->right);
 
     return node;
 }
@@ -322,7 +568,7 @@ struct _tree_it * tree_it_create (struct _tree_node * node)
 {
     struct _tree_it * tree_it;
 
-    tree_it = (struct _tree_it *) malloc(sizeof(struct _tree_it));
+    tree_it = (struct _tree_it *) mem_alloc(sizeof(struct _tree_it));
     tree_it->direction = TREE_LEFT;
     tree_it->node      = node;
     tree_it->parent    = NULL;
@@ -378,7 +624,7 @@ struct _tree_it * tree_it_next (struct _tree_it * tree_it)
     else {
         while (tree_it != NULL) {
             it = tree_it->parent;
-            free(tree_it);
+            mem_free(tree_it);
             if (it == NULL)
                 return NULL;
             if (it->direction == TREE_LEFT)
@@ -402,6 +648,40 @@ void tree_it_delete (struct _tree_it * tree_it)
 {
     if (tree_it != NULL) {
         tree_it_delete(tree_it->parent);
-        free(tree_it);
+        mem_free(tree_it);
     }
+}
+
+
+
+// pushes node and its left descendants
+static void tree_iter_left (struct _tree_iter * iter, struct _tree_node * node)
+{
+    while (node != NULL) {
+        iter->stack[iter->depth++] = node;
+        node = node->left;
+    }
+}
+
+
+void * tree_iter_first (struct _tree_iter * iter, const struct _tree * tree)
+{
+    iter->depth = 0;
+    tree_iter_left(iter, tree->nodes);
+
+    if (iter->depth == 0)
+        return NULL;
+    return iter->stack[iter->depth - 1]->data;
+}
+
+
+void * tree_iter_next (struct _tree_iter * iter)
+{
+    struct _tree_node * node = iter->stack[--iter->depth];
+
+    tree_iter_left(iter, node->right);
+
+    if (iter->depth == 0)
+        return NULL;
+    return iter->stack[iter->depth - 1]->data;
 }
\ No newline at end of file
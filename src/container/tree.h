@@ -15,6 +15,17 @@ struct _tree_it {
     struct _tree_node * node;
 };
 
+// an in-order iterator which lives on the caller's stack and never allocates.
+// an AA-tree of n nodes is at most 2 * log2(n) deep, so a fixed stack holds
+// the path to any node of any tree that fits in memory. the node functions
+// below size their parent-path stacks the same way
+#define TREE_ITER_DEPTH 128
+
+struct _tree_iter {
+    unsigned int        depth;
+    struct _tree_node * stack[TREE_ITER_DEPTH];
+};
+
 struct _tree_node {
     unsigned int level;
     void * data;
@@ -22,8 +33,13 @@ struct _tree_node {
     struct _tree_node * right;
 };
 
+// compares a raw key against the data held in a tree node, returning < 0, 0
+// or > 0 in the same sense as object_cmp(key, data)
+typedef int (* tree_key_cmp) (const void * key, const void * data);
+
 struct _tree {
     const struct _object * object;
+    unsigned int           refs;
     struct _tree_node * nodes;
 };
 
@@ -32,14 +48,30 @@ struct _tree * tree_create      ();
 void           tree_delete      (struct _tree * tree);
 struct _tree * tree_copy        (const struct _tree * tree);
 
+// builds a balanced tree in O(n) from n objects in strictly ascending order
+// of object_cmp. takes over the caller's references to the objects, but not
+// the array holding them
+struct _tree * tree_build_sorted (void ** data, size_t n);
+
 void           tree_map (struct _tree * tree, void (* callback) (void *));
 
 void           tree_remove      (struct _tree * tree, const void * data);
-void           tree_insert      (struct _tree * tree, const const void * data);
+void           tree_insert      (struct _tree * tree, const void * data);
+// like tree_insert, but takes over the caller's reference to data
+void           tree_insert_take (struct _tree * tree, void * data);
 void *         tree_fetch       (const struct _tree * tree, const void * data);
 void *         tree_fetch_max   (const struct _tree * tree, const void * data);
 
-struct _tree_node * tree_node_create  (const void * data);
+// lookups by raw key, so callers need not build a needle object
+void *         tree_fetch_key     (const struct _tree * tree,
+                                   const void * key,
+                                   tree_key_cmp cmp);
+void *         tree_fetch_max_key (const struct _tree * tree,
+                                   const void * key,
+                                   tree_key_cmp cmp);
+
+// takes over the caller's reference to data
+struct _tree_node * tree_node_create  (void * data);
 void                tree_node_map     (struct _tree_node * node,
                                        void (* callback) (void *));
 
@@ -55,6 +87,14 @@ struct _tree_node * tree_node_fetch_max (const struct _tree * tree,
                                          struct _tree_node * node,
                                          const void * data);
 
+struct _tree_node * tree_node_fetch_key     (struct _tree_node * node,
+                                             const void * key,
+                                             tree_key_cmp cmp);
+
+struct _tree_node * tree_node_fetch_max_key (struct _tree_node * node,
+                                             const void * key,
+                                             tree_key_cmp cmp);
+
 // deletes a node from a tree
 struct _tree_node * tree_node_delete  (struct _tree * tree,
                                        struct _tree_node * node,
@@ -68,4 +108,10 @@ struct _tree_it * tree_it_next    (struct _tree_it * tree_it);
 void *            tree_it_data    (const struct _tree_it * tree_it);
 void              tree_it_delete  (struct _tree_it * tree_it);
 
+// return the first/next data in the tree, or NULL when there is none left.
+// like _tree_it, an iterator is invalidated by inserts and removes
+void *            tree_iter_first (struct _tree_iter * iter,
+                                   const struct _tree * tree);
+void *            tree_iter_next  (struct _tree_iter * iter);
+
 #endif
\ No newline at end of file
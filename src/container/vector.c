@@ -0,0 +1,131 @@
+#include "vector.h"
+
+#include "arena.h"
+
+static const struct _object vector_object = {
+    (void     (*) (void *))             vector_delete,
+    (void *   (*) (const void *))       vector_copy,
+    NULL,
+    (void     (*) (void *, const void *)) vector_append_vector
+};
+
+
+struct _vector * vector_create ()
+{
+    struct _vector * vector;
+
+    vector = (struct _vector *) mem_alloc(sizeof(struct _vector));
+    vector->object   = &vector_object;
+    vector->refs     = 1;
+    vector->size     = 0;
+    vector->capacity = VECTOR_INLINE;
+    vector->items    = vector->inline_items;
+
+    return vector;
+}
+
+
+
+void vector_delete (struct _vector * vector)
+{
+    size_t i;
+
+    for (i = 0; i < vector->size; i++)
+        object_delete(vector->items[i]);
+
+    if (vector->items != vector->inline_items)
+        mem_free(vector->items);
+    mem_free(vector);
+}
+
+
+
+struct _vector * vector_copy (const struct _vector * vector)
+{
+    struct _vector * new_vector = vector_create();
+
+    vector_append_vector(new_vector, vector);
+
+    return new_vector;
+}
+
+
+
+// makes room for at least n entries
+static void vector_reserve (struct _vector * vector, size_t n)
+{
+    void ** items;
+    size_t  capacity;
+    size_t  i;
+
+    if (n <= vector->capacity)
+        return;
+
+    capacity = vector->capacity * 2;
+    while (capacity < n)
+        capacity *= 2;
+
+    items = (void **) mem_alloc(sizeof(void *) * capacity);
+    for (i = 0; i < vector->size; i++)
+        items[i] = vector->items[i];
+
+    if (vector->items != vector->inline_items)
+        mem_free(vector->items);
+    vector->items    = items;
+    vector->capacity = capacity;
+}
+
+
+
+void vector_append (struct _vector * vector, const void * data)
+{
+    vector_append_take(vector, object_retain(data));
+}
+
+
+
+void vector_append_take (struct _vector * vector, void * data)
+{
+    vector_reserve(vector, vector->size + 1);
+    vector->items[vector->size++] = data;
+}
+
+
+
+void vector_append_vector (struct _vector * vector, const struct _vector * rhs)
+{
+    // rhs may be vector itself
+    size_t n = rhs->size;
+    size_t i;
+
+    vector_reserve(vector, vector->size + n);
+    for (i = 0; i < n; i++)
+        vector->items[vector->size++] = object_retain(rhs->items[i]);
+}
+
+
+
+void * vector_get (const struct _vector * vector, size_t i)
+{
+    return vector->items[i];
+}
+
+
+
+void * vector_first (const struct _vector * vector)
+{
+    if (vector->size == 0)
+        return NULL;
+    return vector->items[0];
+}
+
+
+
+void vector_remove (struct _vector * vector, size_t i)
+{
+    object_delete(vector->items[i]);
+
+    vector->size--;
+    for (; i < vector->size; i++)
+        vector->items[i] = vector->items[i + 1];
+}
@@ -0,0 +1,42 @@
+#ifndef vector_HEADER
+#define vector_HEADER
+
+// a growable array of object references
+//
+// the first VECTOR_INLINE entries live inside the vector itself, so the
+// short vectors which make up most of them, like an instruction's
+// successors or a graph node's edges, need no allocation beyond their own.
+// entries are read by position, items[0] to items[size - 1]
+
+#include <stdlib.h>
+
+#include "object.h"
+
+#define VECTOR_INLINE 3
+
+struct _vector {
+    const struct _object * object;
+    unsigned int           refs;
+    size_t  size;
+    size_t  capacity;
+    // points at inline_items until the vector outgrows them
+    void ** items;
+    void *  inline_items[VECTOR_INLINE];
+};
+
+struct _vector * vector_create ();
+void             vector_delete (struct _vector * vector);
+struct _vector * vector_copy   (const struct _vector * vector);
+
+void   vector_append        (struct _vector * vector, const void * data);
+// like vector_append, but takes over the caller's reference to data
+void   vector_append_take   (struct _vector * vector, void * data);
+void   vector_append_vector (struct _vector * vector, const struct _vector * rhs);
+
+void * vector_get    (const struct _vector * vector, size_t i);
+// returns NULL if the vector is empty
+void * vector_first  (const struct _vector * vector);
+// removes the entry at i, moving the entries after it down by one
+void   vector_remove (struct _vector * vector, size_t i);
+
+#endif
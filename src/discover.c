@@ -0,0 +1,228 @@
+#include "discover.h"
+
+#include "arena.h"
+#include "hashmap.h"
+#include "index.h"
+#include "ins_cache.h"
+#include "pool.h"
+#include "queue.h"
+#include "util.h"
+
+#include <pthread.h>
+
+// what a worker found at one address
+struct _discovered {
+    const struct _object * object;
+    unsigned int           refs;
+    // NULL once handed to found
+    void                 * kept;
+    // every call destination, in the order the graph lists them
+    size_t                 call_dests_n;
+    uint64_t             * call_dests;
+};
+
+static void discovered_delete (struct _discovered * discovered);
+
+static const struct _object discovered_object = {
+    (void   (*) (void *)) discovered_delete,
+    NULL,
+    NULL,
+    NULL
+};
+
+struct _discover {
+    const struct _arch_dis_option * option;
+    const struct _map             * mem_map;
+    discover_keep_f                 keep;
+    void                          * data;
+    // one per worker
+    struct _arena                ** arenas;
+    // shared by every worker
+    struct _ins_cache             * cache;
+    // guards claimed and found, which are allocated with no arena bound
+    pthread_mutex_t                 lock;
+    struct _hashset               * claimed;
+    // address to _discovered
+    struct _hashmap               * found;
+};
+
+
+// allocated with malloc, as it is handed from a worker to the caller
+static struct _discovered * discovered_create (void * kept, size_t call_dests_n)
+{
+    struct _discovered * discovered;
+
+    discovered = (struct _discovered *) malloc(sizeof(struct _discovered));
+    discovered->object       = &discovered_object;
+    discovered->refs         = 1;
+    discovered->kept         = kept;
+    discovered->call_dests_n = call_dests_n;
+    discovered->call_dests   = malloc(sizeof(uint64_t) * call_dests_n);
+
+    return discovered;
+}
+
+
+static void discovered_delete (struct _discovered * discovered)
+{
+    if (discovered->kept != NULL)
+        object_delete(discovered->kept);
+    free(discovered->call_dests);
+    free(discovered);
+}
+
+
+
+// address was claimed before it was pushed
+static void discover_task (struct _pool * pool,
+                           unsigned int worker,
+                           uint64_t address,
+                           void * data)
+{
+    struct _discover   * discover       = data;
+    struct _arena      * previous       = arena_bind(discover->arenas[worker]);
+    struct _ins_cache  * previous_cache = ins_cache_bind(discover->cache);
+    struct _discovered * discovered;
+    struct _list_it    * lit;
+
+    struct _graph  * unfrozen = discover->option->disassemble(discover->mem_map,
+                                                              address);
+    struct _fgraph * graph    = graph_freeze(unfrozen);
+    object_delete(unfrozen);
+
+    ins_cache_bind(previous_cache);
+
+    struct _list * call_dests;
+    if (discover->option->granularity == ARCH_DIS_BLOCKS)
+        call_dests = block_graph_to_list_index_call_dest(graph);
+    else
+        call_dests = ins_graph_to_list_index_call_dest(graph);
+
+    void * kept = discover->keep(address, graph, discover->data);
+    object_delete(graph);
+
+    arena_bind(NULL);
+    discovered = discovered_create(kept, call_dests->size);
+
+    pthread_mutex_lock(&(discover->lock));
+
+    discovered->call_dests_n = 0;
+    for (lit = list_iterator(call_dests); lit != NULL; lit = lit->next) {
+        struct _index * index = lit->data;
+        discovered->call_dests[discovered->call_dests_n++] = index->index;
+        if (hashset_insert(discover->claimed, index->index) == 0)
+            pool_push(pool, worker, index->index);
+    }
+    hashmap_insert_take(discover->found, address, discovered);
+
+    pthread_mutex_unlock(&(discover->lock));
+
+    object_delete(call_dests);
+    arena_bind(previous);
+}
+
+
+
+void discover_functions (const struct _arch_dis_option * option,
+                         const struct _map * mem_map,
+                         const struct _list * entries,
+                         unsigned int jobs,
+                         discover_keep_f keep,
+                         discover_found_f found,
+                         void * data)
+{
+    struct _discover   discover;
+    struct _pool     * pool;
+    struct _list_it  * lit;
+    struct _arena    * previous;
+    unsigned int       i;
+
+    if (jobs == 0)
+        jobs = 1;
+
+    previous = arena_bind(NULL);
+
+    discover.option  = option;
+    discover.mem_map = mem_map;
+    discover.keep    = keep;
+    discover.data    = data;
+    discover.arenas  = malloc(sizeof(struct _arena *) * jobs);
+    discover.claimed = hashset_create();
+    discover.found   = hashmap_create();
+    pthread_mutex_init(&(discover.lock), NULL);
+
+    // the workers' arenas go with the caller's
+    for (i = 0; i < jobs; i++) {
+        discover.arenas[i] = arena_create();
+        if (previous != NULL)
+            arena_hold(previous, discover.arenas[i]);
+    }
+
+    // the workers decode through the caller's cache when it serves mem_map,
+    // and through one of their own otherwise
+    discover.cache = ins_cache_bind(NULL);
+    ins_cache_bind(discover.cache);
+    if ((discover.cache != NULL) && (discover.cache->mem_map == mem_map))
+        object_retain(discover.cache);
+    else
+        discover.cache = ins_cache_create(mem_map);
+
+    pool = pool_create(jobs, discover_task, &discover);
+
+    // entries are dealt out across the workers to start them off
+    i = 0;
+    for (lit = list_iterator((struct _list *) entries);
+         lit != NULL;
+         lit = lit->next) {
+        struct _index * index = lit->data;
+        if (hashset_insert(discover.claimed, index->index) == 0)
+            pool_push(pool, (i++) % jobs, index->index);
+    }
+
+    pool_run(pool);
+
+    arena_bind(previous);
+
+    // replay a first in, first out discovery over what the workers found
+    struct _hashset   * seen  = hashset_create();
+    struct _queue_u64 * queue = queue_u64_create();
+
+    for (lit = list_iterator((struct _list *) entries);
+         lit != NULL;
+         lit = lit->next) {
+        struct _index * index = lit->data;
+        queue_u64_push(queue, index->index);
+    }
+
+    while (queue->size > 0) {
+        uint64_t address = queue_u64_peek(queue);
+        queue_u64_pop(queue);
+        if (hashset_insert(seen, address))
+            continue;
+
+        struct _discovered * discovered = hashmap_fetch(discover.found, address);
+        for (i = 0; i < discovered->call_dests_n; i++)
+            queue_u64_push(queue, discovered->call_dests[i]);
+
+        void * kept = discovered->kept;
+        discovered->kept = NULL;
+        hashmap_remove(discover.found, address);
+
+        found(address, kept, data);
+    }
+
+    objects_delete(queue,
+                   seen,
+                   pool,
+                   discover.claimed,
+                   discover.found,
+                   discover.cache,
+                   NULL);
+    pthread_mutex_destroy(&(discover.lock));
+
+    // a worker's arena lives on while anything kept from it, or cached from
+    // it, does
+    for (i = 0; i < jobs; i++)
+        object_delete(discover.arenas[i]);
+    free(discover.arenas);
+}
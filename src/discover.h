@@ -0,0 +1,52 @@
+#ifndef discover_HEADER
+#define discover_HEADER
+
+/*
+* Finds every function reachable from a program's entries, disassembling
+* each, and then each destination its calls reach, on a pool of threads
+* (pool.h).
+*
+* A worker claims a call destination before pushing it, so every function
+* is disassembled once. Workers disassemble in arenas of their own, which
+* the caller's bound arena holds (arena.h), and
+* besides the pool they share the memory map, the claimed addresses and the
+* results, under one lock, and one _ins_cache (ins_cache.h), so every
+* instruction is decoded once for the whole program. That is the cache the
+* caller has bound, if it is for the same memory map, or else one made for
+* this run.
+*
+* Results are handed back once the pool is done, in the order a single
+* thread taking functions first in, first out would find them. Output does
+* not depend on the number of jobs or on how the threads ran.
+*/
+
+#include <inttypes.h>
+
+#include "arch.h"
+#include "fgraph.h"
+#include "list.h"
+#include "map.h"
+
+// called on a worker thread with each function found, as option's frozen
+// graph, and the worker's arena bound. returns the object kept for found,
+// which the worker must hold no other references to
+typedef void * (* discover_keep_f)  (uint64_t address,
+                                     const struct _fgraph * graph,
+                                     void * data);
+
+// called on the calling thread, in discovery order, with what keep returned
+// for each function. takes over the reference to kept
+typedef void   (* discover_found_f) (uint64_t address,
+                                     void * kept,
+                                     void * data);
+
+// entries is a list of _index
+void discover_functions (const struct _arch_dis_option * option,
+                         const struct _map * mem_map,
+                         const struct _list * entries,
+                         unsigned int jobs,
+                         discover_keep_f keep,
+                         discover_found_f found,
+                         void * data);
+
+#endif
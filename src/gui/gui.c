@@ -1,9 +1,14 @@
 #include "gui.h"
 
+#include "arena.h"
 #include "buffer.h"
+#include "discover.h"
+#include "fgraph.h"
 #include "function.h"
 #include "graph.h"
+#include "hashmap.h"
 #include "index.h"
+#include "ins_cache.h"
 #include "loader.h"
 #include "map.h"
 #include "queue.h"
@@ -26,8 +31,9 @@ struct _gui * gui_create ()
 {
     struct _gui * gui = (struct _gui *) malloc(sizeof(struct _gui));
 
-    gui->memory_map = map_create();
+    gui->memory_map = map_create_btree();
     gui->arch       = NULL;
+    gui->jobs       = 1;
 
     gui->window = gtk_window_new(GTK_WINDOW_TOPLEVEL);
     gui->vbox   = gtk_box_new(GTK_ORIENTATION_VERTICAL, 2);
@@ -116,6 +122,59 @@ void gui_delete (struct _gui * gui)
 }
 
 
+static void gui_add_function (struct _gui * gui,
+                              const struct _loader * loader,
+                              const struct _buffer * buffer,
+                              uint64_t address,
+                              const struct _fgraph * graph)
+{
+    struct _function * function = function_create(address,
+                                                  graph,
+                                                  loader->label(buffer, address));
+
+    GtkTreeIter treeIter;
+    char addrText[64];
+    snprintf(addrText, 64, "%04llx", (unsigned long long) function->address);
+
+    gtk_list_store_append(gui->functionsStore, &treeIter);
+    gtk_list_store_set(gui->functionsStore, &treeIter,
+                       FUNCTION_FUNCTION, function,
+                       FUNCTION_ADDR,     addrText,
+                       FUNCTION_NAME,     function->name,
+                       -1);
+}
+
+
+struct _gui_found {
+    struct _gui           * gui;
+    const struct _loader  * loader;
+    const struct _buffer  * buffer;
+};
+
+
+// runs on a worker thread, so only keeps the graph. the gui is not touched
+// until gui_found_function
+static void * gui_keep_function (uint64_t address,
+                                 const struct _fgraph * graph,
+                                 void * data)
+{
+    return object_retain(graph);
+}
+
+
+static void gui_found_function (uint64_t address, void * kept, void * data)
+{
+    struct _gui_found * gui_found = data;
+
+    gui_add_function(gui_found->gui,
+                     gui_found->loader,
+                     gui_found->buffer,
+                     address,
+                     kept);
+    object_delete(kept);
+}
+
+
 int gui_init_from_buf (struct _gui * gui, struct _buffer * buffer)
 {
     const struct _loader * loader = loader_select(buffer);
@@ -142,51 +201,71 @@ int gui_init_from_buf (struct _gui * gui, struct _buffer * buffer)
 
     arch_disassemble disassemble = gui->arch->default_dis_option.disassemble;
 
-    struct _queue * queue = queue_create();
+    struct _arena * arena    = arena_create();
+    struct _arena * previous = arena_bind(arena);
+
+    // instructions reached from more than one function are decoded once
+    struct _ins_cache * cache          = ins_cache_create(gui->memory_map);
+    struct _ins_cache * previous_cache = ins_cache_bind(cache);
+
+    if (gui->jobs > 1) {
+        struct _gui_found gui_found;
+        gui_found.gui    = gui;
+        gui_found.loader = loader;
+        gui_found.buffer = buffer;
+
+        discover_functions(&(gui->arch->default_dis_option),
+                           gui->memory_map,
+                           entries,
+                           gui->jobs,
+                           gui_keep_function,
+                           gui_found_function,
+                           &gui_found);
+
+        ins_cache_bind(previous_cache);
+        arena_bind(previous);
+        objects_delete(cache, arena, entries, NULL);
+
+        return GUI_SUCCESS;
+    }
+
+    struct _queue_u64 * queue = queue_u64_create();
 
     struct _list_it * lit;
     for (lit = list_iterator(entries); lit != NULL; lit = lit->next) {
-        queue_push(queue, lit->data);
+        struct _index * index = lit->data;
+        queue_u64_push(queue, index->index);
     }
 
-    struct _map * added = map_create();
+    struct _hashset * added = hashset_create();
 
     while (queue->size > 0) {
-        struct _index * index = queue_peek(queue);
-        if (map_fetch(added, index->index)) {
-            queue_pop(queue);
+        uint64_t address = queue_u64_peek(queue);
+        queue_u64_pop(queue);
+        if (hashset_insert(added, address))
             continue;
-        }
 
-        map_insert(added, index->index, index);
+        struct _graph  * unfrozen = disassemble(gui->memory_map, address);
+        struct _fgraph * graph    = graph_freeze(unfrozen);
+        object_delete(unfrozen);
 
-        struct _graph * graph = disassemble(gui->memory_map, index->index);
         struct _list * call_dests = ins_graph_to_list_index_call_dest(graph);
-        for (lit = list_iterator(call_dests); lit != NULL; lit = lit->next)
-            queue_push(queue, lit->data);
+        for (lit = list_iterator(call_dests); lit != NULL; lit = lit->next) {
+            struct _index * index = lit->data;
+            queue_u64_push(queue, index->index);
+        }
         object_delete(call_dests);
 
-        struct _function * function = function_create(index->index,
-                                                      graph,
-                                                      loader->label(buffer, index->index));
+        gui_add_function(gui, loader, buffer, address, graph);
         object_delete(graph);
-
-        GtkTreeIter treeIter;
-        char addrText[64];
-        snprintf(addrText, 64, "%04llx", (unsigned long long) function->address);
-
-        gtk_list_store_append(gui->functionsStore, &treeIter);
-        gtk_list_store_set(gui->functionsStore, &treeIter,
-                           FUNCTION_FUNCTION, function,
-                           FUNCTION_ADDR,     addrText,
-                           FUNCTION_NAME,     function->name,
-                           -1);
-
-        queue_pop(queue);
     }
 
     objects_delete(queue, added, NULL);
 
+    ins_cache_bind(previous_cache);
+    arena_bind(previous);
+    objects_delete(cache, arena, entries, NULL);
+
     return GUI_SUCCESS;
 }
 
@@ -237,10 +316,12 @@ void gui_function_activated (GtkTreeView * treeView,
                        FUNCTION_FUNCTION, &function,
                        -1);
 
-    struct _graph * gg = ins_graph_to_list_ins_graph(function->graph);
-    graph_reduce(gg);
+    struct _graph * gg = ins_graph_to_block_graph(function->graph);
 
-    struct _rdg * rdg = rdg_create(function->address, gg);
+    struct _fgraph * blocks = graph_freeze(gg);
+    object_delete(gg);
+
+    struct _rdg * rdg = rdg_create(function->address, blocks);
 
     GdkPixbuf * pixbuf = gdk_pixbuf_get_from_surface(rdg->surface,
                                                      0,
@@ -253,7 +334,7 @@ void gui_function_activated (GtkTreeView * treeView,
     while (gtk_events_pending())
         gtk_main_iteration();
 
-    objects_delete(rdg, gg, NULL);
+    objects_delete(rdg, blocks, NULL);
 }
 
 
@@ -263,6 +344,12 @@ int main (int argc, char * argv[])
 
     struct _gui * gui = gui_create();
 
+    // --jobs N finds functions on N threads
+    if ((argc == 3) && (strcmp(argv[1], "--jobs") == 0))
+        gui->jobs = strtoul(argv[2], NULL, 10);
+    if (gui->jobs == 0)
+        gui->jobs = 1;
+
 //    struct _buffer * buffer = buffer_load_file("/home/endeavor/hack/hdm/libc-2.3.5.so");
     struct _buffer * buffer = buffer_load_file("/home/endeavor/code/hsvm/assembler");
     if (buffer != NULL) {
@@ -33,6 +33,8 @@ struct _gui {
 
     struct _map  * memory_map;
     struct _arch * arch;
+    // threads to find functions on, set with --jobs N
+    unsigned int   jobs;
 };
 
 
@@ -0,0 +1,183 @@
+#include "intern.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <string.h>
+
+// strings are packed into blocks of this many bytes. longer strings get a
+// block of their own
+#define INTERN_BLOCK_SIZE (64 * 1024)
+
+// the table is split into 1 << INTERN_STRIPE_BITS stripes, chosen by the top
+// bits of a string's hash, each under a lock of its own
+#define INTERN_STRIPE_BITS 4
+#define INTERN_STRIPES     (1 << INTERN_STRIPE_BITS)
+
+// each thread remembers this many strings it interned, so a string seen
+// again is found without taking a lock
+#define INTERN_FRONT_SIZE 1024
+
+struct _intern_slot {
+    uint64_t     hash;
+    const char * string;
+};
+
+struct _intern_stripe {
+    pthread_mutex_t       lock;
+    struct _intern_slot * table;
+    unsigned int          bits;
+    size_t                size;
+    char                * top;
+    char                * end;
+};
+
+static pthread_once_t        intern_once = PTHREAD_ONCE_INIT;
+static struct _intern_stripe intern_stripes[INTERN_STRIPES];
+
+// direct mapped by hash. entries are only ever strings already interned,
+// which never change, so reading them needs no lock
+static __thread struct _intern_slot intern_front[INTERN_FRONT_SIZE];
+
+
+static void intern_init ()
+{
+    size_t i;
+
+    for (i = 0; i < INTERN_STRIPES; i++) {
+        pthread_mutex_init(&(intern_stripes[i].lock), NULL);
+        intern_stripes[i].table = NULL;
+        intern_stripes[i].bits  = 0;
+        intern_stripes[i].size  = 0;
+        intern_stripes[i].top   = NULL;
+        intern_stripes[i].end   = NULL;
+    }
+}
+
+
+// FNV-1a
+static uint64_t intern_hash (const char * string, size_t len)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t   i;
+
+    for (i = 0; i < len; i++) {
+        hash ^= (unsigned char) string[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+static size_t intern_slot (const struct _intern_stripe * stripe, uint64_t hash)
+{
+    return (size_t) ((hash * 0x9e3779b97f4a7c15ULL) >> (64 - stripe->bits));
+}
+
+
+static void intern_grow (struct _intern_stripe * stripe)
+{
+    struct _intern_slot * table = stripe->table;
+    size_t                slots = 0;
+    size_t                mask;
+    size_t                i, slot;
+
+    if (table != NULL)
+        slots = (size_t) 1 << stripe->bits;
+
+    stripe->bits  = (stripe->bits == 0) ? 8 : stripe->bits + 1;
+    stripe->table = calloc((size_t) 1 << stripe->bits,
+                           sizeof(struct _intern_slot));
+    mask          = ((size_t) 1 << stripe->bits) - 1;
+
+    for (i = 0; i < slots; i++) {
+        if (table[i].string == NULL)
+            continue;
+        slot = intern_slot(stripe, table[i].hash);
+        while (stripe->table[slot].string != NULL)
+            slot = (slot + 1) & mask;
+        stripe->table[slot] = table[i];
+    }
+
+    free(table);
+}
+
+
+// copies len bytes of string, and a terminator, into block storage
+static const char * intern_store (struct _intern_stripe * stripe,
+                                  const char * string,
+                                  size_t len)
+{
+    char * copy;
+
+    if (len + 1 > INTERN_BLOCK_SIZE)
+        copy = malloc(len + 1);
+    else {
+        if (    (stripe->top == NULL)
+             || ((size_t) (stripe->end - stripe->top) < len + 1)) {
+            stripe->top = malloc(INTERN_BLOCK_SIZE);
+            stripe->end = stripe->top + INTERN_BLOCK_SIZE;
+        }
+        copy = stripe->top;
+        stripe->top += len + 1;
+    }
+
+    memcpy(copy, string, len);
+    copy[len] = '\0';
+
+    return copy;
+}
+
+
+const char * intern (const char * string)
+{
+    struct _intern_stripe * stripe;
+    struct _intern_slot   * front;
+    const char            * interned;
+    uint64_t                hash;
+    size_t                  len;
+    size_t                  mask;
+    size_t                  slot;
+
+    if (string == NULL)
+        return NULL;
+
+    len   = strlen(string);
+    hash  = intern_hash(string, len);
+    front = &(intern_front[hash & (INTERN_FRONT_SIZE - 1)]);
+
+    if (    (front->string != NULL)
+         && (front->hash == hash)
+         && (strcmp(front->string, string) == 0))
+        return front->string;
+
+    pthread_once(&intern_once, intern_init);
+
+    stripe = &(intern_stripes[hash >> (64 - INTERN_STRIPE_BITS)]);
+    pthread_mutex_lock(&(stripe->lock));
+
+    if (((stripe->size + 1) * 2) > ((size_t) 1 << stripe->bits))
+        intern_grow(stripe);
+
+    mask = ((size_t) 1 << stripe->bits) - 1;
+    for (slot = intern_slot(stripe, hash);
+         stripe->table[slot].string != NULL;
+         slot = (slot + 1) & mask) {
+        if (    (stripe->table[slot].hash == hash)
+             && (strcmp(stripe->table[slot].string, string) == 0))
+            break;
+    }
+
+    if (stripe->table[slot].string == NULL) {
+        stripe->table[slot].hash   = hash;
+        stripe->table[slot].string = intern_store(stripe, string, len);
+        stripe->size++;
+    }
+    interned = stripe->table[slot].string;
+
+    pthread_mutex_unlock(&(stripe->lock));
+
+    front->hash   = hash;
+    front->string = interned;
+
+    return interned;
+}
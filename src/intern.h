@@ -0,0 +1,23 @@
+#ifndef intern_HEADER
+#define intern_HEADER
+
+/*
+* The interner keeps one copy of each distinct string. Instruction text and
+* symbol names repeat endlessly ("push ebp", "ret", ...), so objects hold
+* interned strings rather than copies of their own.
+*
+* An interned string is never freed or moved, so the pointer itself is a
+* stable handle: copying it is copying the string, and two interned strings
+* are equal exactly when their pointers are. Do not free or modify one.
+*
+* The interner is global and may be used from any number of threads. Each
+* thread finds the strings it interned recently without locking, and the
+* table behind them is striped, so threads rarely wait on each other.
+*/
+
+#include <stdlib.h>
+
+// returns the interned copy of string, or NULL if string is NULL
+const char * intern (const char * string);
+
+#endif
@@ -205,7 +205,7 @@ struct _map * elf32_memory_map (const struct _buffer * buffer)
     if (elf32_check(buffer))
         return NULL;
 
-    struct _map * mem_map = map_create();
+    struct _map * mem_map = map_create_btree();
 
     Elf32_Phdr * phdr;
     size_t i = 0;
@@ -251,9 +251,7 @@ struct _list * elf32_entries (const struct _buffer * buffer)
 
     struct _list * entries = list_create();
 
-    struct _index * index = index_create(ehdr->e_entry);
-    list_append(entries, index);
-    object_delete(index);
+    list_append_take(entries, index_create(ehdr->e_entry));
 
     size_t shdr_i;
     for (shdr_i = 0; shdr_i < ehdr->e_shnum; shdr_i++) {
@@ -262,9 +260,7 @@ struct _list * elf32_entries (const struct _buffer * buffer)
         while ((sym = elf32_sym(buffer, shdr_i, sym_i++)) != NULL) {
             if (    (ELF32_ST_TYPE(sym->st_info) == STT_FUNC)
                  && (sym->st_value != 0)) {
-                struct _index * index = index_create(sym->st_value);
-                list_append(entries, index);
-                object_delete(index);
+                list_append_take(entries, index_create(sym->st_value));
             }
         }
     }
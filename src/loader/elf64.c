@@ -204,7 +204,7 @@ struct _map * elf64_memory_map (const struct _buffer * buffer)
     if (elf64_check(buffer))
         return NULL;
 
-    struct _map * mem_map = map_create();
+    struct _map * mem_map = map_create_btree();
 
     Elf64_Phdr * phdr;
     size_t i = 0;
@@ -250,9 +250,7 @@ struct _list * elf64_entries (const struct _buffer * buffer)
 
     struct _list * entries = list_create();
 
-    struct _index * index = index_create(ehdr->e_entry);
-    list_append(entries, index);
-    object_delete(index);
+    list_append_take(entries, index_create(ehdr->e_entry));
 
     size_t shdr_i;
     for (shdr_i = 0; shdr_i < ehdr->e_shnum; shdr_i++) {
@@ -261,9 +259,7 @@ struct _list * elf64_entries (const struct _buffer * buffer)
         while ((sym = elf64_sym(buffer, shdr_i, sym_i++)) != NULL) {
             if (    (ELF64_ST_TYPE(sym->st_info) == STT_FUNC)
                  && (sym->st_value != 0)) {
-                struct _index * index = index_create(sym->st_value);
-                list_append(entries, index);
-                object_delete(index);
+                list_append_take(entries, index_create(sym->st_value));
             }
         }
     }
@@ -26,4 +26,28 @@ void objects_delete (void * first, ...)
     }
 
     va_end(ap);
-}
\ No newline at end of file
+}
+
+
+void object_release (void * object)
+{
+    struct _object_header * header = object;
+
+    if (__atomic_sub_fetch(&(header->refs), 1, __ATOMIC_ACQ_REL) == 0)
+        header->object->delete(object);
+}
+
+
+
+void * object_cow (void * object)
+{
+    void * copy;
+
+    if (object_shared(object) == 0)
+        return object;
+
+    copy = object_copy(object);
+    object_release(object);
+
+    return copy;
+}
@@ -1,6 +1,20 @@
 #ifndef object_HEADER
 #define object_HEADER
 
+/*
+* Every object begins with a pointer to its vtable followed by a reference
+* count. Containers retain the objects given to them instead of copying them,
+* so one object may be held by several containers at once. object_delete
+* drops a reference and only calls the vtable delete when the last one goes.
+*
+* Shared objects must not be modified in place. Call object_cow before
+* writing to an object you did not create yourself.
+*
+* Reference counts are atomic, so threads may retain and release an object
+* they share, such as an instruction from a shared _ins_cache, without a
+* lock. Nothing else about an object is made thread-safe by this.
+*/
+
 struct _object {
     void     (* delete)      (void *);
     void *   (* copy)        (const void *);
@@ -9,18 +23,42 @@ struct _object {
 };
 
 struct _object_header {
-    struct _object * object;
+    const struct _object * object;
+    unsigned int           refs;
 };
 
 #define object_delete(XYX) \
-    ((struct _object_header *) XYX)->object->delete(XYX)
+    object_release(XYX)
 #define object_copy(XYX) \
     ((struct _object_header *) XYX)->object->copy(XYX)
 #define object_cmp(XYX, YXY) \
     (((struct _object_header *) XYX)->object->cmp(XYX, YXY))
 #define object_merge(XYX, YXY) \
     (((struct _object_header *) XYX)->object->merge(XYX, YXY))
+#define object_shared(XYX) \
+    (__atomic_load_n(&(((struct _object_header *) XYX)->refs), \
+                     __ATOMIC_ACQUIRE) > 1)
+
+void   objects_delete (void * first, ...);
+
+// adds a reference to object and returns it. const objects may be retained,
+// as the reference count is not part of an object's value. retaining does
+// not make a shared object writable, see object_cow
+static inline void * object_retain (const void * object)
+{
+    struct _object_header * header = (struct _object_header *) object;
+
+    __atomic_add_fetch(&(header->refs), 1, __ATOMIC_RELAXED);
+
+    return header;
+}
+
+// drops a reference to object, deleting it when no references remain
+void   object_release (void * object);
 
-void objects_delete (void * first, ...);
+// copy-on-write. if the caller holds the only reference to object, object is
+// returned. otherwise the caller's reference is released and a private copy
+// is returned in its place
+void * object_cow     (void * object);
 
-#endif
\ No newline at end of file
+#endif
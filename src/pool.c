@@ -0,0 +1,198 @@
+#include "pool.h"
+
+#include <string.h>
+
+// a deque starts with room for this many tasks
+#define POOL_DEQUE_MIN 64
+
+static const struct _object pool_object = {
+    (void   (*) (void *)) pool_delete,
+    NULL,
+    NULL,
+    NULL
+};
+
+struct _pool_worker {
+    struct _pool * pool;
+    unsigned int   index;
+    pthread_t      thread;
+};
+
+
+struct _pool * pool_create (unsigned int workers,
+                            pool_task_f task,
+                            void * data)
+{
+    struct _pool * pool;
+    unsigned int   i;
+
+    // shared by every worker, so it does not come from an arena
+    pool = (struct _pool *) malloc(sizeof(struct _pool));
+    pool->object  = &pool_object;
+    pool->refs    = 1;
+    pool->workers = workers;
+    pool->task    = task;
+    pool->data    = data;
+    pool->pending = 0;
+    pool->deques  = malloc(sizeof(struct _pool_deque) * workers);
+    pthread_mutex_init(&(pool->idle_lock), NULL);
+    pthread_cond_init(&(pool->idle), NULL);
+
+    for (i = 0; i < workers; i++) {
+        pthread_mutex_init(&(pool->deques[i].lock), NULL);
+        pool->deques[i].front    = 0;
+        pool->deques[i].back     = 0;
+        pool->deques[i].capacity = POOL_DEQUE_MIN;
+        pool->deques[i].tasks    = malloc(sizeof(uint64_t) * POOL_DEQUE_MIN);
+    }
+
+    return pool;
+}
+
+
+
+void pool_delete (struct _pool * pool)
+{
+    unsigned int i;
+
+    for (i = 0; i < pool->workers; i++) {
+        pthread_mutex_destroy(&(pool->deques[i].lock));
+        free(pool->deques[i].tasks);
+    }
+    free(pool->deques);
+    pthread_cond_destroy(&(pool->idle));
+    pthread_mutex_destroy(&(pool->idle_lock));
+    free(pool);
+}
+
+
+
+void pool_push (struct _pool * pool, unsigned int worker, uint64_t task)
+{
+    struct _pool_deque * deque = &(pool->deques[worker]);
+    size_t size;
+
+    // counted before it can be stolen, so pending never drops to 0 early
+    __atomic_add_fetch(&(pool->pending), 1, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_lock(&(deque->lock));
+
+    if (deque->back == deque->capacity) {
+        size = deque->back - deque->front;
+        // slide the tasks down over those stolen, unless that frees too
+        // little room
+        if (size * 2 > deque->capacity) {
+            deque->capacity *= 2;
+            deque->tasks = realloc(deque->tasks,
+                                   sizeof(uint64_t) * deque->capacity);
+        }
+        memmove(deque->tasks,
+                &(deque->tasks[deque->front]),
+                sizeof(uint64_t) * size);
+        deque->front = 0;
+        deque->back  = size;
+    }
+
+    deque->tasks[deque->back++] = task;
+
+    pthread_mutex_unlock(&(deque->lock));
+
+    // idle workers look for tasks under idle_lock, so this can not slip in
+    // between a look and a wait
+    pthread_mutex_lock(&(pool->idle_lock));
+    pthread_cond_signal(&(pool->idle));
+    pthread_mutex_unlock(&(pool->idle_lock));
+}
+
+
+
+// takes the newest task from worker's own deque, or else the oldest from
+// another's. returns 0 when every deque is empty
+static int pool_take (struct _pool * pool, unsigned int worker, uint64_t * task)
+{
+    struct _pool_deque * deque = &(pool->deques[worker]);
+    unsigned int i;
+
+    pthread_mutex_lock(&(deque->lock));
+    if (deque->back > deque->front) {
+        *task = deque->tasks[--deque->back];
+        pthread_mutex_unlock(&(deque->lock));
+        return 1;
+    }
+    pthread_mutex_unlock(&(deque->lock));
+
+    // victims are tried starting after worker, so thieves spread out
+    for (i = 1; i < pool->workers; i++) {
+        deque = &(pool->deques[(worker + i) % pool->workers]);
+        pthread_mutex_lock(&(deque->lock));
+        if (deque->back > deque->front) {
+            *task = deque->tasks[deque->front++];
+            pthread_mutex_unlock(&(deque->lock));
+            return 1;
+        }
+        pthread_mutex_unlock(&(deque->lock));
+    }
+
+    return 0;
+}
+
+
+
+static void * pool_work (void * arg)
+{
+    struct _pool_worker * worker = arg;
+    struct _pool        * pool   = worker->pool;
+    uint64_t task;
+    int      took;
+
+    while (1) {
+        took = pool_take(pool, worker->index, &task);
+
+        // nothing to take, but a running task may still push more, so wait
+        // for a push or for the last task to finish
+        if (! took) {
+            pthread_mutex_lock(&(pool->idle_lock));
+            while (    (__atomic_load_n(&(pool->pending), __ATOMIC_SEQ_CST) > 0)
+                    && ! (took = pool_take(pool, worker->index, &task)))
+                pthread_cond_wait(&(pool->idle), &(pool->idle_lock));
+            pthread_mutex_unlock(&(pool->idle_lock));
+        }
+
+        if (! took)
+            break;
+
+        pool->task(pool, worker->index, task, pool->data);
+
+        if (__atomic_sub_fetch(&(pool->pending), 1, __ATOMIC_SEQ_CST) == 0) {
+            pthread_mutex_lock(&(pool->idle_lock));
+            pthread_cond_broadcast(&(pool->idle));
+            pthread_mutex_unlock(&(pool->idle_lock));
+        }
+    }
+
+    return NULL;
+}
+
+
+
+void pool_run (struct _pool * pool)
+{
+    struct _pool_worker * workers;
+    unsigned int i;
+
+    workers = malloc(sizeof(struct _pool_worker) * pool->workers);
+    for (i = 0; i < pool->workers; i++) {
+        workers[i].pool  = pool;
+        workers[i].index = i;
+    }
+
+    for (i = 1; i < pool->workers; i++)
+        pthread_create(&(workers[i].thread), NULL, pool_work, &(workers[i]));
+
+    pool_work(&(workers[0]));
+
+    for (i = 1; i < pool->workers; i++)
+        pthread_join(workers[i].thread, NULL);
+
+    free(workers);
+}
@@ -0,0 +1,72 @@
+#ifndef pool_HEADER
+#define pool_HEADER
+
+/*
+* A pool of threads working through tasks, each named by a uint64_t, which
+* may push more tasks as they run.
+*
+* Every worker keeps a deque of tasks. A worker pushes and takes tasks at
+* the back of its own deque, so it works depth first through what it finds,
+* and when its deque is empty it steals from the front of another worker's,
+* taking the oldest task there. Workers only meet on the deque they steal
+* from. A worker with nothing to steal sleeps until a task is pushed, or
+* until the last task has finished.
+*
+* Tasks run in no particular order, and on no particular thread. Anything
+* the task function shares between tasks must be locked.
+*/
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "object.h"
+
+struct _pool;
+
+// worker is the index, below pool->workers, of the worker running task
+typedef void (* pool_task_f) (struct _pool * pool,
+                              unsigned int worker,
+                              uint64_t task,
+                              void * data);
+
+struct _pool_deque {
+    pthread_mutex_t lock;
+    // tasks run from tasks[front] up to tasks[back]
+    size_t          front;
+    size_t          back;
+    size_t          capacity;
+    uint64_t      * tasks;
+};
+
+struct _pool {
+    const struct _object * object;
+    unsigned int           refs;
+    unsigned int           workers;
+    pool_task_f            task;
+    void                 * data;
+    // tasks pushed which have not finished running. workers stop once it
+    // is 0, as then no task is left to push more
+    size_t                 pending;
+    struct _pool_deque   * deques;
+    // idle workers wait on idle, which is signalled by each push and
+    // broadcast when pending reaches 0
+    pthread_mutex_t        idle_lock;
+    pthread_cond_t         idle;
+};
+
+
+// a pool of workers threads, which must be at least 1
+struct _pool * pool_create (unsigned int workers,
+                            pool_task_f task,
+                            void * data);
+void           pool_delete (struct _pool * pool);
+
+// adds task to worker's deque. a task pushes to the worker running it
+void pool_push (struct _pool * pool, unsigned int worker, uint64_t task);
+
+// runs tasks until every task pushed, before or during the run, has
+// finished. worker 0 is the calling thread
+void pool_run  (struct _pool * pool);
+
+#endif
@@ -1,6 +1,7 @@
 #include "rdg.h"
 
 #include "graph.h"
+#include "graph_walk.h"
 #include "instruction.h"
 #include "list.h"
 #include "queue.h"
@@ -28,12 +29,13 @@ static const struct _object rdg_node_color_object = {
 
 
 void rdg_debug (struct _rdg * rdg) {
-    struct _graph_it * graph_it;
+    struct _graph_iter   git;
+    struct _graph_node * node;
 
-    for (graph_it = graph_iterator(rdg->graph);
-         graph_it != NULL;
-         graph_it = graph_it_next(graph_it)) {
-        struct _rdg_node * rdg_node = graph_it_data(graph_it);
+    for (node = graph_iter_first(&git, rdg->graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        struct _rdg_node * rdg_node = node->data;
         printf("index: %llx, level: %d, position: %f, flags: %d, x: %d, y: %d\n",
                (unsigned long long) rdg_node->index,
                rdg_node->level,
@@ -45,66 +47,81 @@ void rdg_debug (struct _rdg * rdg) {
 }
 
 
-struct _rdg * rdg_create (uint64_t        top_index,
-                          struct _graph * graph)
+struct _rdg * rdg_create (uint64_t               top_index,
+                          const struct _fgraph * graph)
 {
     struct _rdg * rdg;
 
     rdg = (struct _rdg *) malloc(sizeof(struct _rdg));
     rdg->object      = &rdg_object;
+    rdg->refs        = 1;
     rdg->surface     = NULL;
     rdg->top_index   = top_index;
     rdg->graph       = graph_create();
     rdg->levels      = NULL;
+    rdg->arena       = arena_create();
     rdg->width       = 0;
     rdg->height      = 0;
 
+    struct _arena * previous = arena_bind(rdg->arena);
+
     // add nodes to rdg->graph and acyclic graph
     struct _graph * acyclic_graph = graph_create();
-    struct _graph_it * graph_it;
-    for (graph_it = graph_iterator(graph);
-         graph_it != NULL;
-         graph_it = graph_it_next(graph_it)) {
-        struct _graph_node * node = graph_it_node(graph_it);
-
+    size_t i, j;
+    for (i = 0; i < graph->size; i++) {
+        const struct _fgraph_node * node = &(graph->nodes[i]);
         cairo_surface_t * surface;
         surface = rdg_node_draw(node);
-        struct _rdg_node * rdg_node = rdg_node_create(node->index, surface);
-        graph_add_node(rdg->graph, node->index, rdg_node);
-        object_delete(rdg_node);
+        graph_add_node_take(rdg->graph,
+                            node->index,
+                            rdg_node_create(node->index, surface));
         cairo_surface_destroy(surface);
 
-        rdg_node = rdg_node_create(node->index, NULL);
-        graph_add_node(acyclic_graph, node->index, rdg_node);
-        object_delete(rdg_node);
+        graph_add_node_take(acyclic_graph,
+                            node->index,
+                            rdg_node_create(node->index, NULL));
     }
 
-    // add edges
-    for (graph_it = graph_iterator(graph);
-         graph_it != NULL;
-         graph_it = graph_it_next(graph_it)) {
-        struct _graph_node * node = graph_it_node(graph_it);
+    // add edges. each edge is added when the lower of its two nodes is
+    // reached, which decides the order of every node's edge list, and so
+    // the order the layout visits them in
+    for (i = 0; i < graph->size; i++) {
+        const struct _fgraph_edge * edges;
+        uint64_t index = graph->nodes[i].index;
 
-        struct _list_it * list_it;
-        for (list_it = list_iterator(node->edges);
-             list_it != NULL;
-             list_it = list_it->next) {
-            struct _graph_edge * edge = list_it->data;
+        edges = fgraph_successors(graph, i);
+        for (j = 0; j < fgraph_successors_n(graph, i); j++) {
+            if (edges[j].node < i)
+                continue;
+            uint64_t tail = graph->nodes[edges[j].node].index;
+            graph_add_edge(rdg->graph,    index, tail, edges[j].data);
+            graph_add_edge(acyclic_graph, index, tail, edges[j].data);
+        }
 
-            graph_add_edge(rdg->graph, edge->head, edge->tail, edge->data);
-            graph_add_edge(acyclic_graph, edge->head, edge->tail, edge->data);
+        edges = fgraph_predecessors(graph, i);
+        for (j = 0; j < fgraph_predecessors_n(graph, i); j++) {
+            if (edges[j].node <= i)
+                continue;
+            uint64_t head = graph->nodes[edges[j].node].index;
+            graph_add_edge(rdg->graph,    head, index, edges[j].data);
+            graph_add_edge(acyclic_graph, head, index, edges[j].data);
         }
     }
 
-    rdg_acyclicize(acyclic_graph, top_index);
-    rdg_acyclicize_pre(acyclic_graph, top_index);
+    // the second pass carries on from the nodes the first reached
+    struct _graph_walk * walk = graph_walk_create(acyclic_graph);
+    rdg_acyclicize(acyclic_graph, walk, top_index);
+    rdg_acyclicize_pre(acyclic_graph, walk, top_index);
+    object_delete(walk);
     rdg_assign_levels(acyclic_graph, top_index);
     
     // copy over levels
-    for (graph_it = graph_iterator(acyclic_graph);
-         graph_it != NULL;
-         graph_it = graph_it_next(graph_it)) {
-        struct _rdg_node * rdg_acyclic_node = graph_it_data(graph_it);
+    struct _graph_iter   git;
+    struct _graph_node * node;
+    for (node = graph_iter_first(&git, acyclic_graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        struct _rdg_node * rdg_acyclic_node = node->data;
         struct _rdg_node * rdg_node = graph_fetch_data(rdg->graph, rdg_acyclic_node->index);
         rdg_node->level = rdg_acyclic_node->level;
     }
@@ -119,6 +136,8 @@ struct _rdg * rdg_create (uint64_t        top_index,
 
     rdg_reduce_and_draw (rdg);
 
+    arena_bind(previous);
+
     return rdg;
 }
 
@@ -132,6 +151,7 @@ void rdg_delete (struct _rdg * rdg)
         object_delete(rdg->levels);
 
     object_delete(rdg->graph);
+    object_delete(rdg->arena);
     free(rdg);
 }
 
@@ -143,6 +163,10 @@ struct _rdg * rdg_copy (const struct _rdg * rdg)
     new_rdg = (struct _rdg *) malloc(sizeof(struct _rdg));
 
     new_rdg->object = &rdg_object;
+    new_rdg->refs = 1;
+    new_rdg->arena = arena_create();
+
+    struct _arena * previous = arena_bind(new_rdg->arena);
     if (rdg->surface == NULL)
         new_rdg->surface = NULL;
     else
@@ -150,7 +174,19 @@ struct _rdg * rdg_copy (const struct _rdg * rdg)
     
     new_rdg->top_index = rdg->top_index;
     new_rdg->graph = object_copy(rdg->graph);
+
+    // layout writes to rdg_nodes in place, so the copy needs its own instead
+    // of sharing ours
+    struct _graph_iter   git;
+    struct _graph_node * node;
+    for (node = graph_iter_first(&git, new_rdg->graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        node->data = object_cow(node->data);
+    }
     
+    // level maps are persistent, and only ever changed through
+    // map_fetch_writable, so the copy shares them until one of us does
     if (rdg->levels != NULL)
         new_rdg->levels = object_copy(rdg->levels);
     else
@@ -159,6 +195,8 @@ struct _rdg * rdg_copy (const struct _rdg * rdg)
     new_rdg->width  = rdg->width;
     new_rdg->height = rdg->height;
 
+    arena_bind(previous);
+
     return new_rdg;
 }
 
@@ -206,7 +244,7 @@ int rdg_node_y (struct _rdg * rdg, uint64_t index)
 
 
 void rdg_color_nodes (struct _rdg * rdg,
-                      struct _graph     * ins_graph,
+                      const struct _fgraph * ins_graph,
                       struct _list * node_color_list)
 {
     rdg_custom_nodes(rdg, ins_graph, node_color_list, -1);
@@ -214,7 +252,7 @@ void rdg_color_nodes (struct _rdg * rdg,
 
 
 void rdg_custom_nodes (struct _rdg * rdg,
-                       struct _graph     * ins_graph,
+                       const struct _fgraph * ins_graph,
                        struct _list * node_color_list,
                        uint64_t highlight_ins)
 {
@@ -225,11 +263,11 @@ void rdg_custom_nodes (struct _rdg * rdg,
     for (it = list_iterator(node_color_list); it != NULL; it = it->next) {
         struct _rdg_node_color * rdg_node_color = it->data;
 
-        struct _rdg_node   * rdg_node;
-        struct _graph_node * ins_node;
+        struct _rdg_node * rdg_node;
+        size_t             ins_node;
 
-        ins_node = graph_fetch_node(ins_graph, rdg_node_color->index);
-        if (ins_node == NULL)
+        ins_node = fgraph_find(ins_graph, rdg_node_color->index);
+        if (ins_node == FGRAPH_NONE)
             continue;
 
         rdg_node = graph_fetch_data(rdg->graph, rdg_node_color->index);
@@ -242,7 +280,7 @@ void rdg_custom_nodes (struct _rdg * rdg,
         if (rdg_node->surface != NULL)
             cairo_surface_destroy(rdg_node->surface);
 
-        rdg_node->surface = rdg_node_draw_full(ins_node,
+        rdg_node->surface = rdg_node_draw_full(&(ins_graph->nodes[ins_node]),
                                                rdg_node_color->red,
                                                rdg_node_color->blue,
                                                rdg_node_color->green,
@@ -262,6 +300,7 @@ struct _rdg_node_color * rdg_node_color_create (uint64_t index,
                                         malloc(sizeof(struct _rdg_node_color));
 
     rdg_node_color->object = &rdg_node_color_object;
+    rdg_node_color->refs   = 1;
     rdg_node_color->index  = index;
     rdg_node_color->red    = red;
     rdg_node_color->green  = green;
@@ -299,12 +338,13 @@ int rdg_node_color_cmp (const struct _rdg_node_color * lhs,
 
 uint64_t rdg_get_node_by_coords (struct _rdg * rdg, int x, int y)
 {
-    struct _graph_it * it;
+    struct _graph_iter   git;
+    struct _graph_node * node;
 
-    for (it = graph_iterator(rdg->graph);
-         it != NULL;
-         it = graph_it_next(it)) {
-        struct _rdg_node * rdg_node = graph_it_data(it);
+    for (node = graph_iter_first(&git, rdg->graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        struct _rdg_node * rdg_node = node->data;
 
         if (    (rdg_node->x + RDG_SURFACE_PADDING < x)
              && (rdg_node->x + RDG_SURFACE_PADDING + rdg_node_width(rdg_node) > x)
@@ -317,17 +357,17 @@ uint64_t rdg_get_node_by_coords (struct _rdg * rdg, int x, int y)
 }
 
 
-uint64_t rdg_get_ins_by_coords (struct _rdg   * rdg,
-                                struct _graph * ins_graph,
-                                struct _map   * labels,
+uint64_t rdg_get_ins_by_coords (struct _rdg          * rdg,
+                                const struct _fgraph * ins_graph,
+                                struct _map          * labels,
                                 int x, int y)
 {
     uint64_t node_index = rdg_get_node_by_coords(rdg, x, y);
     if (node_index == -1)
         return -1;
 
-    struct _graph_node * node = graph_fetch_node(ins_graph, node_index);
-    if (node == NULL)
+    size_t node = fgraph_find(ins_graph, node_index);
+    if (node == FGRAPH_NONE)
         return -1;
 
     struct _rdg_node * rdg_node = graph_fetch_data(rdg->graph, node_index);
@@ -352,11 +392,12 @@ uint64_t rdg_get_ins_by_coords (struct _rdg   * rdg,
     if (map_fetch(labels, rdg_node->index) != NULL)
         bottom += fe.height + 2.0;
 
-    struct _list_it * it;
-    for (it = list_iterator(node->data); it != NULL; it = it->next) {
+    struct _vector * block = ins_graph->nodes[node].data;
+    size_t i;
+    for (i = 0; i < block->size; i++) {
         double top = bottom + fe.height;
         if (((double) y >= bottom) && ((double) y <= top)) {
-            struct _ins * ins = it->data;
+            struct _ins * ins = block->items[i];
             return ins->address;
         }
         bottom = top + 2.0;
@@ -445,7 +486,22 @@ int rdg_node_sink_y (struct _rdg * rdg,
 * Code to Acyclicize the graph                  *
 ************************************************/
 
-void rdg_acyclicize (struct _graph * graph, uint64_t index)
+// queues every edge the walk does not follow to a new node. the graph must
+// not change until the walk is done
+static void rdg_acyclicize_edge (struct _graph_edge * edge, int type, void * queue)
+{
+    if (type != GRAPH_WALK_TREE)
+        queue_push(queue, edge);
+}
+
+
+// walks from index in direction, removing every edge that leads to a node
+// already reached. if an earlier pass reached index, this pass picks up from
+// index's edges, so only the nodes that pass missed are walked
+static void rdg_acyclicize_walk (struct _graph      * graph,
+                                 struct _graph_walk * walk,
+                                 uint64_t             index,
+                                 int                  direction)
 {
     struct _graph_node * node = graph_fetch_node(graph, index);
     if (node == NULL) {
@@ -453,24 +509,26 @@ void rdg_acyclicize (struct _graph * graph, uint64_t index)
                (unsigned long long) index);
         return;
     }
-    struct _rdg_node * rdg_node = node->data;
     struct _queue * queue = queue_create();
 
-    rdg_node->flags |= RDG_NODE_ACYCLIC;
-
-    struct _list_it * it;
-    struct _list * successors = graph_node_successors(node);
-    for (it = list_iterator(successors); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
-
-        struct _rdg_node * rdg_suc_node;
-        rdg_suc_node = graph_fetch_data(graph, edge->tail);
-        if (rdg_suc_node->flags & RDG_NODE_ACYCLIC)
-            queue_push(queue, edge);
-        else
-            rdg_acyclicize(graph, edge->tail);
+    if (! graph_walk_marked(walk, node))
+        graph_walk_dfs(walk, index, direction,
+                       NULL, NULL, rdg_acyclicize_edge, queue);
+    else {
+        struct _graph_edge_iter eit;
+        struct _graph_edge    * edge;
+        for (edge = graph_edge_iter_first(&eit, node, direction);
+             edge != NULL;
+             edge = graph_edge_iter_next(&eit)) {
+            uint64_t next = (direction == GRAPH_SUCCESSORS) ? edge->tail
+                                                            : edge->head;
+            if (graph_walk_marked(walk, graph_fetch_node(graph, next)))
+                queue_push(queue, edge);
+            else
+                graph_walk_dfs(walk, next, direction,
+                               NULL, NULL, rdg_acyclicize_edge, queue);
+        }
     }
-    object_delete(successors);
 
     while (queue->size > 0) {
         struct _graph_edge * edge = queue_peek(queue);
@@ -482,45 +540,19 @@ void rdg_acyclicize (struct _graph * graph, uint64_t index)
 }
 
 
-void rdg_acyclicize_pre (struct _graph * graph, uint64_t index)
+void rdg_acyclicize (struct _graph      * graph,
+                     struct _graph_walk * walk,
+                     uint64_t             index)
 {
-    struct _graph_node * node = graph_fetch_node(graph, index);
-    if (node == NULL) {
-        printf("acyclicize NULL node error, index: %llx\n",
-               (unsigned long long) index);
-        return;
-    }
-    struct _rdg_node * rdg_node = node->data;
-    struct _queue * queue = queue_create();
-
-    // mark this node with acyclic flag
-    rdg_node->flags |= RDG_NODE_ACYCLIC;
-
-    struct _list_it * it;
-    struct _list * predecessors = graph_node_predecessors(node);
-    for (it = list_iterator(predecessors); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
-
-        struct _rdg_node * rdg_suc_node;
-        // get predecessor node
-        rdg_suc_node = graph_fetch_data(graph, edge->head);
-        // if this node is acyclic
-        if (rdg_suc_node->flags & RDG_NODE_ACYCLIC)
-            // mark this edge for deletion
-            queue_push(queue, edge);
-        else
-            // otherwise, perform recursive call on this node
-            rdg_acyclicize_pre(graph, edge->head);
-    }
-    object_delete(predecessors);
+    rdg_acyclicize_walk(graph, walk, index, GRAPH_SUCCESSORS);
+}
 
-    while (queue->size > 0) {
-        struct _graph_edge * edge = queue_peek(queue);
-        graph_remove_edge(graph, edge->head, edge->tail);
-        queue_pop(queue);
-    }
 
-    object_delete(queue);
+void rdg_acyclicize_pre (struct _graph      * graph,
+                         struct _graph_walk * walk,
+                         uint64_t             index)
+{
+    rdg_acyclicize_walk(graph, walk, index, GRAPH_PREDECESSORS);
 }
 
 
@@ -544,88 +576,57 @@ int rdg_predecessors_level (struct _graph * graph, uint64_t index)
     if (node == NULL)
         return -2;
 
-    struct _list * predecessors = graph_node_predecessors(node);
-    struct _list_it * lit;
-    for (lit = list_iterator(predecessors); lit != NULL; lit = lit->next) {
-        struct _graph_edge * edge = lit->data;
+    struct _graph_edge_iter eit;
+    struct _graph_edge    * edge;
+    for (edge = graph_predecessors_first(&eit, node);
+         edge != NULL;
+         edge = graph_edge_iter_next(&eit)) {
         struct _rdg_node * rdg_node = graph_fetch_data(graph, edge->head);
-        if (rdg_node->level == -1) {
-            object_delete(predecessors);
+        if (rdg_node->level == -1)
             return -1;
-        }
         if (rdg_node->level > highest_level)
             highest_level = rdg_node->level;
     }
 
-    object_delete(predecessors);
     return highest_level;
 }
 
 
+// a node's level is one more than the highest level of its predecessors.
+// graph is acyclic, so in reverse post-order every node comes after all of
+// its predecessors, and one pass assigns every level
 void rdg_assign_levels (struct _graph * graph, uint64_t start)
 {
     graph_map(graph, rdg_node_level_init);
 
-    struct _queue * queue = queue_create();
-
-    // we manually do first node
-    struct _rdg_node * rdg_node = graph_fetch_data(graph, start);
-    rdg_node->level = 0;
-    struct _list * successors = graph_node_successors(graph_fetch_node(graph, start));
-    struct _list_it * lit;
-    for (lit = list_iterator(successors); lit != NULL; lit = lit->next) {
-        struct _graph_edge * edge = lit->data;
-        struct _index * index = index_create(edge->tail);
-        queue_push(queue, index);
-        object_delete(index);
+    if (graph_fetch_node(graph, start) == NULL) {
+        printf("ruh roh bad stuff in gl_assign_layers\n");
+        return;
     }
-    object_delete(successors);
 
-    while (queue->size > 0) {
-        struct _index * index = queue_peek(queue);
+    struct _graph_walk  * walk  = graph_walk_create(graph);
+    struct _graph_node ** order = mem_alloc(sizeof(struct _graph_node *)
+                                            * graph->size);
+    size_t n = graph_walk_rpo(walk, start, GRAPH_SUCCESSORS, order);
 
-        struct _rdg_node * rdg_node = graph_fetch_data(graph, index->index);
+    // we manually do first node
+    struct _rdg_node * rdg_node = order[0]->data;
+    rdg_node->level = 0;
 
-        // this node already has its level assigned
-        if (rdg_node->level != -1) {
-            queue_pop(queue);
-            continue;
-        }
+    size_t i;
+    for (i = 1; i < n; i++) {
+        rdg_node = order[i]->data;
 
-        int predecessors_level = rdg_predecessors_level(graph, index->index);
-        if (predecessors_level == -1) {
-            // push this back on the queue to do again later
-            printf("hi\n");
-            queue_pop(queue);
-            queue_push(queue, index);
-            continue;
-        }
-        // ruh roh
-        if (predecessors_level == -2) {
-            printf("ruh roh bad stuff in gl_assign_layers\n");
-            queue_pop(queue);
+        // -1 when a predecessor is not reachable from start
+        int predecessors_level = rdg_predecessors_level(graph, order[i]->index);
+        if (predecessors_level < 0)
             continue;
-        }
 
-        printf("predecessors_level: %llx %d\n",
-               (unsigned long long) rdg_node->index, predecessors_level);
         rdg_node->level = predecessors_level + 1;
-
-        struct _list * successors = graph_node_successors(graph_fetch_node(graph, index->index));
-        struct _list_it * lit;
-        for (lit = list_iterator(successors); lit != NULL; lit = lit->next) {
-            struct _graph_edge * edge = lit->data;
-            struct _index * index = index_create(edge->tail);
-            queue_push(queue, index);
-            object_delete(index);
-        }
-
-        object_delete(successors);
-
-        queue_pop(queue);
     }
 
-    object_delete(queue);
+    mem_free(order);
+    object_delete(walk);
 }
 
 
@@ -634,27 +635,26 @@ void rdg_assign_level_map (struct _rdg * rdg)
     if (rdg->levels != NULL)
         object_delete(rdg->levels);
 
-    rdg->levels = map_create();
+    rdg->levels = map_create_persistent();
 
-    struct _graph_it * graph_it;
+    struct _graph_iter   git;
+    struct _graph_node * node;
     // for each node in the graph
-    for (graph_it = graph_iterator(rdg->graph);
-         graph_it != NULL;
-         graph_it = graph_it_next(graph_it)) {
-        struct _rdg_node * rdg_node = graph_it_data(graph_it);
+    for (node = graph_iter_first(&git, rdg->graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        struct _rdg_node * rdg_node = node->data;
 
         // if this level does not exist, create it
         if (map_fetch(rdg->levels, rdg_node->level) == NULL) {
-            struct _map * new_level_map = map_create();
-            map_insert(rdg->levels, rdg_node->level, new_level_map);
-            object_delete(new_level_map);
+            map_insert_take(rdg->levels, rdg_node->level, map_create_persistent());
         }
 
         // insert this node's index into it's level's map
         struct _map * level_map = map_fetch(rdg->levels, rdg_node->level);
-        struct _index * index = index_create(rdg_node->index);
-        map_insert(level_map, level_map->size, index);
-        object_delete(index);
+        map_insert_take(level_map,
+                        level_map->size,
+                        index_create(rdg_node->index));
     }
 }
 
@@ -673,11 +673,10 @@ void rdg_create_virtual_nodes (struct _rdg * rdg)
     uint64_t virtual_index = 0;
 
     // for each node in the graph
-    struct _graph_it * graph_it;
-    for (graph_it = graph_iterator(rdg->graph);
-         graph_it != NULL;
-         graph_it = graph_it_next(graph_it)) {
-         node = graph_it_node(graph_it);
+    struct _graph_iter git;
+    for (node = graph_iter_first(&git, rdg->graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
         // add it to the queue
         queue_push(queue, node);
 
@@ -694,13 +693,11 @@ void rdg_create_virtual_nodes (struct _rdg * rdg)
 
         struct _rdg_node * rdg_head = node->data;
 
-        // for each successor
-        struct _list * successors = graph_node_successors(node);
-        struct _list_it * list_it;
-        for (list_it = list_iterator(successors);
-             list_it != NULL;
-             list_it = list_it->next) {
-            struct _graph_edge * edge = list_it->data;
+        // for each successor. a snapshot, as edges are replaced as we go
+        struct _vector * successors = graph_node_successors(node);
+        size_t suc_i;
+        for (suc_i = 0; suc_i < successors->size; suc_i++) {
+            struct _graph_edge * edge = successors->items[suc_i];
             struct _graph_node * successor;
             successor = graph_fetch_node(rdg->graph, edge->tail);
 
@@ -730,7 +727,7 @@ void rdg_create_virtual_nodes (struct _rdg * rdg)
                 virtual->flags |= RDG_NODE_VIRTUAL | RDG_NODE_LEVEL_SET;
                 virtual->level = i;
                 // add it
-                graph_add_node(rdg->graph, virtual_index, virtual);
+                graph_add_node_take(rdg->graph, virtual_index, virtual);
                 // add edge to its parent
                 graph_add_edge(rdg->graph,
                                head_index,
@@ -738,8 +735,6 @@ void rdg_create_virtual_nodes (struct _rdg * rdg)
                                edge->data);
                 head_index = virtual_index;
                 virtual_index++;
-                // clean up virtual node
-                object_delete(virtual);
             }
 
             // add final edge from last virtual node to successor
@@ -762,9 +757,12 @@ void rdg_remove_virtual_nodes (struct _rdg * rdg)
     struct _queue * queue = queue_create();
 
     // for each node
-    struct _graph_it * it;
-    for (it = graph_iterator(rdg->graph); it != NULL; it = graph_it_next(it)) {
-        struct _rdg_node * rdg_node = graph_it_data(it);
+    struct _graph_iter   git;
+    struct _graph_node * node;
+    for (node = graph_iter_first(&git, rdg->graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        struct _rdg_node * rdg_node = node->data;
 
         // if this node is virtual, add it to the queue for removal
         if (rdg_node->flags & RDG_NODE_VIRTUAL)
@@ -786,9 +784,9 @@ void rdg_remove_virtual_nodes (struct _rdg * rdg)
         }
         uint64_t successor_index = -1;
         uint64_t predecessor_index = -1;
-        struct _list_it * eit;
-        for (eit = list_iterator(node->edges); eit != NULL; eit = eit->next) {
-            struct _graph_edge * edge = eit->data;
+        size_t i;
+        for (i = 0; i < node->edges->size; i++) {
+            struct _graph_edge * edge = node->edges->items[i];
             if (edge->head == node->index)
                 successor_index = edge->tail;
             else
@@ -958,9 +956,9 @@ void rdg_assign_x (struct _rdg * rdg)
 
             int above_sum = 0;
             int above_n   = 0;
-            struct _list_it * eit;
-            for (eit = list_iterator(node->edges); eit != NULL; eit = eit->next) {
-                struct _graph_edge * edge = eit->data;
+            size_t ei;
+            for (ei = 0; ei < node->edges->size; ei++) {
+                struct _graph_edge * edge = node->edges->items[ei];
                 struct _rdg_node * neighbor;
                 if (edge->head == node->index)
                     neighbor = graph_fetch_data(rdg->graph, edge->tail);
@@ -996,9 +994,9 @@ void rdg_assign_x (struct _rdg * rdg)
 
             int below_sum = 0;
             int below_n   = 0;
-            struct _list_it * eit;
-            for (eit = list_iterator(node->edges); eit != NULL; eit = eit->next) {
-                struct _graph_edge * edge = eit->data;
+            size_t ei;
+            for (ei = 0; ei < node->edges->size; ei++) {
+                struct _graph_edge * edge = node->edges->items[ei];
                 struct _rdg_node * neighbor;
                 if (edge->head == node->index)
                     neighbor = graph_fetch_data(rdg->graph, edge->tail);
@@ -1021,15 +1019,20 @@ void rdg_assign_x (struct _rdg * rdg)
     }
 
     int least_x = 1000000;
-    struct _graph_it * it;
-    for (it = graph_iterator(rdg->graph); it != NULL; it = graph_it_next(it)) {
-        struct _rdg_node * rdg_node = graph_it_data(it);
+    struct _graph_iter   git;
+    struct _graph_node * node;
+    for (node = graph_iter_first(&git, rdg->graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        struct _rdg_node * rdg_node = node->data;
         if (rdg_node->x < least_x)
             least_x = rdg_node->x;
     }
 
-    for (it = graph_iterator(rdg->graph); it != NULL; it = graph_it_next(it)) {
-        struct _rdg_node * rdg_node = graph_it_data(it);
+    for (node = graph_iter_first(&git, rdg->graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        struct _rdg_node * rdg_node = node->data;
         rdg_node->x -= least_x;
     }
 }
@@ -1039,11 +1042,14 @@ void rdg_assign_x (struct _rdg * rdg)
 void rdg_left_adjust_x (struct _rdg * rdg)
 {
     int min_x = 1000000;
-    struct _graph_it * it;
+    struct _graph_iter   git;
+    struct _graph_node * node;
 
     // find min_x
-    for (it = graph_iterator(rdg->graph); it != NULL; it = graph_it_next(it)) {
-        struct _rdg_node * rdg_node = graph_it_data(it);
+    for (node = graph_iter_first(&git, rdg->graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        struct _rdg_node * rdg_node = node->data;
         if (rdg_node->x < min_x)
             min_x = rdg_node->x;
     }
@@ -1056,8 +1062,10 @@ void rdg_left_adjust_x (struct _rdg * rdg)
     min_x *= -1;
 
     // adjust nodes
-    for (it = graph_iterator(rdg->graph); it != NULL; it = graph_it_next(it)) {
-        struct _rdg_node * rdg_node = graph_it_data(it);
+    for (node = graph_iter_first(&git, rdg->graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        struct _rdg_node * rdg_node = node->data;
         rdg_node->x += min_x;
     }
 }
@@ -1135,7 +1143,7 @@ inline void rdg_swap_node_positions (struct _rdg * rdg,
     struct _rdg_node * rdg_right_node;
     struct _index * index;
     
-    struct _map * level_map = map_fetch(rdg->levels, level);
+    struct _map * level_map = map_fetch_writable(rdg->levels, level);
 
     // fetch nodes
     index = map_fetch(level_map, left);
@@ -1151,39 +1159,8 @@ inline void rdg_swap_node_positions (struct _rdg * rdg,
     map_remove(level_map, left);
     map_remove(level_map, right);
 
-    index = index_create(rdg_right_node->index);
-    map_insert(level_map, left, index);
-    object_delete(index);
-
-    index = index_create(rdg_left_node->index);
-    map_insert(level_map, right, index);
-    object_delete(index);
-}
-
-
-// find the left x of this node by calculating the x center of adjacent nodes
-double rdg_node_adjacent_center (struct _rdg * rdg, struct _rdg_node * rdg_node)
-{
-    double sum = 0;
-    double n   = 0;
-
-    struct _graph_node * node = graph_fetch_node(rdg->graph, rdg_node->index);
-    struct _list_it * it;
-    for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-        struct _graph_edge * edge = it->data;
-        struct _rdg_node * rdg_adjacent;
-        if (edge->head == rdg_node->index)
-            rdg_adjacent = graph_fetch_data(rdg->graph, edge->tail);
-        else
-            rdg_adjacent = graph_fetch_data(rdg->graph, edge->head);
-        n   += 1.0;
-        sum += rdg_adjacent->position;
-    }
-
-    if (n == 0)
-        return 0;
-
-    return sum / n;
+    map_insert_take(level_map, left,  index_create(rdg_right_node->index));
+    map_insert_take(level_map, right, index_create(rdg_left_node->index));
 }
 
 
@@ -1191,23 +1168,71 @@ void rdg_reduce_edge_crossings (struct _rdg * rdg)
 {
     int keep_looping = 64;
 
+    // the barycenters are found over flat arrays indexed by node id. order
+    // holds the ids in index order, and the ids adjacent to order[i] are
+    // adjacent[adjacent_start[i] .. adjacent_start[i + 1])
+    size_t   size           = rdg->graph->size;
+    double * positions      = malloc(sizeof(double) * size);
+    size_t * order          = malloc(sizeof(size_t) * size);
+    size_t * adjacent_start = malloc(sizeof(size_t) * (size + 1));
+    size_t * adjacent;
+    size_t   adjacent_n = 0;
+    size_t   i, j;
+
+    struct _graph_iter   git;
+    struct _graph_node * node;
+    i = 0;
+    for (node = graph_iter_first(&git, rdg->graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        positions[node->id] = ((struct _rdg_node *) node->data)->position;
+        order[i] = node->id;
+        adjacent_start[i++] = adjacent_n;
+        adjacent_n += node->edges->size;
+    }
+    adjacent_start[i] = adjacent_n;
+
+    adjacent = malloc(sizeof(size_t) * adjacent_n);
+    adjacent_n = 0;
+    for (node = graph_iter_first(&git, rdg->graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        for (j = 0; j < node->edges->size; j++) {
+            struct _graph_edge * edge = node->edges->items[j];
+            if (edge->head == node->index)
+                adjacent[adjacent_n++] = graph_fetch_node(rdg->graph, edge->tail)->id;
+            else
+                adjacent[adjacent_n++] = graph_fetch_node(rdg->graph, edge->head)->id;
+        }
+    }
+
     while (keep_looping--) {
-        // for every node in the graph
-        struct _graph_it * it;
-        for (it = graph_iterator(rdg->graph);
-             it != NULL;
-             it = graph_it_next(it)) {
-            struct _rdg_node * rdg_node = graph_it_data(it);
-
-            // set the barycenter
-            rdg_node->position = rdg_node_adjacent_center(rdg, rdg_node);
+        // for every node in the graph, set the barycenter
+        for (i = 0; i < size; i++) {
+            double sum = 0;
+            double n   = 0;
+            for (j = adjacent_start[i]; j < adjacent_start[i + 1]; j++) {
+                n   += 1.0;
+                sum += positions[adjacent[j]];
+            }
+            positions[order[i]] = (n == 0) ? 0 : sum / n;
         }
     }
 
+    for (i = 0; i < size; i++) {
+        struct _rdg_node * rdg_node = graph_node_by_id(rdg->graph, i)->data;
+        rdg_node->position = positions[i];
+    }
+
+    free(positions);
+    free(order);
+    free(adjacent_start);
+    free(adjacent);
+
     // sort levels by position. warning: inefficient sorting method
     int level_i;
     for (level_i = 0; level_i < rdg->levels->size; level_i++) {
-        struct _map * level_map = map_fetch(rdg->levels, level_i);
+        struct _map * level_map = map_fetch_writable(rdg->levels, level_i);
 
         // get first node in this level
         int i;
@@ -1226,19 +1251,17 @@ void rdg_reduce_edge_crossings (struct _rdg * rdg)
                 // if next node's position < first node's position, swap
                 if (node_j->position < node_i->position) {
                     // swap positions in level_map
-                    // we need to copy these because they will be deleted
-                    index_j = object_copy(index_j);
-                    index_i = object_copy(index_i);
+                    // hold on to these, map_remove drops the map's references
+                    object_retain(index_j);
+                    object_retain(index_i);
 
                     map_remove(level_map, i);
                     map_remove(level_map, j);
 
-                    map_insert(level_map, i, index_j);
-                    map_insert(level_map, j, index_i);
+                    map_insert_take(level_map, i, index_j);
+                    map_insert_take(level_map, j, index_i);
 
-                    // delete copies and retrieve new index_i
-                    object_delete(index_i);
-                    object_delete(index_j);
+                    // retrieve new index_i
                     index_i = map_fetch(level_map, i);
                     
                     // reset node_i pointer
@@ -1335,9 +1358,9 @@ void rdg_draw_edge (struct _rdg * rdg,
     while (last_node->flags & RDG_NODE_VIRTUAL) {
         struct _graph_node * node = graph_fetch_node(rdg->graph, last_node->index);
         last_node = NULL;
-        struct _list_it * it;
-        for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-            struct _graph_edge * edge = it->data;
+        size_t i;
+        for (i = 0; i < node->edges->size; i++) {
+            struct _graph_edge * edge = node->edges->items[i];
             if (edge->head == node->index) {
                 last_node = graph_fetch_data(rdg->graph, edge->tail);
                 break;
@@ -1363,9 +1386,12 @@ void rdg_draw_edge (struct _rdg * rdg,
             next_y = next_node->y;
             // does the current x conflict with any nodes on this level
             struct _map * level_map = map_fetch(rdg->levels, next_node->level);
-            struct _map_it * mit;
-            for (mit = map_iterator(level_map); mit != NULL; mit = map_it_next(mit)) {
-                struct _index * index = map_it_data(mit);
+            struct _map_iter mit;
+            int              more;
+            for (more = map_iter_first(&mit, level_map);
+                 more;
+                 more = map_iter_next(&mit)) {
+                struct _index * index = mit.value;
                 struct _rdg_node * rn = graph_fetch_data(rdg->graph, index->index);
 
                 if ((this_x >= rn->x) && (this_x <= rn->x + rdg_node_width(rn))) {
@@ -1407,8 +1433,7 @@ void rdg_draw_edge (struct _rdg * rdg,
 
             if (index == NULL) {
                 index = index_create(3);
-                map_insert(level_spacings, next_node->level, index);
-                object_delete(index);
+                map_insert_take(level_spacings, next_node->level, index);
                 spacing = 4.0;
             }
             else {
@@ -1465,9 +1490,9 @@ void rdg_draw_edge (struct _rdg * rdg,
 
         struct _graph_node * node = graph_fetch_node(rdg->graph, next_node->index);
         next_node = NULL;
-        struct _list_it * it;
-        for (it = list_iterator(node->edges); it != NULL; it = it->next) {
-            struct _graph_edge * edge = it->data;
+        size_t i;
+        for (i = 0; i < node->edges->size; i++) {
+            struct _graph_edge * edge = node->edges->items[i];
             if (edge->head == node->index) {
                 next_node = graph_fetch_data(rdg->graph, edge->tail);
                 break;
@@ -1494,11 +1519,12 @@ void rdg_draw (struct _rdg * rdg)
 
     struct _map * level_edge_spacings = map_create();
 
-    struct _graph_it * graph_it;
-    for (graph_it = graph_iterator(rdg->graph);
-         graph_it != NULL;
-         graph_it = graph_it_next(graph_it)) {
-        struct _rdg_node * rdg_node = graph_it_data(graph_it);
+    struct _graph_iter   git;
+    struct _graph_node * node;
+    for (node = graph_iter_first(&git, rdg->graph);
+         node != NULL;
+         node = graph_iter_next(&git)) {
+        struct _rdg_node * rdg_node = node->data;
 
         /*
         if (rdg_node->flags & RDG_NODE_VIRTUAL)
@@ -1533,13 +1559,12 @@ void rdg_draw (struct _rdg * rdg)
             continue;
 
         // draw edges
-        struct _list_it * eit;
-        struct _list * successors = graph_node_successors(graph_it_node(graph_it));
-        for (eit = list_iterator(successors); eit != NULL; eit = eit->next) {
-            struct _graph_edge * edge = eit->data;
+        struct _graph_edge_iter eit;
+        struct _graph_edge    * edge;
+        for (edge = graph_successors_first(&eit, node);
+             edge != NULL;
+             edge = graph_edge_iter_next(&eit))
             rdg_draw_edge(rdg, edge, level_edge_spacings);
-        }
-        object_delete(successors);
     }
 
     object_delete(level_edge_spacings);
@@ -4,7 +4,10 @@
 #include <cairo.h>
 #include <inttypes.h>
 
+#include "arena.h"
+#include "fgraph.h"
 #include "graph.h"
+#include "graph_walk.h"
 #include "index.h"
 #include "list.h"
 #include "map.h"
@@ -72,19 +75,24 @@ enum {
 * this is a map of maps of struct _index, where the map at position N contains
 * the index of all nodes at level N.
 * rdg->levels is NULL until instantiated and filled
+* rdg->levels and the maps in it are persistent, so copies of an rdg share
+* them. change a level map only after fetching it with map_fetch_writable
 */
 struct _rdg {
     const struct _object * object;
+    unsigned int           refs;
     cairo_surface_t      * surface;
     uint64_t               top_index;
     struct _graph        * graph;
     struct _map          * levels;
+    struct _arena        * arena;
     int width;
     int height;
 };
 
 struct _rdg_node_color {
     const struct _object * object;
+    unsigned int           refs;
     uint64_t index;
     double red;
     double green;
@@ -97,10 +105,10 @@ void rdg_debug (struct _rdg * rdg);
 * rdg functions
 */
 // top_index = is the index of the top node in this graph
-// graph     = an instruction graph from a loader
+// graph     = a frozen graph of blocks, each a _vector of instructions
 // labels    = a label map which has labels for instruction targets
-struct _rdg * rdg_create (uint64_t        top_index,
-                          struct _graph * graph);
+struct _rdg * rdg_create (uint64_t               top_index,
+                          const struct _fgraph * graph);
 void          rdg_delete (struct _rdg * rdg);
 struct _rdg * rdg_copy   (const struct _rdg * rdg);
 
@@ -120,7 +128,7 @@ int rdg_node_y (struct _rdg * rdg, uint64_t index);
 // labels    = a label map which includes labels for instruction targets
 // node_color_lost = a list of rdg_node_color objects
 void                rdg_color_nodes  (struct _rdg * rdg,
-                                      struct _graph * ins_graph,
+                                      const struct _fgraph * ins_graph,
                                       struct _list * node_color_list);
 
 // rdg       = this graph we want to color
@@ -130,7 +138,7 @@ void                rdg_color_nodes  (struct _rdg * rdg,
 // node_color_lost = a list of rdg_node_color objects
 // highlight_ins   = an instruction index to highlight
 void                rdg_custom_nodes  (struct _rdg * rdg,
-                                       struct _graph  * ins_graph,
+                                       const struct _fgraph * ins_graph,
                                        struct _list * node_color_list,
                                        uint64_t highlight_ins);
 // redraws the entire graph. call this after rdg_color_nodes
@@ -156,9 +164,9 @@ uint64_t rdg_get_node_by_coords (struct _rdg * rdg, int x, int y);
 // rdg       = the rdg
 // ins_graph = an instruction graph returned by the loader
 // returns -1 if ins not found
-uint64_t rdg_get_ins_by_coords (struct _rdg   * rdg,
-                                struct _graph * ins_graph,
-                                struct _map   * labels,
+uint64_t rdg_get_ins_by_coords (struct _rdg          * rdg,
+                                const struct _fgraph * ins_graph,
+                                struct _map          * labels,
                                 int x, int y);
 
 int rdg_node_source_x (struct _rdg * rdg,
@@ -173,8 +181,15 @@ int rdg_node_sink_x   (struct _rdg * rdg,
 int rdg_node_sink_y   (struct _rdg * rdg,
                        struct _rdg_node * src_node,
                        struct _rdg_node * dst_node);
-void rdg_acyclicize     (struct _graph * graph, uint64_t index);
-void rdg_acyclicize_pre (struct _graph * graph, uint64_t index);
+// remove the edges which make the graph cyclic, walking forward, then
+// backward, from index. walk is shared between the two, so the backward pass
+// only walks nodes the forward pass did not reach
+void rdg_acyclicize     (struct _graph      * graph,
+                         struct _graph_walk * walk,
+                         uint64_t             index);
+void rdg_acyclicize_pre (struct _graph      * graph,
+                         struct _graph_walk * walk,
+                         uint64_t             index);
 
 void rdg_node_level_init         (struct _graph_node * node);
 int  rdg_predecessors_level      (struct _graph * graph, uint64_t index);
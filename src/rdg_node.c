@@ -3,10 +3,11 @@
 #include <stdlib.h>
 #include <stdio.h>
 
+#include "arena.h"
 #include "instruction.h"
-#include "list.h"
 #include "string.h"
 #include "util.h"
+#include "vector.h"
 
 
 static const struct _object rdg_node_object = {
@@ -21,8 +22,9 @@ struct _rdg_node * rdg_node_create (uint64_t index, cairo_surface_t * surface)
 {
     struct _rdg_node * node;
 
-    node = (struct _rdg_node *) malloc(sizeof(struct _rdg_node));
+    node = (struct _rdg_node *) mem_alloc(sizeof(struct _rdg_node));
     node->object  = &rdg_node_object;
+    node->refs    = 1;
     node->index   = index;
     if (surface == NULL)
         node->surface = NULL;
@@ -42,7 +44,7 @@ void rdg_node_delete (struct _rdg_node * node)
 {
     if (node->surface != NULL)
         cairo_surface_destroy(node->surface);
-    free(node);
+    mem_free(node);
 }
 
 
@@ -98,15 +100,15 @@ int rdg_node_center_y (struct _rdg_node * rdg_node)
 }
 
 
-cairo_surface_t * rdg_node_draw_full (struct _graph_node * node,
-                                      double               bg_red,
-                                      double               bg_green,
-                                      double               bg_blue,
-                                      uint64_t             highlight_ins) {
+cairo_surface_t * rdg_node_draw_full (const struct _fgraph_node * node,
+                                      double                      bg_red,
+                                      double                      bg_green,
+                                      double                      bg_blue,
+                                      uint64_t                    highlight_ins) {
 
 
-    struct _list * ins_list = node->data;
-    if (ins_list->size == 0) {
+    struct _vector * block = node->data;
+    if (block->size == 0) {
         printf("rdg_node_draw_full instruction == 0 node %llx\n",
                (unsigned long long) node->index);
     }
@@ -117,7 +119,7 @@ cairo_surface_t * rdg_node_draw_full (struct _graph_node * node,
     cairo_font_extents_t fe;
 
     // create a rough approximation of the graph height
-    int number_of_instructions = ((struct _list *) node->data)->size;
+    int number_of_instructions = block->size;
     int height = ((int) RDG_NODE_FONT_SIZE + 6) * number_of_instructions;
     height += (int) RDG_NODE_PADDING * 2 + RDG_NODE_FONT_SIZE * 2;
 
@@ -138,12 +140,10 @@ cairo_surface_t * rdg_node_draw_full (struct _graph_node * node,
     double top = RDG_NODE_PADDING + fe.height;
     double max_width = 0.0;
 
-    struct _list_it * list_it;
-    for (list_it = list_iterator(node->data);
-         list_it != NULL;
-         list_it = list_it->next) {
+    size_t ins_i;
+    for (ins_i = 0; ins_i < block->size; ins_i++) {
 
-        struct _ins * ins = list_it->data;
+        struct _ins * ins = block->items[ins_i];
 
         if (ins->address == highlight_ins)
             cairo_select_font_face(ctx,
@@ -257,7 +257,7 @@ cairo_surface_t * rdg_node_draw_full (struct _graph_node * node,
 }
 
 
-cairo_surface_t * rdg_node_draw (struct _graph_node * node)
+cairo_surface_t * rdg_node_draw (const struct _fgraph_node * node)
 {
     return rdg_node_draw_full(node, RDG_NODE_BG_COLOR, -1);
 }
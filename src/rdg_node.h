@@ -9,6 +9,7 @@ struct _rdg_node;
 
 struct _rdg_node {
     const struct _object * object;
+    unsigned int           refs;
     uint64_t               index;
     cairo_surface_t      * surface;
     int    level;
@@ -31,11 +32,11 @@ int rdg_node_center_y (struct _rdg_node * rdg_node);
 
 
 
-cairo_surface_t * rdg_node_draw_full (struct _graph_node * node,
+cairo_surface_t * rdg_node_draw_full (const struct _fgraph_node * node,
                                       double bg_red,
                                       double bg_green,
                                       double bg_blue,
                                       uint64_t highlight_ins);
-cairo_surface_t * rdg_node_draw (struct _graph_node * node);
+cairo_surface_t * rdg_node_draw (const struct _fgraph_node * node);
 
 #endif
\ No newline at end of file
@@ -1,71 +1,226 @@
 #include <stdio.h>
+#include <string.h>
 #include "arch.h"
+#include "arena.h"
+#include "discover.h"
 #include "elf32.h"
+#include "fgraph.h"
 #include "function.h"
+#include "hashmap.h"
 #include "index.h"
+#include "ins_cache.h"
+#include "ins_store.h"
 #include "loader.h"
 #include "queue.h"
 #include "util.h"
+#include "vector.h"
 #include "x86.h"
 
-struct _map * recursive_dis_entries (arch_disassemble disassemble,
+// functions found keep the ids of their instructions in store, which holds
+// each instruction once for the whole program, and a graph of those ids
+// rather than a graph of their instructions
+struct _map * recursive_dis_entries (const struct _arch_dis_option * option,
                                      const struct _map * mem_map,
-                                     const struct _list * entries)
+                                     const struct _list * entries,
+                                     struct _ins_store * store)
 {
-    struct _map * functions = map_create();
-    struct _queue * queue = queue_create();
+    // everything this analysis creates comes from one arena, which goes
+    // with the caller's
+    struct _arena * arena    = arena_create();
+    struct _arena * previous = arena_bind(arena);
+    if (previous != NULL)
+        arena_hold(previous, arena);
+
+    struct _map * functions = map_create_btree();
+    struct _hashset * claimed = hashset_create();
+    struct _queue_u64 * queue = queue_u64_create();
 
     struct _list_it * lit;
     for (lit = list_iterator((struct _list *) entries);
          lit != NULL;
          lit = lit->next) {
-        queue_push(queue, lit->data);
+        struct _index * index = lit->data;
+        queue_u64_push(queue, index->index);
     }
 
     while (queue->size > 0) {
-        struct _index * index = queue_peek(queue);
-        if (map_fetch(functions, index->index)) {
-            queue_pop(queue);
+        uint64_t address = queue_u64_peek(queue);
+        queue_u64_pop(queue);
+        if (hashset_insert(claimed, address))
             continue;
-        }
 
-        struct _graph * graph = disassemble(mem_map, index->index);
+        // functions are kept frozen, which is smaller and faster to walk
+        struct _graph  * unfrozen = option->disassemble(mem_map, address);
+        struct _fgraph * graph    = graph_freeze(unfrozen);
+        object_delete(unfrozen);
 
-        struct _list * call_dests = ins_graph_to_list_index_call_dest(graph);
+        struct _list * call_dests;
+        if (option->granularity == ARCH_DIS_BLOCKS)
+            call_dests = block_graph_to_list_index_call_dest(graph);
+        else
+            call_dests = ins_graph_to_list_index_call_dest(graph);
         struct _list_it * lit;
         for (lit = list_iterator(call_dests); lit != NULL; lit = lit->next) {
-            queue_push(queue, lit->data);
+            struct _index * index = lit->data;
+            queue_u64_push(queue, index->index);
         }
         object_delete(call_dests);
 
-        struct _function * function = function_create(index->index, graph, NULL);
+        // graph nodes are in address order, so ins_ids lists the function's
+        // instructions by address. the ids themselves are not sorted, an
+        // instruction keeps the id it got from whichever function reached
+        // it first
+        struct _vector * inss = vector_create();
+        size_t i;
+        for (i = 0; i < graph->size; i++) {
+            if (option->granularity == ARCH_DIS_BLOCKS)
+                vector_append_vector(inss, graph->nodes[i].data);
+            else
+                vector_append(inss, graph->nodes[i].data);
+        }
 
-        object_delete(graph);
+        uint32_t * ins_ids = (uint32_t *) malloc(sizeof(uint32_t) * inss->size);
+        for (i = 0; i < inss->size; i++)
+            ins_ids[i] = ins_store_add(store, inss->items[i]);
 
-        map_insert(functions, index->index, function);
+        struct _fgraph   * id_graph = ins_store_graph(store, ins_ids, inss->size);
+        struct _function * function = function_create(address, id_graph, NULL);
+        function_s_ins_ids(function, ins_ids, inss->size);
 
-        object_delete(function);
+        objects_delete(inss, id_graph, graph, NULL);
+        free(ins_ids);
 
-        queue_pop(queue);
+        map_insert_take(functions, address, function);
     }
 
-    object_delete(queue);
+    objects_delete(queue, claimed, NULL);
+
+    // the arena lives on until the functions found are deleted
+    arena_bind(previous);
+    object_delete(arena);
 
     return functions;
 }
 
 
 
+struct _recursive_dis {
+    const struct _arch_dis_option * option;
+    struct _ins_store             * store;
+    struct _map                   * functions;
+};
+
+
+// a worker keeps each function's instructions in a store of the function's
+// own, as the program's store may only be added to by one thread
+static void * recursive_dis_keep (uint64_t address,
+                                  const struct _fgraph * graph,
+                                  void * data)
+{
+    struct _recursive_dis * rd    = data;
+    struct _ins_store     * local = ins_store_create();
+    size_t i, j;
+
+    for (i = 0; i < graph->size; i++) {
+        if (rd->option->granularity == ARCH_DIS_BLOCKS) {
+            struct _vector * block = graph->nodes[i].data;
+            for (j = 0; j < block->size; j++)
+                ins_store_add(local, block->items[j]);
+        }
+        else
+            ins_store_add(local, graph->nodes[i].data);
+    }
+
+    return local;
+}
+
+
+// functions arrive in the order recursive_dis_entries finds them, so their
+// instructions get the same ids
+static void recursive_dis_found (uint64_t address, void * kept, void * data)
+{
+    struct _recursive_dis * rd    = data;
+    struct _ins_store     * local = kept;
+    uint32_t              * ins_ids;
+    uint32_t                id;
+
+    ins_ids = (uint32_t *) malloc(sizeof(uint32_t) * local->size);
+    for (id = 0; id < local->size; id++)
+        ins_ids[id] = ins_store_add_from(rd->store, local, id);
+
+    struct _fgraph   * graph    = ins_store_graph(rd->store, ins_ids, local->size);
+    struct _function * function = function_create(address, graph, NULL);
+    function_s_ins_ids(function, ins_ids, local->size);
+    map_insert_take(rd->functions, address, function);
+
+    free(ins_ids);
+    objects_delete(graph, local, NULL);
+}
+
+
+// as recursive_dis_entries, with jobs threads disassembling at once
+struct _map * recursive_dis_entries_jobs (const struct _arch_dis_option * option,
+                                          const struct _map * mem_map,
+                                          const struct _list * entries,
+                                          struct _ins_store * store,
+                                          unsigned int jobs)
+{
+    struct _arena * arena    = arena_create();
+    struct _arena * previous = arena_bind(arena);
+    if (previous != NULL)
+        arena_hold(previous, arena);
+
+    struct _recursive_dis rd;
+    rd.option    = option;
+    rd.store     = store;
+    rd.functions = map_create_btree();
+
+    discover_functions(option,
+                       mem_map,
+                       entries,
+                       jobs,
+                       recursive_dis_keep,
+                       recursive_dis_found,
+                       &rd);
+
+    arena_bind(previous);
+    object_delete(arena);
+
+    return rd.functions;
+}
+
+
+
 int main (int argc, char * argv[])
 {
-    if (argc != 2) {
-        fprintf(stderr, "Usage: %s <executable>\n", argv[0]);
+    // --blocks disassembles functions straight into basic blocks
+    int blocks = 0;
+    // --jobs N disassembles on N threads
+    unsigned int jobs = 1;
+    int usage = (argc < 2);
+    int i;
+
+    for (i = 1; i < argc - 1; i++) {
+        if (strcmp(argv[i], "--blocks") == 0)
+            blocks = 1;
+        else if ((strcmp(argv[i], "--jobs") == 0) && (i + 1 < argc - 1))
+            jobs = strtoul(argv[++i], NULL, 10);
+        else
+            usage = 1;
+    }
+
+    if (usage || (jobs == 0)) {
+        fprintf(stderr,
+                "Usage: %s [--blocks] [--jobs N] <executable>\n",
+                argv[0]);
         return -1;
     }
 
-    FILE * fh = fopen(argv[1], "rb");
+    const char * filename = argv[argc - 1];
+
+    FILE * fh = fopen(filename, "rb");
     if (fh == NULL) {
-        fprintf(stderr, "Could not open file %s\n", argv[1]);
+        fprintf(stderr, "Could not open file %s\n", filename);
         return -1;
     }
 
@@ -119,8 +274,37 @@ int main (int argc, char * argv[])
 
     printf("have mem map\n");
 
-    struct _map * functions = recursive_dis_entries(arch->default_dis_option.disassemble,
-                                                    mem_map, entries);
+    const struct _arch_dis_option * option = &(arch->default_dis_option);
+    if (blocks) {
+        const struct _arch_dis_option * o;
+        for (o = arch->disassembly_options; o->name != NULL; o++) {
+            if (o->granularity == ARCH_DIS_BLOCKS) {
+                option = o;
+                break;
+            }
+        }
+    }
+    printf("%s\n", option->name);
+
+    // the analysis runs in a session arena, which is dropped at the end
+    // rather than deleting every function and instruction in it
+    struct _arena * session = arena_create();
+    arena_bind(session);
+
+    struct _ins_store * store = ins_store_create();
+    // instructions reached from more than one function are decoded once
+    struct _ins_cache * cache = ins_cache_create(mem_map);
+    ins_cache_bind(cache);
+
+    struct _map * functions;
+    if (jobs > 1)
+        functions = recursive_dis_entries_jobs(option, mem_map, entries, store, jobs);
+    else
+        functions = recursive_dis_entries(option, mem_map, entries, store);
+
+    ins_cache_bind(NULL);
+    printf("ins cache: %zu hits, %zu misses\n",
+           ins_cache_hits(cache), ins_cache_misses(cache));
 
     struct _map_it * mit;
     for (mit = map_iterator(functions); mit != NULL; mit = map_it_next(mit)) {
@@ -131,7 +315,10 @@ int main (int argc, char * argv[])
                function->name);
     }
 
-    objects_delete(buffer, entries, mem_map, functions, NULL);
+    arena_bind(NULL);
+    arena_drop(session);
+
+    objects_delete(buffer, entries, mem_map, store, NULL);
 
     return 0;
 }
\ No newline at end of file
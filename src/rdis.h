@@ -3,6 +3,7 @@
 
 struct _rdis {
     const struct _object * object;
+    unsigned int           refs;
 };
 
 #endif
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "index.h"
 #include "instruction.h"
+#include "vector.h"
 
 #include <string.h>
 
@@ -20,8 +21,10 @@ int mem_map_set (struct _map * mem_map, uint64_t address, struct _buffer * buf)
     * |-------------| buf2
     *   |----|        buf
     */
-    else if ((address >= key) && (address + buf->size <= key + buf2->size))
+    else if ((address >= key) && (address + buf->size <= key + buf2->size)) {
+        buf2 = map_fetch_writable(mem_map, key);
         memcpy(&(buf2->bytes[address - key]), buf->bytes, buf->size);
+    }
 
     /*
     * buf envelops buf2
@@ -66,60 +69,189 @@ int mem_map_set (struct _map * mem_map, uint64_t address, struct _buffer * buf)
 }
 
 
-struct _graph * ins_graph_to_list_ins_graph (struct _graph * graph)
+struct _graph * ins_graph_to_list_ins_graph (const struct _fgraph * graph)
 {
     struct _graph * lgraph = graph_create();
+    size_t i, j;
 
-    struct _graph_it * git;
-    for (git = graph_iterator(graph); git != NULL; git = graph_it_next(git)) {
-        struct _list * list = list_create();
-        list_append(list, graph_it_data(git));
-        graph_add_node(lgraph, graph_it_index(git), list);
-        object_delete(list);
+    for (i = 0; i < graph->size; i++) {
+        struct _vector * block = vector_create();
+        vector_append(block, graph->nodes[i].data);
+        graph_add_node_take(lgraph, graph->nodes[i].index, block);
     }
 
-    for (git = graph_iterator(graph); git != NULL; git = graph_it_next(git)) {
-        struct _list * successors = graph_node_successors(graph_it_node(git));
-        struct _list_it * lit;
-        for (lit = list_iterator(successors); lit != NULL; lit = lit->next) {
-            struct _graph_edge * edge = lit->data;
-            graph_add_edge(lgraph, edge->head, edge->tail, edge->data);
+    for (i = 0; i < graph->size; i++) {
+        const struct _fgraph_edge * successors = fgraph_successors(graph, i);
+        for (j = 0; j < fgraph_successors_n(graph, i); j++) {
+            graph_add_edge(lgraph,
+                           graph->nodes[i].index,
+                           graph->nodes[successors[j].node].index,
+                           successors[j].data);
         }
-        object_delete(successors);
     }
 
     return lgraph;
 }
 
 
-struct _list * ins_graph_to_list_call_ins (struct _graph * graph)
+struct _graph * ins_graph_to_block_graph (const struct _fgraph * graph)
+{
+    // an instruction runs on into its successor when it has no other
+    // successor and the successor has no other predecessor. these are the
+    // same merges graph_reduce makes
+    size_t * next  = (size_t *) malloc(sizeof(size_t) * graph->size);
+    size_t * block = (size_t *) malloc(sizeof(size_t) * graph->size);
+    char   * head  = (char *)   malloc(graph->size);
+    size_t   i, j, blocks;
+
+    for (i = 0; i < graph->size; i++) {
+        next[i]  = FGRAPH_NONE;
+        block[i] = FGRAPH_NONE;
+        head[i]  = 1;
+    }
+
+    for (i = 0; i < graph->size; i++) {
+        if (fgraph_successors_n(graph, i) != 1)
+            continue;
+        j = fgraph_successors(graph, i)[0].node;
+        if ((j != i) && (fgraph_predecessors_n(graph, j) == 1)) {
+            next[i] = j;
+            head[j] = 0;
+        }
+    }
+
+    // every run starts at an instruction nothing runs into, except runs
+    // which loop back on themselves. those start at their lowest address
+    blocks = 0;
+    for (i = 0; i < graph->size; i++) {
+        if (head[i])
+            blocks++;
+    }
+    for (i = 0; i < graph->size; i++) {
+        if (head[i] != 1)
+            continue;
+        for (j = i; (j != FGRAPH_NONE) && (block[j] == FGRAPH_NONE); j = next[j])
+            block[j] = i;
+    }
+    for (i = 0; i < graph->size; i++) {
+        if (block[i] != FGRAPH_NONE)
+            continue;
+        head[i] = 1;
+        blocks++;
+        for (j = i; block[j] == FGRAPH_NONE; j = next[j])
+            block[j] = i;
+    }
+
+    // create one node per block, in address order
+    uint64_t * indices = (uint64_t *) malloc(sizeof(uint64_t) * blocks);
+    void    ** data    = (void **) malloc(sizeof(void *) * blocks);
+    size_t     b       = 0;
+
+    for (i = 0; i < graph->size; i++) {
+        if (! head[i])
+            continue;
+        struct _vector * vector = vector_create();
+        j = i;
+        do {
+            vector_append(vector, graph->nodes[j].data);
+            j = next[j];
+        } while ((j != FGRAPH_NONE) && (! head[j]));
+        indices[b] = graph->nodes[i].index;
+        data[b]    = vector;
+        b++;
+    }
+
+    struct _graph * bgraph = graph_build_sorted(indices, data, blocks);
+
+    // a block's edges are those of its last instruction, added in address
+    // order of that instruction, as graph_reduce leaves them. graph_reduce
+    // lists an edge from a block of several instructions back to its own
+    // head first, as the head's instruction held it already, so that edge
+    // is added first here too
+    for (i = 0; i < graph->size; i++) {
+        if ((next[i] != FGRAPH_NONE) && (! head[next[i]]))
+            continue;
+        const struct _fgraph_edge * successors = fgraph_successors(graph, i);
+        size_t                      loop       = FGRAPH_NONE;
+
+        if (block[i] != i) {
+            for (j = 0; j < fgraph_successors_n(graph, i); j++) {
+                if (successors[j].node == block[i])
+                    loop = j;
+            }
+        }
+        if (loop != FGRAPH_NONE)
+            graph_add_edge(bgraph,
+                           graph->nodes[block[i]].index,
+                           graph->nodes[block[i]].index,
+                           successors[loop].data);
+
+        for (j = 0; j < fgraph_successors_n(graph, i); j++) {
+            if (j == loop)
+                continue;
+            graph_add_edge(bgraph,
+                           graph->nodes[block[i]].index,
+                           graph->nodes[block[successors[j].node]].index,
+                           successors[j].data);
+        }
+    }
+
+    free(indices);
+    free(data);
+    free(next);
+    free(block);
+    free(head);
+
+    return bgraph;
+}
+
+
+struct _list * ins_graph_to_list_call_ins (const struct _fgraph * graph)
 {
     struct _list * list = list_create();
+    size_t i;
 
-    struct _graph_it * git;
-    for (git = graph_iterator(graph); git != NULL; git = graph_it_next(git)) {
-        if (ins_is_call(graph_it_data(git)))
-            list_append(list, graph_it_data(git));
+    for (i = 0; i < graph->size; i++) {
+        if (ins_is_call(graph->nodes[i].data))
+            list_append(list, graph->nodes[i].data);
     }
 
     return list;
 }
 
 
-struct _list * ins_graph_to_list_index_call_dest (struct _graph * graph)
+struct _list * ins_graph_to_list_index_call_dest (const struct _fgraph * graph)
 {
     struct _list * list = list_create();
+    size_t i, j;
 
-    struct _graph_it * git;
-    for (git = graph_iterator(graph); git != NULL; git = graph_it_next(git)) {
-        struct _ins * ins = graph_it_data(git);
-        struct _list_it * lit;
-        for (lit = list_iterator(ins->successors); lit != NULL; lit = lit->next) {
-            struct _ins_value * successor = lit->data;
+    for (i = 0; i < graph->size; i++) {
+        struct _ins * ins = graph->nodes[i].data;
+        for (j = 0; j < ins->successors->size; j++) {
+            struct _ins_value * successor = ins->successors->items[j];
             if (successor->type == INS_SUC_CALL) {
-                struct _index * index = index_create(successor->address);
-                list_append(list, index);
-                index_delete(index);
+                list_append_take(list, index_create(successor->address));
+            }
+        }
+    }
+
+    return list;
+}
+
+
+struct _list * block_graph_to_list_index_call_dest (const struct _fgraph * graph)
+{
+    struct _list * list = list_create();
+    size_t i, j, k;
+
+    for (i = 0; i < graph->size; i++) {
+        struct _vector * block = graph->nodes[i].data;
+        for (j = 0; j < block->size; j++) {
+            struct _ins * ins = block->items[j];
+            for (k = 0; k < ins->successors->size; k++) {
+                struct _ins_value * successor = ins->successors->items[k];
+                if (successor->type == INS_SUC_CALL)
+                    list_append_take(list, index_create(successor->address));
             }
         }
     }
@@ -150,30 +282,12 @@ char * str_append (char * string,
 }
 
 
-char * ins_graph_to_dot_string (struct _graph * graph)
+char * ins_graph_to_dot_string (const struct _fgraph * graph)
 {
-    struct _graph * g = graph_create();
-    struct _graph_it * git;
-    for (git = graph_iterator(graph); git != NULL; git = graph_it_next(git)) {
-        struct _list * list = list_create();
-        list_append(list, graph_it_data(git));
-        graph_add_node(g, graph_it_index(git), list);
-        object_delete(list);
-    }
-
-    for (git = graph_iterator(graph); git != NULL; git = graph_it_next(git)) {
-        struct _list * successors = graph_node_successors(graph_it_node(git));
-
-        struct _list_it * lit;
-        for (lit = list_iterator(successors); lit != NULL; lit = lit->next) {
-            struct _graph_edge * edge = lit->data;
-            graph_add_edge(g, edge->head, edge->tail, edge->data);
-        }
-        object_delete(successors);
-    }
-
-    graph_reduce(g);
+    struct _graph * g = ins_graph_to_block_graph(graph);
 
+    struct _fgraph * blocks = graph_freeze(g);
+    object_delete(g);
 
     size_t str_size = 4096;
     size_t str_len  = 0;
@@ -183,19 +297,20 @@ char * ins_graph_to_dot_string (struct _graph * graph)
 
     str = str_append(str, &str_size, &str_len, "digraph G {\n");
 
-    for (git = graph_iterator(g); git != NULL; git = graph_it_next(git)) {
+    size_t i, j;
+    for (i = 0; i < blocks->size; i++) {
+        struct _fgraph_node * node = &(blocks->nodes[i]);
         char tmp[256];
         snprintf(tmp, 256, "block_%lld [shape=box, fontname=\"monospace\", fontsize=\"9.0\" label=<",
-                 (unsigned long long) graph_it_index(git));
+                 (unsigned long long) node->index);
 
         str = str_append(str, &str_size, &str_len, tmp);
 
         str = str_append(str, &str_size, &str_len, "<table cellspacing=\"0\" border=\"0\">");
 
-        struct _list * ins_list = graph_it_data(git);
-        struct _list_it * lit;
-        for (lit = list_iterator(ins_list); lit != NULL; lit = lit->next) {
-            struct _ins * ins = lit->data;
+        struct _vector * block = node->data;
+        for (j = 0; j < block->size; j++) {
+            struct _ins * ins = block->items[j];
 
             snprintf(tmp, 256, "<tr><td align=\"left\"><font color=\"blue\">%04llx</font></td><td align=\"left\">%s</td></tr>",
                      (unsigned long long) ins->address,
@@ -206,21 +321,18 @@ char * ins_graph_to_dot_string (struct _graph * graph)
 
         str = str_append(str, &str_size, &str_len, "</table>>];\n");
 
-        struct _list * successors = graph_node_successors(graph_it_node(git));
-        for (lit = list_iterator(successors); lit != NULL; lit = lit->next) {
-            struct _graph_edge * edge = lit->data;
+        const struct _fgraph_edge * successors = fgraph_successors(blocks, i);
+        for (j = 0; j < fgraph_successors_n(blocks, i); j++) {
             snprintf(tmp, 256, "block_%lld -> block_%lld;\n",
-                     (unsigned long long) edge->head,
-                     (unsigned long long) edge->tail);
+                     (unsigned long long) node->index,
+                     (unsigned long long) blocks->nodes[successors[j].node].index);
             str = str_append(str, &str_size, &str_len, tmp);
         }
-
-        object_delete(successors);
     }
 
     str = str_append(str, &str_size, &str_len, "bgcolor=\"transparent\"\n}");
 
-    object_delete(g);
+    object_delete(blocks);
 
     return str;
 }
\ No newline at end of file
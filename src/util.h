@@ -4,23 +4,36 @@
 #include <inttypes.h>
 
 #include "buffer.h"
+#include "fgraph.h"
 #include "graph.h"
+#include "list.h"
 #include "map.h"
 
 
 int mem_map_set (struct _map * mem_map, uint64_t address, struct _buffer * buf);
 
-struct _graph * ins_graph_to_list_ins_graph (struct _graph * graph);
+// takes a graph of type ins and returns a graph of blocks, each a _vector of
+// one instruction, ready for graph_reduce to merge
+struct _graph * ins_graph_to_list_ins_graph (const struct _fgraph * graph);
+
+// takes a graph of type ins and returns its graph of basic blocks, as
+// ins_graph_to_list_ins_graph followed by graph_reduce would, in one pass
+// over the nodes and edges
+struct _graph * ins_graph_to_block_graph (const struct _fgraph * graph);
 
 // takes a graph of type ins and returns all instructions with successors of
 // type call
-struct _list * ins_graph_to_list_call_ins (struct _graph * graph);
+struct _list * ins_graph_to_list_call_ins (const struct _fgraph * graph);
 
 // takes a graph of type ins and returns all destinations of instruction
 // successors of type call as a list of _index
-struct _list * ins_graph_to_list_index_call_dest (struct _graph * graph);
+struct _list * ins_graph_to_list_index_call_dest (const struct _fgraph * graph);
+
+// like ins_graph_to_list_index_call_dest, for a graph of basic blocks, each
+// a _vector of _ins
+struct _list * block_graph_to_list_index_call_dest (const struct _fgraph * graph);
 
 // caller must free result
-char * ins_graph_to_dot_string (struct _graph * graph);
+char * ins_graph_to_dot_string (const struct _fgraph * graph);
 
 #endif
\ No newline at end of file